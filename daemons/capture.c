@@ -0,0 +1,275 @@
+/****************************************************************************
+ ** capture.c ***************************************************************
+ ****************************************************************************
+ *
+ * capture.c - record and read back binary pulse-train capture files
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "hardware.h"
+#include "lircd.h"
+#include "capture.h"
+
+static FILE *capture_file = NULL;
+static char *capture_name = NULL;
+static unsigned long capture_max_size = 0;
+static unsigned long capture_size = 0;
+static int header_written = 0;
+static unsigned long long last_sync = 0;
+static unsigned long long last_sample = 0;
+
+unsigned long long capture_time(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+	{
+		struct timeval tv;
+
+		gettimeofday(&tv, NULL);
+		return (unsigned long long)tv.tv_sec * 1000000 + tv.tv_usec;
+	}
+}
+
+static unsigned char *put_le(unsigned char *p, unsigned long long value, int bytes)
+{
+	while (bytes-- > 0) {
+		*p++ = value & 0xff;
+		value >>= 8;
+	}
+	return p;
+}
+
+static unsigned long long get_le(const unsigned char **p, int bytes)
+{
+	unsigned long long value = 0;
+	int i;
+
+	for (i = 0; i < bytes; i++)
+		value |= (unsigned long long)(*p)[i] << (8 * i);
+	*p += bytes;
+	return value;
+}
+
+static int write_header(void)
+{
+	unsigned char buffer[CAPTURE_HEADER_SIZE];
+	unsigned char *p = buffer;
+	struct timeval tv;
+
+	memset(buffer, 0, sizeof(buffer));
+	memcpy(p, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+	p += 8;
+	p = put_le(p, CAPTURE_VERSION, 4);
+	p = put_le(p, hw.rec_mode, 4);
+	p = put_le(p, hw.features, 4);
+	p = put_le(p, hw.resolution, 4);
+	p = put_le(p, hw.code_length, 4);
+	gettimeofday(&tv, NULL);
+	p = put_le(p, (unsigned long long)tv.tv_sec * 1000000 + tv.tv_usec, 8);
+	if (hw.name)
+		strncpy((char *)p, hw.name, CAPTURE_DRIVER_LEN - 1);
+	p += CAPTURE_DRIVER_LEN;
+	if (hw.device)
+		strncpy((char *)p, hw.device, CAPTURE_DEVICE_LEN - 1);
+
+	if (fwrite(buffer, sizeof(buffer), 1, capture_file) != 1)
+		return 0;
+	capture_size = sizeof(buffer);
+	header_written = 1;
+	last_sync = 0;
+	return 1;
+}
+
+static void write_record(unsigned long long value, int tag)
+{
+	unsigned char buffer[10];
+	int n = 0;
+
+	value = (value << CAPTURE_TAG_BITS) | tag;
+	do {
+		buffer[n] = value & 0x7f;
+		value >>= 7;
+		if (value)
+			buffer[n] |= 0x80;
+		n++;
+	} while (value);
+	fwrite(buffer, n, 1, capture_file);
+	capture_size += n;
+}
+
+static int reopen_capture(void)
+{
+	char *old;
+
+	if (capture_file)
+		fclose(capture_file);
+	capture_file = NULL;
+	header_written = 0;
+
+	old = malloc(strlen(capture_name) + 3);
+	if (old == NULL) {
+		logprintf(LOG_ERR, "out of memory");
+		return 0;
+	}
+	sprintf(old, "%s.1", capture_name);
+	if (rename(capture_name, old) == -1 && errno != ENOENT) {
+		logprintf(LOG_WARNING, "could not rotate capture file %s", capture_name);
+	}
+	free(old);
+
+	capture_file = fopen(capture_name, "wb");
+	if (capture_file == NULL) {
+		logprintf(LOG_ERR, "could not open capture file %s", capture_name);
+		logperror(LOG_ERR, NULL);
+		return 0;
+	}
+	return 1;
+}
+
+int capture_open(const char *filename, unsigned long max_size)
+{
+	capture_close();
+
+	/* the daemon changes its working directory later on, rotation
+	   needs the absolute name */
+	if (filename[0] != '/') {
+		char cwd[PATH_MAX];
+
+		if (getcwd(cwd, sizeof(cwd)) == NULL) {
+			logperror(LOG_ERR, "getcwd()");
+			return 0;
+		}
+		capture_name = malloc(strlen(cwd) + strlen(filename) + 2);
+		if (capture_name != NULL)
+			sprintf(capture_name, "%s/%s", cwd, filename);
+	} else {
+		capture_name = strdup(filename);
+	}
+	if (capture_name == NULL) {
+		logprintf(LOG_ERR, "out of memory");
+		return 0;
+	}
+	capture_max_size = max_size;
+	if (!reopen_capture()) {
+		capture_close();
+		return 0;
+	}
+	logprintf(LOG_INFO, "capturing to %s", capture_name);
+	return 1;
+}
+
+void capture_close(void)
+{
+	if (capture_file)
+		fclose(capture_file);
+	capture_file = NULL;
+	free(capture_name);
+	capture_name = NULL;
+	header_written = 0;
+}
+
+void capture_sample(lirc_t data)
+{
+	unsigned long long now;
+	int burst;
+
+	if (capture_file == NULL)
+		return;
+
+	now = capture_time();
+	burst = !header_written || now - last_sample > CAPTURE_BURST_GAP;
+	if (burst) {
+		/* rotate only between bursts so a signal is never split */
+		if (header_written && capture_max_size > 0 && capture_size > capture_max_size) {
+			if (!reopen_capture()) {
+				capture_close();
+				return;
+			}
+		}
+		if (!header_written && !write_header()) {
+			logprintf(LOG_ERR, "could not write capture header");
+			capture_close();
+			return;
+		}
+	}
+	if (burst || now - last_sync > CAPTURE_SYNC_INTERVAL) {
+		write_record(last_sync ? now - last_sync : 0, CAPTURE_SYNC);
+		last_sync = now;
+		fflush(capture_file);
+	}
+	last_sample = now;
+	write_record(LIRC_VALUE(data), LIRC_MODE2(data) >> 24);
+}
+
+FILE *capture_open_read(const char *filename, struct capture_header *header)
+{
+	unsigned char buffer[CAPTURE_HEADER_SIZE];
+	const unsigned char *p = buffer;
+	FILE *f;
+
+	f = fopen(filename, "rb");
+	if (f == NULL) {
+		logprintf(LOG_ERR, "could not open capture file %s", filename);
+		logperror(LOG_ERR, NULL);
+		return NULL;
+	}
+	if (fread(buffer, sizeof(buffer), 1, f) != 1 || memcmp(buffer, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0) {
+		logprintf(LOG_ERR, "%s is not a capture file", filename);
+		fclose(f);
+		return NULL;
+	}
+	p += 8;
+	header->version = get_le(&p, 4);
+	if (header->version != CAPTURE_VERSION) {
+		logprintf(LOG_ERR, "unsupported capture file version %lu", header->version);
+		fclose(f);
+		return NULL;
+	}
+	header->rec_mode = get_le(&p, 4);
+	header->features = get_le(&p, 4);
+	header->resolution = get_le(&p, 4);
+	header->code_length = get_le(&p, 4);
+	header->start_time = get_le(&p, 8);
+	memcpy(header->driver, p, CAPTURE_DRIVER_LEN);
+	header->driver[CAPTURE_DRIVER_LEN - 1] = 0;
+	p += CAPTURE_DRIVER_LEN;
+	memcpy(header->device, p, CAPTURE_DEVICE_LEN);
+	header->device[CAPTURE_DEVICE_LEN - 1] = 0;
+	return f;
+}
+
+/* returns the record tag, or -1 at the end of the file */
+int capture_read(FILE * f, unsigned long long *value)
+{
+	unsigned long long v = 0;
+	int shift = 0;
+	int c;
+
+	do {
+		c = getc(f);
+		if (c == EOF || shift > 63)
+			return -1;
+		v |= (unsigned long long)(c & 0x7f) << shift;
+		shift += 7;
+	} while (c & 0x80);
+
+	*value = v >> CAPTURE_TAG_BITS;
+	return v & ((1 << CAPTURE_TAG_BITS) - 1);
+}
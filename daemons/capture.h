@@ -0,0 +1,60 @@
+/****************************************************************************
+ ** capture.h ***************************************************************
+ ****************************************************************************
+ *
+ * capture.h - binary pulse-train capture files
+ *
+ */
+
+#ifndef _CAPTURE_H
+#define _CAPTURE_H
+
+#include <stdio.h>
+
+#include "hardware.h"
+
+/*
+ * A capture file starts with a fixed size little-endian header
+ * followed by a stream of records.  Each record is an unsigned LEB128
+ * varint holding (value << CAPTURE_TAG_BITS) | tag.  Tags 0 to 3 are
+ * the LIRC_MODE2 sample types (space, pulse, frequency, timeout) with
+ * the sample value.  CAPTURE_SYNC carries the number of microseconds
+ * of monotonic time that passed since the previous sync record and
+ * timestamps the sample following it.
+ */
+
+#define CAPTURE_MAGIC "LIRCCAP"
+#define CAPTURE_VERSION 1
+
+#define CAPTURE_DRIVER_LEN 32
+#define CAPTURE_DEVICE_LEN 128
+#define CAPTURE_HEADER_SIZE (8 + 5 * 4 + 8 + CAPTURE_DRIVER_LEN + CAPTURE_DEVICE_LEN)
+
+#define CAPTURE_TAG_BITS 3
+#define CAPTURE_SYNC 4
+
+/* a gap this long starts a new burst and gets its own sync record */
+#define CAPTURE_BURST_GAP 20000
+/* sync at least this often during long bursts */
+#define CAPTURE_SYNC_INTERVAL 1000000
+
+struct capture_header {
+	unsigned long version;
+	unsigned long rec_mode;
+	unsigned long features;
+	unsigned long resolution;
+	unsigned long code_length;
+	unsigned long long start_time;	/* wall clock, usec since epoch */
+	char driver[CAPTURE_DRIVER_LEN];
+	char device[CAPTURE_DEVICE_LEN];
+};
+
+int capture_open(const char *filename, unsigned long max_size);
+void capture_close(void);
+void capture_sample(lirc_t data);
+
+FILE *capture_open_read(const char *filename, struct capture_header *header);
+int capture_read(FILE * f, unsigned long long *value);
+unsigned long long capture_time(void);
+
+#endif
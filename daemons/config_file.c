@@ -35,14 +35,63 @@
 
 #define LINE_LEN 1024
 #define MAX_INCLUDES 10
+#define ARENA_BLOCK_SIZE 16384
+
+/* everything read_config() returns is allocated from one arena, so a
+   config can be released in one go and does not fragment the heap */
+struct arena_block {
+	struct arena_block *next;
+	size_t size;
+	size_t used;
+};
+
+struct config_arena {
+	struct arena_block *blocks;
+	struct config_memory memory;
+};
+
+/* keeps blocks aligned for any member of the config structures */
+union arena_align {
+	long double d;
+	ir_code c;
+	void *p;
+};
+
+#define ARENA_ALIGN(n) (((n) + sizeof(union arena_align) - 1) & ~(sizeof(union arena_align) - 1))
+#define ARENA_HEADER ARENA_ALIGN(sizeof(struct arena_block))
 
 const char *whitespace = " \t";
 
+struct flaglist all_flags[] = {
+	{"RAW_CODES", RAW_CODES},
+	{"RC5", RC5},
+	{"SHIFT_ENC", SHIFT_ENC},	/* obsolete */
+	{"RC6", RC6},
+	{"RCMM", RCMM},
+	{"SPACE_ENC", SPACE_ENC},
+	{"SPACE_FIRST", SPACE_FIRST},
+	{"GOLDSTAR", GOLDSTAR},
+	{"GRUNDIG", GRUNDIG},
+	{"BO", BO},
+	{"SERIAL", SERIAL},
+	{"XMP", XMP},
+
+	{"REVERSE", REVERSE},
+	{"NO_HEAD_REP", NO_HEAD_REP},
+	{"NO_FOOT_REP", NO_FOOT_REP},
+	{"CONST_LENGTH", CONST_LENGTH},	/* remember to adapt warning
+					   message when changing this */
+	{"REPEAT_HEADER", REPEAT_HEADER},
+	{NULL, 0},
+};
+
 static int line;
 static int parse_error;
+static struct config_arena *parse_arena = NULL;
 
 static struct ir_remote *read_config_recursive(FILE * f, const char *name, int depth);
 static void calculate_signal_lengths(struct ir_remote *remote);
+static int get_bit_decoder(struct ir_remote *remote);
 
 void **init_void_array(struct void_array *ar, size_t chunk_size, size_t item_size)
 {
@@ -82,10 +131,87 @@ inline void *get_void_array(struct void_array *ar)
 	return (ar->ptr);
 }
 
+/* moves the array including its terminating empty item into the
+   arena */
+void *finish_void_array(struct void_array *ar)
+{
+	void *ptr;
+	size_t size;
+
+	if (parse_arena == NULL || ar->ptr == NULL)
+		return (ar->ptr);
+	size = ar->item_size * (ar->nr_items + 1);
+	ptr = s_malloc(size);
+	if (ptr != NULL)
+		memcpy(ptr, ar->ptr, size);
+	free(ar->ptr);
+	ar->ptr = NULL;
+	return (ptr);
+}
+
+static void *arena_alloc(struct config_arena *arena, size_t size)
+{
+	struct arena_block *block = arena->blocks;
+	size_t block_size;
+
+	size = ARENA_ALIGN(size);
+	if (block == NULL || block->size - block->used < size) {
+		block_size = ARENA_HEADER + size;
+		if (block_size < ARENA_BLOCK_SIZE)
+			block_size = ARENA_BLOCK_SIZE;
+		block = malloc(block_size);
+		if (block == NULL)
+			return (NULL);
+		block->size = block_size;
+		block->used = ARENA_HEADER;
+		if (arena->blocks != NULL && block_size > ARENA_BLOCK_SIZE) {
+			/* keep filling the current block after a large
+			   allocation */
+			block->next = arena->blocks->next;
+			arena->blocks->next = block;
+		} else {
+			block->next = arena->blocks;
+			arena->blocks = block;
+		}
+		arena->memory.blocks++;
+		arena->memory.size += block_size;
+	}
+	block->used += size;
+	arena->memory.used += size;
+	return ((char *)block + block->used - size);
+}
+
+static struct config_arena *arena_new(void)
+{
+	struct config_arena *arena;
+
+	arena = malloc(sizeof(*arena));
+	if (arena == NULL)
+		return (NULL);
+	memset(arena, 0, sizeof(*arena));
+	return (arena);
+}
+
+static void arena_free(struct config_arena *arena)
+{
+	struct arena_block *block, *next;
+
+	for (block = arena->blocks; block != NULL; block = next) {
+		next = block->next;
+		free(block);
+	}
+	free(arena);
+}
+
 void *s_malloc(size_t size)
 {
 	void *ptr;
-	if ((ptr = malloc(size)) == NULL) {
+
+	if (parse_arena != NULL)
+		ptr = arena_alloc(parse_arena, size);
+	else
+		ptr = malloc(size);
+	if (ptr == NULL) {
 		logprintf(LOG_ERR, "out of memory");
 		parse_error = 1;
 		return (NULL);
@@ -97,7 +223,15 @@ void *s_malloc(size_t size)
 inline char *s_strdup(char *string)
 {
 	char *ptr;
-	if (!(ptr = strdup(string))) {
+
+	if (parse_arena != NULL) {
+		ptr = arena_alloc(parse_arena, strlen(string) + 1);
+		if (ptr != NULL)
+			strcpy(ptr, string);
+	} else {
+		ptr = strdup(string);
+	}
+	if (!ptr) {
 		logprintf(LOG_ERR, "out of memory");
 		parse_error = 1;
 		return (NULL);
@@ -105,6 +239,13 @@ inline char *s_strdup(char *string)
 	return (ptr);
 }
 
+/* arena memory is only released with the whole config */
+static void s_free(void *ptr)
+{
+	if (parse_arena == NULL)
+		free(ptr);
+}
+
 inline ir_code s_strtocode(const char *val)
 {
 	ir_code code = 0;
@@ -296,7 +437,7 @@ int defineRemote(char *key, char *val, char *val2, struct ir_remote *rem)
 {
 	if ((strcasecmp("name", key)) == 0) {
 		if (rem->name != NULL)
-			free(rem->name);
+			s_free(rem->name);
 		rem->name = s_strdup(val);
 		LOGPRINTF(1, "parsing %s remote", val);
 		return (1);
@@ -304,7 +445,7 @@ int defineRemote(char *key, char *val, char *val2, struct ir_remote *rem)
 #ifdef DYNCODES
 	if ((strcasecmp("dyncodes_name", key)) == 0) {
 		if (rem->dyncodes_name != NULL) {
-			free(rem->dyncodes_name);
+			s_free(rem->dyncodes_name);
 		}
 		rem->dyncodes_name = s_strdup(val);
 		return (1);
@@ -605,9 +746,117 @@ static const char *lirc_parse_relative(char *dst, size_t dst_size, const char *c
 	return dst;
 }
 
+struct code_table_entry {
+	ir_code key;
+	int index;
+};
+
+static int compare_code_entries(const void *a, const void *b)
+{
+	const struct code_table_entry *ea = a, *eb = b;
+
+	if (ea->key != eb->key)
+		return ea->key < eb->key ? -1 : 1;
+	return ea->index - eb->index;
+}
+
+/* the table lives in the arena and goes away with the config */
+static void build_code_table(struct ir_remote *rem)
+{
+	struct code_table_entry *entries;
+	struct ir_code_table *table;
+	struct ir_ncode *codes;
+	int count, i;
+
+	rem->code_table = NULL;
+	if (rem->codes == NULL)
+		return;
+	for (codes = rem->codes, count = 0; codes->name != NULL; codes++, count++) {
+		if (codes->next != NULL)
+			return;
+	}
+	if (count == 0)
+		return;
+
+	entries = malloc(count * sizeof(*entries));
+	if (entries == NULL)
+		return;
+	for (i = 0; i < count; i++) {
+		entries[i].key = gen_ir_code(rem, rem->pre_data, rem->codes[i].code, rem->post_data) | rem->ignore_mask;
+		entries[i].index = i;
+	}
+	qsort(entries, count, sizeof(*entries), compare_code_entries);
+
+	table = s_malloc(sizeof(*table));
+	if (table != NULL) {
+		table->keys = s_malloc(count * sizeof(*table->keys));
+		table->index = s_malloc(count * sizeof(*table->index));
+		if (table->keys != NULL && table->index != NULL) {
+			for (i = 0; i < count; i++) {
+				table->keys[i] = entries[i].key;
+				table->index[i] = entries[i].index;
+			}
+			table->count = count;
+			rem->code_table = table;
+		}
+	}
+	free(entries);
+}
+
+/* like the code tables the lead table lives in the arena */
+static void build_lead_table(struct ir_remote *remotes)
+{
+	struct ir_lead_table *table;
+	struct ir_remote *rem;
+	int count, i;
+
+	for (rem = remotes, count = 0; rem != NULL; rem = rem->next, count++)
+		rem->lead_table = NULL;
+
+	table = s_malloc(sizeof(*table));
+	if (table == NULL)
+		return;
+	table->remote = s_malloc(count * sizeof(*table->remote));
+	table->min_head = s_malloc(count * sizeof(*table->min_head));
+	table->max_head = s_malloc(count * sizeof(*table->max_head));
+	table->min_repeat = s_malloc(count * sizeof(*table->min_repeat));
+	table->max_repeat = s_malloc(count * sizeof(*table->max_repeat));
+	if (table->remote == NULL || table->min_head == NULL || table->max_head == NULL || table->min_repeat == NULL
+	    || table->max_repeat == NULL)
+		return;
+	table->count = count;
+	for (rem = remotes, i = 0; rem != NULL; rem = rem->next, i++)
+		table->remote[i] = rem;
+	init_lead_table(table);
+	for (rem = remotes, i = 0; rem != NULL; rem = rem->next, i++) {
+		rem->lead_table = table;
+		rem->lead_index = i;
+	}
+}
+
 struct ir_remote *read_config(FILE * f, const char *name)
 {
-	return read_config_recursive(f, name, 0);
+	struct ir_remote *remotes, *rem;
+
+	parse_arena = arena_new();
+	if (parse_arena == NULL) {
+		logprintf(LOG_ERR, "out of memory");
+		return ((void *)-1);
+	}
+	remotes = read_config_recursive(f, name, 0);
+	if (remotes == (void *)-1 || remotes == NULL) {
+		arena_free(parse_arena);
+	} else {
+		for (rem = remotes; rem != NULL; rem = rem->next) {
+			rem->arena = parse_arena;
+			build_code_table(rem);
+		}
+		build_lead_table(remotes);
+		LOGPRINTF(1, "config uses %lu bytes in %lu blocks", parse_arena->memory.used,
+			  parse_arena->memory.blocks);
+	}
+	parse_arena = NULL;
+	return remotes;
 }
 
 static struct ir_remote *read_config_recursive(FILE * f, const char *name, int depth)
@@ -790,7 +1039,7 @@ static struct ir_remote *read_config_recursive(FILE * f, const char *name, int d
 					LOGPRINTF(2, "    end codes");
 					if (!checkMode(mode, ID_codes, "end codes"))
 						break;
-					rem->codes = get_void_array(&codes_list);
+					rem->codes = finish_void_array(&codes_list);
 					mode = ID_remote;	/* switch back */
 
 				} else if (strcasecmp("raw_codes", val) == 0) {
@@ -798,7 +1047,7 @@ static struct ir_remote *read_config_recursive(FILE * f, const char *name, int d
 					LOGPRINTF(2, "    end raw_codes");
 
 					if (mode == ID_raw_name) {
-						raw_code.signals = get_void_array(&signals);
+						raw_code.signals = finish_void_array(&signals);
 						raw_code.length = signals.nr_items;
 						if (raw_code.length % 2 == 0) {
 							logprintf(LOG_ERR, "error in configfile line %d:", line);
@@ -811,7 +1060,7 @@ static struct ir_remote *read_config_recursive(FILE * f, const char *name, int d
 					}
 					if (!checkMode(mode, ID_raw_codes, "end raw_codes"))
 						break;
-					rem->codes = get_void_array(&raw_codes);
+					rem->codes = finish_void_array(&raw_codes);
 					mode = ID_remote;	/* switch back */
 				} else if (strcasecmp("remote", val) == 0) {
 					/* end remote mode */
@@ -885,7 +1134,7 @@ static struct ir_remote *read_config_recursive(FILE * f, const char *name, int d
 					if (strcasecmp("name", key) == 0) {
 						LOGPRINTF(3, "Button: \"%s\"", val);
 						if (mode == ID_raw_name) {
-							raw_code.signals = get_void_array(&signals);
+							raw_code.signals = finish_void_array(&signals);
 							raw_code.length = signals.nr_items;
 							if (raw_code.length % 2 == 0) {
 								logprintf(LOG_ERR, "error in configfile line %d:",
@@ -948,15 +1197,15 @@ static struct ir_remote *read_config_recursive(FILE * f, const char *name, int d
 		switch (mode) {
 		case ID_raw_name:
 			if (raw_code.name != NULL) {
-				free(raw_code.name);
+				s_free(raw_code.name);
 				if (get_void_array(&signals) != NULL)
 					free(get_void_array(&signals));
 			}
 		case ID_raw_codes:
-			rem->codes = get_void_array(&raw_codes);
+			rem->codes = finish_void_array(&raw_codes);
 			break;
 		case ID_codes:
-			rem->codes = get_void_array(&codes_list);
+			rem->codes = finish_void_array(&codes_list);
 			break;
 		}
 		if (!parse_error) {
@@ -971,7 +1220,9 @@ static struct ir_remote *read_config_recursive(FILE * f, const char *name, int d
 			logprintf(LOG_ERR, "reading of file '%s' failed", name);
 			print_error = 0;
 		}
-		free_config(top_rem);
+		/* read_config() drops the arena with everything in it */
+		if (parse_arena == NULL)
+			free_config(top_rem);
 		if (depth == 0)
 			print_error = 1;
 		return ((void *)-1);
@@ -1048,6 +1299,9 @@ static struct ir_remote *read_config_recursive(FILE * f, const char *name, int d
 			}
 		}
 		calculate_signal_lengths(rem);
+		rem->bit_decoder = get_bit_decoder(rem);
+		if (rem->bit_decoder != BIT_DECODER_GENERIC)
+			init_symbols(rem);
 		rem = rem->next;
 	}
 
@@ -1058,6 +1312,24 @@ static struct ir_remote *read_config_recursive(FILE * f, const char *name, int d
 	return (top_rem);
 }
 
+/*
+  The common protocols get decoders of their own for the data bits.
+  They need all four bit lengths, the generic code copes with missing
+  ones.
+*/
+static int get_bit_decoder(struct ir_remote *remote)
+{
+	if (remote->pone <= 0 || remote->sone <= 0 || remote->pzero <= 0 || remote->szero <= 0)
+		return BIT_DECODER_GENERIC;
+	if (is_goldstar(remote))
+		return BIT_DECODER_GENERIC;
+	if (is_biphase(remote))
+		return BIT_DECODER_BIPHASE;
+	if (is_space_enc(remote))
+		return BIT_DECODER_SPACE_ENC;
+	return BIT_DECODER_GENERIC;
+}
+
 void calculate_signal_lengths(struct ir_remote *remote)
 {
 	if (is_const(remote)) {
@@ -1069,7 +1341,7 @@ void calculate_signal_lengths(struct ir_remote *remote)
 	}
 
 	lirc_t min_signal_length = 0, max_signal_length = 0;
-	lirc_t max_pulse = 0, max_space = 0;
+	lirc_t min_pulse = 0, min_space = 0, max_pulse = 0, max_space = 0;
 	int first_sum = 1;
 	struct ir_ncode *c = remote->codes;
 	int i;
@@ -1087,6 +1359,7 @@ void calculate_signal_lengths(struct ir_remote *remote)
 				next = next->next;
 			}
 			for (repeat = 0; repeat < 2; repeat++) {
+				lock_send_buffer();
 				if (init_sim(remote, &code, repeat)) {
 					lirc_t sum = send_buffer.sum;
 
@@ -1104,14 +1377,21 @@ void calculate_signal_lengths(struct ir_remote *remote)
 							if (send_buffer.data[i] > max_space) {
 								max_space = send_buffer.data[i];
 							}
+							if (min_space == 0 || send_buffer.data[i] < min_space) {
+								min_space = send_buffer.data[i];
+							}
 						} else {	/* pulse */
 
 							if (send_buffer.data[i] > max_pulse) {
 								max_pulse = send_buffer.data[i];
 							}
+							if (min_pulse == 0 || send_buffer.data[i] < min_pulse) {
+								min_pulse = send_buffer.data[i];
+							}
 						}
 					}
 				}
+				unlock_send_buffer();
 			}
 		} while (next);
 		c++;
@@ -1140,6 +1420,11 @@ void calculate_signal_lengths(struct ir_remote *remote)
 		remote->min_total_signal_length = min_signal_length + remote->min_gap_length;
 		remote->max_total_signal_length = max_signal_length + remote->max_gap_length;
 	}
+	/* 0 if there is no timing data */
+	remote->min_pulse_length = min_pulse;
+	remote->max_pulse_length = max_pulse;
+	remote->min_space_length = min_space;
+	remote->max_space_length = max_space;
 	LOGPRINTF(1, "lengths: %lu %lu %lu %lu", remote->min_total_signal_length, remote->max_total_signal_length,
 		  remote->min_gap_length, remote->max_gap_length);
 }
@@ -1149,9 +1434,18 @@ void free_config(struct ir_remote *remotes)
 	struct ir_remote *next;
 	struct ir_ncode *codes;
 
+	config_generation++;
 	while (remotes != NULL) {
 		next = remotes->next;
 
+		if (remotes->arena != NULL) {
+			/* the remotes of one arena are adjacent in the list */
+			if (next == NULL || next->arena != remotes->arena)
+				arena_free(remotes->arena);
+			remotes = next;
+			continue;
+		}
+
 #               ifdef DYNCODES
 		if (remotes->dyncodes_name != NULL)
 			free(remotes->dyncodes_name);
@@ -1180,3 +1474,18 @@ void free_config(struct ir_remote *remotes)
 		remotes = next;
 	}
 }
+
+void get_config_memory(struct ir_remote *remotes, struct config_memory *memory)
+{
+	struct config_arena *last = NULL;
+
+	memset(memory, 0, sizeof(*memory));
+	for (; remotes != NULL; remotes = remotes->next) {
+		if (remotes->arena == NULL || remotes->arena == last)
+			continue;
+		last = remotes->arena;
+		memory->blocks += last->memory.blocks;
+		memory->size += last->memory.size;
+		memory->used += last->memory.used;
+	}
+}
@@ -23,28 +23,7 @@ struct flaglist {
 	int flag;
 };
 
-static struct flaglist all_flags[] = {
-	{"RAW_CODES", RAW_CODES},
-	{"RC5", RC5},
-	{"SHIFT_ENC", SHIFT_ENC},	/* obsolete */
-	{"RC6", RC6},
-	{"RCMM", RCMM},
-	{"SPACE_ENC", SPACE_ENC},
-	{"SPACE_FIRST", SPACE_FIRST},
-	{"GOLDSTAR", GOLDSTAR},
-	{"GRUNDIG", GRUNDIG},
-	{"BO", BO},
-	{"SERIAL", SERIAL},
-	{"XMP", XMP},
-
-	{"REVERSE", REVERSE},
-	{"NO_HEAD_REP", NO_HEAD_REP},
-	{"NO_FOOT_REP", NO_FOOT_REP},
-	{"CONST_LENGTH", CONST_LENGTH},	/* remember to adapt warning
-					   message when changing this */
-	{"REPEAT_HEADER", REPEAT_HEADER},
-	{NULL, 0},
-};
+extern struct flaglist all_flags[];
 
 /*
   config stuff
@@ -65,9 +44,16 @@ struct void_array {
 	size_t chunk_size;
 };
 
+struct config_memory {
+	unsigned long blocks;	/* number of malloc()ed blocks */
+	unsigned long size;	/* bytes allocated */
+	unsigned long used;	/* bytes in use by the config */
+};
+
 void **init_void_array(struct void_array *ar, size_t chunk_size, size_t item_size);
 int add_void_array(struct void_array *ar, void *data);
 inline void *get_void_array(struct void_array *ar);
+void *finish_void_array(struct void_array *ar);
 
 /* some safer functions */
 void *s_malloc(size_t size);
@@ -86,5 +72,6 @@ struct ir_code_node *defineNode(struct ir_ncode *code, const char *val);
 int defineRemote(char *key, char *val, char *val2, struct ir_remote *rem);
 struct ir_remote *read_config(FILE * f, const char *name);
 void free_config(struct ir_remote *remotes);
+void get_config_memory(struct ir_remote *remotes, struct config_memory *memory);
 
 #endif
@@ -0,0 +1,215 @@
+/****************************************************************************
+ ** event_ring.c ************************************************************
+ ****************************************************************************
+ *
+ * event_ring.c - publish decoded events in a shared memory ring
+ *
+ * Local consumers map the ring read-only and follow the head sequence
+ * number, so handing an event to any number of them costs one copy
+ * into the ring plus at most one wakeup.  See tools/lirc_shm.h for the
+ * layout.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#include "lircd.h"
+#include "ir_remote.h"
+#include "event_ring.h"
+
+extern struct ir_remote *remotes;
+
+static struct lirc_shm_ring *ring = NULL;
+static char *ring_name = NULL;
+static struct ir_remote *ring_remotes = NULL;
+static unsigned int ring_config_generation = 0;
+static uint32_t ring_generation = 0;
+
+int event_ring_open(const char *name)
+{
+	int fd;
+
+	event_ring_close();
+
+	/* a stale ring of an earlier lircd may still be mapped by
+	   readers, they notice the new one through the closed flag */
+	shm_unlink(name);
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if (fd == -1) {
+		logprintf(LOG_ERR, "could not create shared memory %s", name);
+		logperror(LOG_ERR, NULL);
+		return (0);
+	}
+	if (ftruncate(fd, sizeof(*ring)) == -1) {
+		logperror(LOG_ERR, "ftruncate()");
+		close(fd);
+		shm_unlink(name);
+		return (0);
+	}
+	ring = mmap(NULL, sizeof(*ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ring == MAP_FAILED) {
+		logperror(LOG_ERR, "mmap()");
+		ring = NULL;
+		shm_unlink(name);
+		return (0);
+	}
+	ring_name = strdup(name);
+	if (ring_name == NULL) {
+		logprintf(LOG_ERR, "out of memory");
+		event_ring_close();
+		return (0);
+	}
+
+	memset(ring, 0, sizeof(*ring));
+	ring->slots = LIRC_SHM_SLOTS;
+	ring->event_size = sizeof(ring->event[0]);
+	ring->version = LIRC_SHM_VERSION;
+	__sync_synchronize();
+	ring->magic = LIRC_SHM_MAGIC;
+	logprintf(LOG_INFO, "publishing events in shared memory %s", name);
+	return (1);
+}
+
+static void wake_readers(void)
+{
+#if defined(__linux__) && defined(SYS_futex)
+	syscall(SYS_futex, &ring->head, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+void event_ring_close(void)
+{
+	if (ring != NULL) {
+		ring->closed = 1;
+		__sync_synchronize();
+		ring->head++;
+		wake_readers();
+		munmap(ring, sizeof(*ring));
+		ring = NULL;
+	}
+	if (ring_name != NULL) {
+		shm_unlink(ring_name);
+		free(ring_name);
+		ring_name = NULL;
+	}
+}
+
+/* for events that were not just decoded, like SIMULATE */
+static void lookup_ids(const char *remote_name, const char *button_name, uint32_t * remote_id, uint32_t * button_id)
+{
+	struct ir_remote *remote;
+	struct ir_ncode *ncode;
+	uint32_t id;
+
+	*remote_id = *button_id = LIRC_SHM_NO_ID;
+	for (remote = remotes, id = 0; remote != NULL; remote = remote->next, id++) {
+		if (strcmp(remote->name, remote_name) == 0)
+			break;
+	}
+	if (remote == NULL)
+		return;
+	*remote_id = id;
+	if (remote->codes == NULL)
+		return;
+	for (ncode = remote->codes; ncode->name != NULL; ncode++) {
+		if (strcmp(ncode->name, button_name) == 0) {
+			*button_id = ncode - remote->codes;
+			return;
+		}
+	}
+}
+
+static void copy_name(char *dest, const char *src, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len - 1 && src[i] != 0 && src[i] != ' ' && src[i] != '\n'; i++)
+		dest[i] = src[i];
+	dest[i] = 0;
+}
+
+/* remote and ncode are NULL if the button is not known to be in memory */
+void event_ring_publish(const char *message, const char *remote_name, const char *button_name, struct ir_remote *remote,
+			struct ir_ncode *ncode, int release)
+{
+	struct lirc_shm_event *event;
+	struct timeval now;
+	unsigned long long code;
+	unsigned int reps;
+	const char *button, *name;
+	char *end;
+	uint32_t seq;
+
+	if (ring == NULL)
+		return;
+
+	/* <code> <reps> <button> <remote> */
+	code = strtoull(message, &end, 16);
+	reps = strtoul(end, &end, 16);
+	button = end + 1;
+	name = strchr(button, ' ');
+	if (*end != ' ' || name == NULL) {
+		LOGPRINTF(1, "not publishing malformed event: %s", message);
+		return;
+	}
+	name++;
+
+	/* a new config may be allocated where the old one was */
+	if (remotes != ring_remotes || config_generation != ring_config_generation) {
+		ring_remotes = remotes;
+		ring_config_generation = config_generation;
+		ring_generation++;
+	}
+
+	seq = ring->head + 1;
+	event = &ring->event[(seq - 1) & (LIRC_SHM_SLOTS - 1)];
+	event->seq = 0;
+	__sync_synchronize();
+
+	event->generation = ring_generation;
+	event->code = code;
+	event->reps = reps;
+	event->flags = release ? LIRC_SHM_RELEASE : 0;
+	gettimeofday(&now, NULL);
+	event->timestamp = (uint64_t) now.tv_sec * 1000000 + now.tv_usec;
+	copy_name(event->remote, remote_name ? remote_name : name, LIRC_SHM_NAME_LEN);
+	copy_name(event->button, release || button_name == NULL ? button : button_name, LIRC_SHM_NAME_LEN);
+	if (remote != NULL && remote->index >= 0) {
+		event->remote_id = remote->index;
+		event->button_id = ncode - remote->codes;
+	} else if (remote_name != NULL && button_name != NULL) {
+		lookup_ids(remote_name, button_name, &event->remote_id, &event->button_id);
+	} else {
+		char rname[LIRC_SHM_NAME_LEN], bname[LIRC_SHM_NAME_LEN];
+
+		copy_name(rname, name, sizeof(rname));
+		copy_name(bname, button, sizeof(bname));
+		lookup_ids(rname, bname, &event->remote_id, &event->button_id);
+	}
+
+	__sync_synchronize();
+	event->seq = seq;
+	__sync_synchronize();
+	ring->head = seq;
+	__sync_synchronize();
+	wake_readers();
+}
@@ -0,0 +1,20 @@
+/****************************************************************************
+ ** event_ring.h ************************************************************
+ ****************************************************************************
+ *
+ * event_ring.h - publish decoded events in a shared memory ring
+ *
+ */
+
+#ifndef _EVENT_RING_H
+#define _EVENT_RING_H
+
+#include "ir_remote_types.h"
+#include "tools/lirc_shm.h"
+
+int event_ring_open(const char *name);
+void event_ring_close(void);
+void event_ring_publish(const char *message, const char *remote_name, const char *button_name, struct ir_remote *remote,
+			struct ir_ncode *ncode, int release);
+
+#endif
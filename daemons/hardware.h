@@ -34,6 +34,11 @@ struct hardware {
 	char *name;
 
 	unsigned int resolution;
+
+	/* optional: returns non-zero while the driver still holds
+	   input it has already read, rec_func must then be called
+	   again before waiting on fd */
+	int (*pending_func) (void);
 };
 
 extern struct hardware hw;
@@ -47,6 +47,7 @@ extern struct hardware hw_mplay2;
 extern struct hardware hw_pcmak;
 extern struct hardware hw_pinsys;
 extern struct hardware hw_pixelview;
+extern struct hardware hw_replay;
 extern struct hardware hw_samsung;
 extern struct hardware hw_sb0540;
 extern struct hardware hw_silitek;
@@ -158,6 +159,7 @@ struct hardware *hw_list[] = {
 	&hw_pcmak,
 	&hw_pinsys,
 	&hw_pixelview,
+	&hw_replay,
 #ifdef HAVE_LINUX_HIDDEV_FLAG_UREF
 	&hw_samsung,
 	&hw_sb0540,
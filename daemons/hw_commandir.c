@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <limits.h>
@@ -19,6 +20,7 @@
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/wait.h>
+#include <sys/select.h>
 #include <sys/un.h>
 #include <sys/utsname.h>
 
@@ -28,6 +30,7 @@
 #include "receive.h"
 #include "transmit.h"
 #include "hw_commandir.h"
+#include "sample_pipe.h"
 
 struct hardware hw_commandir = {
 	0,			/* default device */
@@ -43,7 +46,9 @@ struct hardware hw_commandir = {
 	commandir_receive_decode,	/* decode_func */
 	commandir_ioctl,	/* ioctl_func */
 	commandir_readdata,	/* readdata */
-	"commandir"
+	"commandir",
+	0,			/* resolution */
+	sample_pending		/* pending_func */
 };
 
 lirc_t lirc_zero_buffer[2] = { 0, 0 };
@@ -60,6 +65,7 @@ struct detected_commandir {
 };
 
 static int child_pipe_write = 0;
+static struct sample_writer rx_samples;
 static char haveInited = 0;
 
 // 'commandir' event signal values
@@ -74,6 +80,7 @@ static pid_t child_pid = -1;
 static int pipe_tochild[2] = { -1, -1 };
 
 static int tochild_read = -1, tochild_write = -1;
+static int parent_gone = 0;
 static int current_transmitter_mask = 0xff;
 static char unsigned commandir_data_buffer[512];
 static int last_mc_time = -1;
@@ -117,6 +124,7 @@ static int commandir_init()
 	}
 
 	hw.fd = pipe_fd[0];	// the READ end of the Pipe
+	sample_reader_init();
 
 	if (pipe(pipe_tochild) != 0) {
 		logprintf(LOG_ERR, "couldn't open pipe 1");
@@ -139,6 +147,7 @@ static int commandir_init()
 		return 0;
 	} else if (child_pid == 0) {
 		child_pipe_write = pipe_fd[1];
+		sample_writer_init(&rx_samples, child_pipe_write);
 		commandir_child_init();
 		commandir_read_loop();
 		return 0;
@@ -280,25 +289,20 @@ static int commandir_ioctl(unsigned int cmd, void *arg)
 static lirc_t commandir_readdata(lirc_t timeout)
 {
 	lirc_t code = 0;
-	if (!waitfordata(timeout / 2)) {
-		return 0;
-	}
+	int ret;
 
 	/* if we failed to get data return 0 */
 	/* Keep trying if we are mode2, but return immediately if we are the others */
-	if (strncmp(progname, "mode2", 5) == 0) {
-		while (code == 0) {
-			if (read(hw.fd, &code, sizeof(lirc_t)) <= 0) {
-				commandir_deinit();
-				return -1;
-			}
+	do {
+		ret = sample_read(&code, timeout / 2);
+		if (ret == 0) {
+			return 0;
 		}
-	} else {
-		if (read(hw.fd, &code, sizeof(lirc_t)) <= 0) {
+		if (ret == -1) {
 			commandir_deinit();
 			return -1;
 		}
-	}
+	} while (code == 0 && strncmp(progname, "mode2", 5) == 0);
 	return code;
 }
 
@@ -868,6 +872,33 @@ static void software_disconnects()
 }
 
 /*** Reading and Writing Functions ***/
+/* Sleep between RX polls, but wake up at once when lircd sends a
+ * command so transmits don't wait for the next poll.
+ *
+ * Only the command pipe is event driven.  The CommandIRs answer every
+ * bulk read with a status packet, whether or not a signal came in,
+ * and libusb-0.1 has neither asynchronous transfers nor descriptors to
+ * select() on, so receiving remains a poll every read_delay usecs,
+ * which the COMMANDIR_POLL_FASTER/SLOWER codes adjust.  tools/ircmdbench
+ * replays recorded packets to measure the latency and CPU time of it */
+static void wait_for_command(int usec)
+{
+	fd_set fds;
+	struct timeval tv;
+
+	if (parent_gone) {
+		usleep(usec);
+		return;
+	}
+	FD_ZERO(&fds);
+	FD_SET(tochild_read, &fds);
+	tv.tv_sec = usec / 1000000;
+	tv.tv_usec = usec % 1000000;
+	if (select(tochild_read + 1, &fds, NULL, NULL, &tv) == -1 && errno != EINTR) {
+		usleep(usec);
+	}
+}
+
 static void commandir_read_loop()
 {
 	// Read from CommandIR, Write to pipe
@@ -899,6 +930,12 @@ static void commandir_read_loop()
 
 		bytes_read = read(tochild_read, commands, MAX_COMMAND);
 
+		if (bytes_read == 0 && !parent_gone) {
+			// lircd closed its end, don't wake up on the EOF again
+			parent_gone = 1;
+			shutdown_pending++;
+		}
+
 		if (bytes_read > 0) {
 			while (curCommandStart < bytes_read) {
 				curCommandLength = commands[curCommandStart] + commands[curCommandStart + 1] * 256;
@@ -988,7 +1025,7 @@ static void commandir_read_loop()
 				hardware_scan();
 				periodic_checks = 0;
 			} else {
-				usleep(read_delay);
+				wait_for_command(read_delay);
 			}
 		}
 	}
@@ -1275,14 +1312,37 @@ static int check_irsend_commandir(unsigned char *command)
 
 /*** CommandIR RX Functions ***/
 
+/* Samples are queued and sent to lircd in batches, see sample_pipe.c */
 static void lirc_pipe_write(lirc_t * one_item)
 {
-	int bytes_w;		// Pipe write
+	if (!sample_write(&rx_samples, *one_item)) {
+		logprintf(LOG_ERR, "Can't write to LIRC pipe! %d", child_pipe_write);
+	}
+}
 
-	bytes_w = write(child_pipe_write, one_item, sizeof(lirc_t));
-	if (bytes_w < 0) {
+static int lirc_pipe_flush()
+{
+	if (!sample_flush(&rx_samples)) {
 		logprintf(LOG_ERR, "Can't write to LIRC pipe! %d", child_pipe_write);
+		return -1;
+	}
+	return 0;
+}
+
+/* Sends the queued samples followed by count items */
+static int lirc_pipe_write_buffer(lirc_t * items, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (!sample_write(&rx_samples, items[i])) {
+			break;
+		}
+	}
+	if (i < count || lirc_pipe_flush() == -1) {
+		return -1;
 	}
+	return sizeof(lirc_t) * count;
 }
 
 static int commandir_read()
@@ -1383,9 +1443,7 @@ static int commandir_read()
 				int tmp4 = 0;
 				if (zeroterminated > 1001) {
 					if (insert_fast_zeros > 0) {
-						tmp4 =
-						    write(child_pipe_write, lirc_zero_buffer,
-							  sizeof(lirc_t) * insert_fast_zeros);
+						tmp4 = lirc_pipe_write_buffer(lirc_zero_buffer, insert_fast_zeros);
 					}
 					zeroterminated = 0;
 				} else {
@@ -1798,10 +1856,9 @@ static int cmdir_convert_RX(unsigned char *orig_rxbuffer)
 	}
 	last_mc_time = asint1;
 
-	bytes_w = write(child_pipe_write, lirc_data_buffer, sizeof(lirc_t) * num_data_values);
+	bytes_w = lirc_pipe_write_buffer(lirc_data_buffer, num_data_values);
 
 	if (bytes_w < 0) {
-		logprintf(LOG_ERR, "Can't write to LIRC pipe! %d", child_pipe_write);
 		goto done;
 	}
 
@@ -1873,8 +1930,7 @@ static int commandir3_convert_RX(unsigned char *rxBuffer, int numNewValues)
 				mySize = 4;
 				break;
 			case USB_NO_DATA_BYTE:
-				read_num =
-				    write(child_pipe_write, lirc_zero_buffer, sizeof(lirc_t) * insert_fast_zeros);
+				read_num = lirc_pipe_write_buffer(lirc_zero_buffer, insert_fast_zeros);
 				mySize = 0;
 				break;
 			default:
@@ -1964,6 +2020,7 @@ static int commandir3_convert_RX(unsigned char *rxBuffer, int numNewValues)
 			}
 		}
 	}
+	lirc_pipe_flush();
 	return 0;
 }
 
@@ -2006,10 +2063,9 @@ static int commandir2_convert_RX(unsigned short *bufferrx, unsigned char numvalu
 		}
 	}
 
-	bytes_w = write(child_pipe_write, lirc_data_buffer, sizeof(lirc_t) * i);
+	bytes_w = lirc_pipe_write_buffer(lirc_data_buffer, i);
 
 	if (bytes_w < 0) {
-		logprintf(LOG_ERR, "Can't write to LIRC pipe! %d", child_pipe_write);
 		return 0;
 	}
 	return bytes_w;
@@ -2101,7 +2157,7 @@ static void set_all_next_tx_mask(int *ar_new_tx_mask_list, int new_tx_len, __u32
 static void raise_event(unsigned int eventid)
 {
 	static lirc_t event_data[18] = { LIRCCODE_GAP, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
-	int i, bytes_w;
+	int i;
 
 	// Only for CommandIR II, and never for irrecord or mode2
 	if (strncmp(progname, "mode2", 5) == 0 || strncmp(progname, "irrecord", 8) == 0) {
@@ -2121,9 +2177,5 @@ static void raise_event(unsigned int eventid)
 
 	event_data[16] = LIRCCODE_GAP * 4;
 
-	bytes_w = write(child_pipe_write, event_data, sizeof(lirc_t) * 17);
-
-	if (bytes_w < 0) {
-		logprintf(LOG_ERR, "Can't write to LIRC pipe! %d", child_pipe_write);
-	}
+	lirc_pipe_write_buffer(event_data, 17);
 }
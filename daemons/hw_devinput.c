@@ -53,6 +53,7 @@ static int devinput_deinit(void);
 static int devinput_decode(struct ir_remote *remote, ir_code * prep, ir_code * codep, ir_code * postp,
 			   int *repeat_flagp, lirc_t * min_remaining_gapp, lirc_t * max_remaining_gapp);
 static char *devinput_rec(struct ir_remote *remotes);
+static int devinput_pending(void);
 
 enum locate_type {
 	locate_by_name,
@@ -73,7 +74,9 @@ struct hardware hw_devinput = {
 	devinput_decode,	/* decode_func */
 	NULL,			/* ioctl_func */
 	NULL,			/* readdata */
-	"devinput"
+	"devinput",
+	0,			/* resolution */
+	devinput_pending	/* pending_func */
 };
 
 static ir_code code;
@@ -90,6 +93,37 @@ enum {
 
 static int repeat_state = RPT_UNKNOWN;
 
+/* events are read in batches, one read() per burst from the device */
+#define EVENT_BUF_SIZE 64
+
+static struct input_event event_buf[EVENT_BUF_SIZE];
+static int event_count = 0;
+static int event_pos = 0;
+
+/* events to forward to uinput, written once per SYN_REPORT group */
+static struct input_event fwd_buf[EVENT_BUF_SIZE];
+static int fwd_count = 0;
+
+/*
+  (type, code, value) -> (remote, button) lookup table, so that
+  decoding does not have to try every remote in turn. It is only
+  built when the result is guaranteed to be the same as with
+  decode_all(), otherwise key_table stays NULL.
+*/
+struct devinput_key {
+	ir_code code;
+	int bits;		/* code_length or 32 for code_compat */
+	int order;		/* position of remote in list */
+	struct ir_remote *remote;
+	struct ir_ncode *ncode;
+};
+
+static struct devinput_key *key_table = NULL;
+static unsigned int key_table_mask;
+static struct ir_remote *key_table_remotes = NULL;
+static unsigned int key_table_generation;
+static int key_table_built = 0;
+
 static int setup_uinputfd(const char *name, int source)
 {
 	int fd;
@@ -286,6 +320,132 @@ static int locate_dev(const char *pattern, enum locate_type type)
 	return 1;
 }
 
+static inline unsigned int key_hash(ir_code code)
+{
+	return (unsigned int)((code * 0x9e3779b97f4a7c15ULL) >> 32) & key_table_mask;
+}
+
+static void free_key_table(void)
+{
+	if (key_table != NULL) {
+		free(key_table);
+		key_table = NULL;
+	}
+	key_table_built = 0;
+}
+
+static void build_key_table(struct ir_remote *remotes)
+{
+	struct ir_remote *scan;
+	struct ir_ncode *ncode;
+	unsigned int count = 0, size, i;
+	int order;
+
+	free_key_table();
+	key_table_built = 1;
+	key_table_remotes = remotes;
+	key_table_generation = config_generation;
+
+#       ifdef DYNCODES
+	/* get_code() matches anything */
+	return;
+#       endif
+	for (scan = remotes; scan != NULL; scan = scan->next) {
+		if ((bit_count(scan) != hw_devinput.code_length && bit_count(scan) != 32) || scan->codes == NULL) {
+			/* can never match */
+			continue;
+		}
+		if (has_toggle_mask(scan) || has_toggle_bit_mask(scan) || has_ignore_mask(scan)) {
+			return;
+		}
+		for (ncode = scan->codes; ncode->name != NULL; ncode++) {
+			if (ncode->next != NULL) {
+				return;
+			}
+			count++;
+		}
+	}
+
+	for (size = 16; size < 2 * count; size <<= 1) ;
+	key_table = calloc(size, sizeof(*key_table));
+	if (key_table == NULL) {
+		logprintf(LOG_WARNING, "out of memory, not using key table");
+		return;
+	}
+	key_table_mask = size - 1;
+
+	for (scan = remotes, order = 0; scan != NULL; scan = scan->next, order++) {
+		if ((bit_count(scan) != hw_devinput.code_length && bit_count(scan) != 32) || scan->codes == NULL) {
+			continue;
+		}
+		for (ncode = scan->codes; ncode->name != NULL; ncode++) {
+			ir_code all;
+
+			all = gen_ir_code(scan, scan->pre_data, ncode->code, scan->post_data);
+			for (i = key_hash(all); key_table[i].remote != NULL; i = (i + 1) & key_table_mask) {
+				if (key_table[i].code == all && key_table[i].bits == bit_count(scan))
+					break;
+			}
+			/* first match in list order wins, like in decode_all() */
+			if (key_table[i].remote == NULL) {
+				key_table[i].code = all;
+				key_table[i].bits = bit_count(scan);
+				key_table[i].order = order;
+				key_table[i].remote = scan;
+				key_table[i].ncode = ncode;
+			}
+		}
+	}
+	LOGPRINTF(1, "key table: %u codes in %u slots", count, size);
+}
+
+static struct devinput_key *lookup_key(ir_code code, int bits)
+{
+	unsigned int i;
+
+	for (i = key_hash(code); key_table[i].remote != NULL; i = (i + 1) & key_table_mask) {
+		if (key_table[i].code == code && key_table[i].bits == bits) {
+			return &key_table[i];
+		}
+	}
+	return NULL;
+}
+
+static char *decode_event(struct ir_remote *remotes)
+{
+	struct devinput_key *key, *key_compat;
+
+	if (!key_table_built || remotes != key_table_remotes || config_generation != key_table_generation) {
+		build_key_table(remotes);
+	}
+	if (key_table == NULL) {
+		return decode_all(remotes);
+	}
+	key = lookup_key(code, hw_devinput.code_length);
+	key_compat = lookup_key(code_compat, 32);
+	if (key == NULL || (key_compat != NULL && key_compat->order < key->order)) {
+		key = key_compat;
+	}
+	if (key == NULL) {
+		return decode_ncode(remotes, NULL, NULL);
+	}
+	return decode_ncode(remotes, key->remote, key->ncode);
+}
+
+static void flush_forward(void)
+{
+	ssize_t len;
+
+	if (fwd_count == 0)
+		return;
+	len = fwd_count * sizeof(struct input_event);
+	if (write(uinputfd, fwd_buf, len) != len) {
+		logprintf(LOG_ERR, "writing to uinput failed");
+		logperror(LOG_ERR, NULL);
+	}
+	fwd_count = 0;
+}
+
 int devinput_init()
 {
 	logprintf(LOG_INFO, "initializing '%s'", hw.device);
@@ -338,6 +498,9 @@ int devinput_deinit(void)
 	}
 	close(hw.fd);
 	hw.fd = -1;
+	event_count = event_pos = 0;
+	fwd_count = 0;
+	free_key_table();
 	return 1;
 }
 
@@ -376,75 +539,97 @@ int devinput_decode(struct ir_remote *remote, ir_code * prep, ir_code * codep, i
 	return 1;
 }
 
+int devinput_pending(void)
+{
+	return event_pos < event_count;
+}
+
 char *devinput_rec(struct ir_remote *remotes)
 {
-	struct input_event event;
+	struct input_event *event;
 	int rd;
 	ir_code value;
+	char *message;
 
 	LOGPRINTF(1, "devinput_rec");
 
-	last = end;
-	gettimeofday(&start, NULL);
-
-	rd = read(hw.fd, &event, sizeof event);
-	if (rd != sizeof event) {
-		logprintf(LOG_ERR, "error reading '%s'", hw.device);
-		if (rd <= 0 && errno != EINTR) {
-			devinput_deinit();
+	if (event_pos >= event_count) {
+		event_pos = event_count = 0;
+		rd = read(hw.fd, event_buf, sizeof(event_buf));
+		if (rd <= 0 || rd % sizeof(struct input_event) != 0) {
+			logprintf(LOG_ERR, "error reading '%s'", hw.device);
+			if (rd <= 0 && errno != EINTR) {
+				devinput_deinit();
+			}
+			return 0;
 		}
-		return 0;
+		event_count = rd / sizeof(struct input_event);
 	}
 
-	LOGPRINTF(1, "time %ld.%06ld  type %d  code %d  value %d", event.time.tv_sec, event.time.tv_usec, event.type,
-		  event.code, event.value);
+	while (event_pos < event_count) {
+		event = &event_buf[event_pos++];
+
+		LOGPRINTF(1, "time %ld.%06ld  type %d  code %d  value %d", event->time.tv_sec, event->time.tv_usec,
+			  event->type, event->code, event->value);
 
-	value = (unsigned)event.value;
+		if (uinputfd != -1) {
+			if (event->type == EV_REL || event->type == EV_ABS
+			    || (event->type == EV_KEY && event->code >= BTN_MISC && event->code <= BTN_GEAR_UP)
+			    || event->type == EV_SYN) {
+				LOGPRINTF(1, "forwarding: %04x %04x", event->type, event->code);
+				fwd_buf[fwd_count++] = *event;
+				if (event->type == EV_SYN || fwd_count == EVENT_BUF_SIZE) {
+					flush_forward();
+				}
+				continue;
+			}
+		}
+
+		/* ignore EV_SYN */
+		if (event->type == EV_SYN)
+			continue;
+
+		last = end;
+		gettimeofday(&start, NULL);
+
+		value = (unsigned)event->value;
 #ifdef EV_SW
-	if (value == 2 && (event.type == EV_KEY || event.type == EV_SW)) {
-		value = 1;
-	}
-	code_compat = ((event.type == EV_KEY || event.type == EV_SW) && event.value != 0) ? 0x80000000 : 0;
+		if (value == 2 && (event->type == EV_KEY || event->type == EV_SW)) {
+			value = 1;
+		}
+		code_compat = ((event->type == EV_KEY || event->type == EV_SW) && event->value != 0) ? 0x80000000 : 0;
 #else
-	if (value == 2 && event.type == EV_KEY) {
-		value = 1;
-	}
-	code_compat = ((event.type == EV_KEY) && event.value != 0) ? 0x80000000 : 0;
+		if (value == 2 && event->type == EV_KEY) {
+			value = 1;
+		}
+		code_compat = ((event->type == EV_KEY) && event->value != 0) ? 0x80000000 : 0;
 #endif
-	code_compat |= ((event.type & 0x7fff) << 16);
-	code_compat |= event.code;
-
-	if (event.type == EV_KEY) {
-		if (event.value == 2) {
-			repeat_state = RPT_YES;
+		code_compat |= ((event->type & 0x7fff) << 16);
+		code_compat |= event->code;
+
+		if (event->type == EV_KEY) {
+			if (event->value == 2) {
+				repeat_state = RPT_YES;
+			} else {
+				repeat_state = RPT_NO;
+			}
 		} else {
-			repeat_state = RPT_NO;
+			repeat_state = RPT_UNKNOWN;
 		}
-	} else {
-		repeat_state = RPT_UNKNOWN;
-	}
 
-	code = ((ir_code) (unsigned)event.type) << 48 | ((ir_code) (unsigned)event.code) << 32 | value;
+		code = ((ir_code) (unsigned)event->type) << 48 | ((ir_code) (unsigned)event->code) << 32 | value;
 
-	LOGPRINTF(1, "code %.8llx", code);
+		LOGPRINTF(1, "code %.8llx", code);
 
-	if (uinputfd != -1) {
-		if (event.type == EV_REL || event.type == EV_ABS
-		    || (event.type == EV_KEY && event.code >= BTN_MISC && event.code <= BTN_GEAR_UP)
-		    || event.type == EV_SYN) {
-			LOGPRINTF(1, "forwarding: %04x %04x", event.type, event.code);
-			if (write(uinputfd, &event, sizeof(event)) != sizeof(event)) {
-				logprintf(LOG_ERR, "writing to uinput failed");
-				logperror(LOG_ERR, NULL);
-			}
-			return NULL;
+		gettimeofday(&end, NULL);
+		message = decode_event(remotes);
+		if (message != NULL) {
+			/* rest of the batch is handled on the next call */
+			return message;
 		}
 	}
-
-	/* ignore EV_SYN */
-	if (event.type == EV_SYN)
-		return NULL;
-
-	gettimeofday(&end, NULL);
-	return decode_all(remotes);
+	if (uinputfd != -1) {
+		flush_forward();
+	}
+	return NULL;
 }
@@ -50,6 +50,7 @@
 #include "receive.h"
 #include "transmit.h"
 #include "hw_default.h"
+#include "sample_pipe.h"
 
 #include <ftdi.h>
 
@@ -76,10 +77,9 @@ extern struct ir_remote *repeat_remote;
 static int pipe_main2tx[2] = { -1, -1 };
 static int pipe_tx2main[2] = { -1, -1 };
 
-static void parsesamples(unsigned char *buf, int n, int pipe_rxir_w)
+static void parsesamples(unsigned char *buf, int n, struct sample_writer *rx)
 {
 	int i;
-	int res;
 	lirc_t usecs;
 
 	for (i = 0; i < n; i++) {
@@ -106,19 +106,22 @@ static void parsesamples(unsigned char *buf, int n, int pipe_rxir_w)
 			usecs |= PULSE_BIT;
 		}
 
-		/* Send the sample */
-		res = write(pipe_rxir_w, &usecs, sizeof usecs);
+		/* Queue the sample */
+		sample_write(rx, usecs);
 
 		/* Remember last state */
 		laststate = curstate;
 		rxctr = 0;
 	}
+	/* Send the samples of this chunk */
+	sample_flush(rx);
 }
 
 static void child_process(int fd_rx2main, int fd_main2tx, int fd_tx2main)
 {
 	int ret;
 	struct ftdi_context ftdic;
+	struct sample_writer rx;
 
 	alarm(0);
 	signal(SIGTERM, SIG_DFL);
@@ -128,6 +131,7 @@ static void child_process(int fd_rx2main, int fd_main2tx, int fd_tx2main)
 	signal(SIGALRM, SIG_IGN);
 
 	ftdi_init(&ftdic);
+	sample_writer_init(&rx, fd_rx2main);
 
 	/* indicate we're started: */
 	ret = write(fd_tx2main, &ret, 1);
@@ -192,7 +196,7 @@ static void child_process(int fd_rx2main, int fd_main2tx, int fd_tx2main)
 			/* receive IR */
 			ret = ftdi_read_data(&ftdic, buf, RXBUFSZ);
 			if (ret > 0) {
-				parsesamples(buf, ret, fd_rx2main);
+				parsesamples(buf, ret, &rx);
 			}
 		} while (ret > 0);
 
@@ -282,6 +286,7 @@ next:
 	}
 
 	hw.fd = pipe_rx2main[0];
+	sample_reader_init();
 
 	flags = fcntl(hw.fd, F_GETFL);
 
@@ -386,15 +391,9 @@ static char *hwftdi_rec(struct ir_remote *remotes)
 
 static lirc_t hwftdi_readdata(lirc_t timeout)
 {
-	int n;
 	lirc_t res = 0;
 
-	if (!waitfordata((long)timeout)) {
-		return 0;
-	}
-
-	n = read(hw.fd, &res, sizeof res);
-	if (n != sizeof res) {
+	if (sample_read(&res, timeout) != 1) {
 		res = 0;
 	}
 
@@ -512,5 +511,7 @@ struct hardware hw_ftdi = {
 	receive_decode,		/* decode_func */
 	hwftdi_ioctl,		/* ioctl_func */
 	hwftdi_readdata,	/* readdata */
-	"ftdi"
+	"ftdi",
+	0,			/* resolution */
+	sample_pending		/* pending_func */
 };
@@ -33,6 +33,7 @@
 #include "hardware.h"
 #include "transmit.h"
 #include "receive.h"
+#include "sample_pipe.h"
 
 static int sendConn = -1;
 static pid_t child = 0;
@@ -153,6 +154,7 @@ static int iguana_init()
 			close(recv_pipe[1]);
 		} else {
 			hw.fd = recv_pipe[0];
+			sample_reader_init();
 
 			child = fork();
 			if (child == -1) {
@@ -319,17 +321,20 @@ static int iguana_ioctl(unsigned int code, void *arg)
 static lirc_t readdata(lirc_t timeout)
 {
 	lirc_t code = 0;
-	struct timeval tv = { timeout / 1000000, timeout % 1000000 };
-	fd_set fds;
 
-	FD_ZERO(&fds);
-	FD_SET(hw.fd, &fds);
-
-	/* attempt a read with a timeout using select */
-	if (select(hw.fd + 1, &fds, NULL, &fds, &tv) > 0)
+	/* the child writes all samples of a packet at once, hand out
+	   what is already buffered before waiting again */
+	switch (sample_read(&code, timeout)) {
+	case 1:
+		break;
+	case -1:
 		/* if we failed to get data return 0 */
-		if (read(hw.fd, &code, sizeof(lirc_t)) <= 0)
-			iguana_deinit();
+		iguana_deinit();
+		/* fall through */
+	default:
+		code = 0;
+		break;
+	}
 
 	return code;
 }
@@ -349,5 +354,7 @@ struct hardware hw_iguanaIR = {
 	receive_decode,		/* decode_func */
 	iguana_ioctl,		/* ioctl_func */
 	readdata,		/* readdata */
-	"iguanaIR"
+	"iguanaIR",
+	0,			/* resolution */
+	sample_pending		/* pending_func */
 };
@@ -268,6 +268,7 @@ int irlink_init(void)
 		logprintf(LOG_ERR, "Could not open the '%s' device", hw.device);
 	} else {
 		if (irlink_detect(hw.fd) == 0) {
+			init_rec_buffer();
 			return 1;
 		} else {
 			logprintf(LOG_ERR, "Failed to detect IRLink on '%s' device", hw.device);
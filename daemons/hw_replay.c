@@ -0,0 +1,247 @@
+/****************************************************************************
+ ** hw_replay.c *************************************************************
+ ****************************************************************************
+ *
+ * hw_replay.c - play back a capture file recorded with lircd --capture
+ *
+ * The device is given as file[,speed].  The samples are fed at their
+ * original pace, speed times faster, or as fast as lircd reads them
+ * if speed is 0.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <signal.h>
+
+#include "hardware.h"
+#include "ir_remote.h"
+#include "lircd.h"
+#include "receive.h"
+#include "capture.h"
+#include "sample_pipe.h"
+
+/* PID of the child process */
+static pid_t child_pid = -1;
+
+static char *replay_file = NULL;
+static double replay_speed = 1.0;
+
+static void wait_until(unsigned long long target)
+{
+	unsigned long long now;
+
+	while ((now = capture_time()) < target) {
+		unsigned long long delta = target - now;
+
+		usleep(delta > 1000000 ? 1000000 : (useconds_t) delta);
+	}
+}
+
+static void child_process(int fd)
+{
+	struct capture_header header;
+	struct sample_writer w;
+	unsigned long long value, base, target, elapsed = 0;
+	int tag, synced = 0;
+	FILE *f;
+	lirc_t data;
+
+	alarm(0);
+	signal(SIGTERM, SIG_DFL);
+	signal(SIGPIPE, SIG_DFL);
+	signal(SIGINT, SIG_DFL);
+	signal(SIGHUP, SIG_IGN);
+	signal(SIGALRM, SIG_IGN);
+
+	f = capture_open_read(replay_file, &header);
+	if (f == NULL)
+		_exit(EXIT_FAILURE);
+
+	sample_writer_init(&w, fd);
+	base = capture_time();
+	while ((tag = capture_read(f, &value)) != -1) {
+		if (tag == CAPTURE_SYNC) {
+			/* a sync timestamps the next sample itself */
+			elapsed += value;
+			synced = 1;
+			continue;
+		}
+		if (tag > CAPTURE_SYNC) {
+			logprintf(LOG_ERR, "corrupt capture file %s", replay_file);
+			break;
+		}
+		data = (lirc_t) ((tag << 24) | (value & LIRC_VALUE_MASK));
+		if (!synced && (LIRC_IS_PULSE(data) || LIRC_IS_SPACE(data))) {
+			/* the sample is delivered once its duration is over */
+			elapsed += LIRC_VALUE(data);
+		}
+		synced = 0;
+		if (replay_speed > 0) {
+			target = base + (unsigned long long)(elapsed / replay_speed);
+			if (capture_time() < target) {
+				/* hand over what is due before sleeping */
+				if (!sample_flush(&w))
+					break;
+				wait_until(target);
+			}
+		}
+		if (!sample_write(&w, data))
+			break;
+	}
+	sample_flush(&w);
+	fclose(f);
+	logprintf(LOG_INFO, "end of capture file %s", replay_file);
+
+	/* keep the pipe open so lircd does not see an endless EOF */
+	while (1)
+		pause();
+}
+
+static int replay_init(void)
+{
+	struct capture_header header;
+	int pipe_fd[2] = { -1, -1 };
+	char *sep;
+	FILE *f;
+
+	logprintf(LOG_INFO, "Initializing replay: %s", hw.device);
+
+	init_rec_buffer();
+
+	replay_file = strdup(hw.device);
+	if (replay_file == NULL) {
+		logprintf(LOG_ERR, "out of memory");
+		return (0);
+	}
+	replay_speed = 1.0;
+	sep = strrchr(replay_file, ',');
+	if (sep != NULL) {
+		char *endptr;
+
+		*sep = 0;
+		replay_speed = strtod(sep + 1, &endptr);
+		if (sep[1] == 0 || *endptr || replay_speed < 0) {
+			logprintf(LOG_ERR, "invalid replay speed: %s", sep + 1);
+			goto fail;
+		}
+	}
+
+	/* check the header before forking so errors show up here */
+	f = capture_open_read(replay_file, &header);
+	if (f == NULL)
+		goto fail;
+	fclose(f);
+	if (header.rec_mode != LIRC_MODE_MODE2) {
+		logprintf(LOG_ERR, "%s was not recorded in mode2", replay_file);
+		goto fail;
+	}
+	logprintf(LOG_INFO, "replaying capture of driver %s (%s)", header.driver, header.device);
+	hw.resolution = header.resolution;
+
+	if (pipe(pipe_fd) == -1) {
+		logprintf(LOG_ERR, "unable to create pipe");
+		goto fail;
+	}
+
+	child_pid = fork();
+	if (child_pid == -1) {
+		logprintf(LOG_ERR, "unable to fork child process");
+		close(pipe_fd[0]);
+		close(pipe_fd[1]);
+		goto fail;
+	} else if (child_pid == 0) {
+		close(pipe_fd[0]);
+		child_process(pipe_fd[1]);
+	}
+	close(pipe_fd[1]);
+	hw.fd = pipe_fd[0];
+	sample_reader_init();
+	return (1);
+
+fail:
+	free(replay_file);
+	replay_file = NULL;
+	return (0);
+}
+
+static int replay_deinit(void)
+{
+	if (child_pid != -1) {
+		/* Kill the child process, and wait for it to exit */
+		if (kill(child_pid, SIGTERM) == -1) {
+			return (0);
+		}
+		if (waitpid(child_pid, NULL, 0) == 0) {
+			return (0);
+		}
+		child_pid = -1;
+	}
+
+	close(hw.fd);
+	hw.fd = -1;
+
+	free(replay_file);
+	replay_file = NULL;
+
+	return (1);
+}
+
+static char *replay_rec(struct ir_remote *remotes)
+{
+	if (!clear_rec_buffer())
+		return (NULL);
+	return (decode_all(remotes));
+}
+
+static lirc_t replay_readdata(lirc_t timeout)
+{
+	lirc_t res = 0;
+
+	if (sample_read(&res, timeout) != 1) {
+		res = 0;
+	}
+
+	return (res);
+}
+
+struct hardware hw_replay = {
+	"lircd.capture",	/* "device" (capture file) */
+	-1,			/* fd */
+	LIRC_CAN_REC_MODE2,	/* features */
+	0,			/* send_mode */
+	LIRC_MODE_MODE2,	/* rec_mode */
+	0,			/* code_length */
+	replay_init,		/* init_func */
+	replay_deinit,		/* deinit_func */
+	NULL,			/* send_func */
+	replay_rec,		/* rec_func */
+	receive_decode,		/* decode_func */
+	NULL,			/* ioctl_func */
+	replay_readdata,	/* readdata */
+	"replay",
+	0,			/* resolution */
+	sample_pending		/* pending_func */
+};
@@ -378,6 +378,7 @@ int slinke_init(void)
 		}		/* if */
 	}			/* for */
 
+	init_rec_buffer();
 	return (1);
 }				/* slinke_init */
 
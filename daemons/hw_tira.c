@@ -76,6 +76,13 @@ static unsigned char pulse_space;	//1=pulse
 
 static ir_code code;
 
+/* how long the device may take to answer a command */
+#define TIRA_REPLY_TIMEOUT 1000000
+/* replies of unknown length are collected for this long */
+#define TIRA_VERSION_TIMEOUT 200000
+/* the Ira needs this pause between the 'I' and the command byte */
+#define IRA_COMMAND_DELAY 200000
+
 #define CODE_LENGTH 64
 struct hardware hw_tira = {
 	LIRC_IRTTY,		/* Default device */
@@ -107,7 +114,7 @@ struct hardware hw_tira_raw = {
 	NULL,			/* send_func, tira cannot
 				   transmit in timing mode */
 	tira_rec_mode2,		/* rec_func */
-	tira_decode,		/* decode_func */
+	receive_decode,		/* decode_func */
 	NULL,			/* ioctl_func */
 	tira_readdata,		/* readdata */
 	"tira_raw"
@@ -144,23 +151,15 @@ void displayonline(void)
 
 int tira_setup_sixbytes(void)
 {
-	int i;
-
 	logprintf(LOG_INFO, "Switching to 6bytes mode");
-	if (write(hw.fd, "IR", 2) != 2) {
+	if (!tty_write_all(hw.fd, "IR", 2)) {
 		logprintf(LOG_ERR, "failed switching device into six byte mode");
 		return 0;
 	}
-	/* wait for the chars to be written */
-	usleep(2 * (100 * 1000));
-
-	i = read(hw.fd, response, 2);
-	if (i != 2) {
+	if (!tty_expect(hw.fd, "OK", 2, TIRA_REPLY_TIMEOUT, response)) {
 		logprintf(LOG_ERR, "failed reading response to six byte mode command");
 		return 0;
 	}
-	if (strncmp(response, "OK", 2) != 0)
-		return 0;
 	displayonline();
 	return 1;
 }
@@ -283,7 +282,6 @@ int child_process(int pipe_w, int oldprotocol)
 int tira_setup_timing(int oldprotocol)
 {
 	long fd_flags;
-	int i;
 
 	if (oldprotocol)
 		if (!tty_setbaud(hw.fd, 57600))
@@ -291,21 +289,16 @@ int tira_setup_timing(int oldprotocol)
 
 	logprintf(LOG_INFO, "Switching to timing mode");
 	if (!oldprotocol) {
-		if (write(hw.fd, "IC\0\0", 4) != 4) {
+		if (!tty_write_all(hw.fd, "IC\0\0", 4)) {
 			logprintf(LOG_ERR, "failed switching device into timing mode");
 			return 0;
 		}
-		/* wait for the chars to be written */
-		usleep(2 * (100 * 1000));
-
-		i = read(hw.fd, response, 3);
-		if (i != 3) {
+		if (!tty_expect(hw.fd, "OIC", 3, TIRA_REPLY_TIMEOUT, response)) {
 			logprintf(LOG_ERR, "failed reading response to timing mode command");
 			return 0;
 		}
-		if (strncmp(response, "OIC", 3) != 0)
-			return 0;
 	}
+	init_rec_buffer();
 	pulse_space = 1;	//pulse
 	/* Allocate a pipe for lircd to read from */
 	if (pipe(pipe_fd) == -1) {
@@ -350,39 +343,34 @@ fail:
 
 int tira_setup(void)
 {
-	int i;
 	int ptr;
 	/* Clear the port of any random data */
-	while (read(hw.fd, &ptr, 1) >= 0) ;
+	tty_flush(hw.fd, 0);
 
 	/* Start off with the IP command. This was initially used to
 	   switch to timing mode on the Tira-1. The Tira-2 also
 	   supports this mode, however it does not switch the Tira-2
 	   into timing mode.
 	 */
-	if (write(hw.fd, "IP", 2) != 2) {
+	if (!tty_write_all(hw.fd, "IP", 2)) {
 		logprintf(LOG_ERR, failwrite);
 		return 0;
 	}
-	/* Wait till the chars are written, should use tcdrain but
-	   that don't seem to work... *shrug*
-	 */
-	usleep(2 * (100 * 1000));
-	i = read(hw.fd, response, 3);
-
-	if (strncmp(response, "OIP", 3) == 0) {
-		read(hw.fd, &ptr, 1);	/* read the calibration value */
-		read(hw.fd, &ptr, 1);	/* read the version word */
+	memset(response, 0, sizeof(response));
+	if (tty_expect(hw.fd, "OIP", 3, TIRA_REPLY_TIMEOUT, response)) {
+		/* the calibration value and the version word */
+		if (tty_read_timeout(hw.fd, response + 3, 2, TIRA_REPLY_TIMEOUT) != 2)
+			logprintf(LOG_WARNING, "no version word from device");
+		ptr = (unsigned char)response[4];
 		/* Bits 4:7 in the version word set to one indicates a
 		   Tira-2 */
 		deviceflags = ptr & 0x0f;
 		if (ptr & 0xF0) {
 			logprintf(LOG_INFO, "Tira-2 detected");
 			/* Lets get the firmware version */
-			write(hw.fd, "IV", 2);
-			usleep(2 * (100 * 1000));
 			memset(response, 0, sizeof(response));
-			i = read(hw.fd, response, sizeof(response) - 1);
+			if (tty_write_all(hw.fd, "IV", 2))
+				tty_read_timeout(hw.fd, response, sizeof(response) - 1, TIRA_VERSION_TIMEOUT);
 			logprintf(LOG_INFO, "firmware version %s", response);
 		} else {
 			logprintf(LOG_INFO, "Ira/Tira-1 detected");
@@ -406,29 +394,27 @@ int tira_setup(void)
 	return 0;
 }
 
-int ira_setup_sixbytes(unsigned char info)
+static int ira_command(char command)
 {
-	int i;
-	if (info != 0)
-		logprintf(LOG_INFO, "Switching to 6bytes mode");
-	if (write(hw.fd, "I", 1) != 1) {
+	if (!tty_write_all(hw.fd, "I", 1)) {
 		logprintf(LOG_ERR, failwrite);
 		return 0;
 	}
-	usleep(200000);
-	if (write(hw.fd, "R", 1) != 1) {
+	usleep(IRA_COMMAND_DELAY);
+	if (!tty_write_all(hw.fd, &command, 1)) {
 		logprintf(LOG_ERR, failwrite);
 		return 0;
 	}
+	return 1;
+}
 
-	/* Wait till the chars are written, should use tcdrain but
-	   that don't seem to work... *shrug*
-	 */
-	usleep(100000);
-	i = read(hw.fd, response, 2);
-	if (i != 2)
+int ira_setup_sixbytes(unsigned char info)
+{
+	if (info != 0)
+		logprintf(LOG_INFO, "Switching to 6bytes mode");
+	if (!ira_command('R'))
 		return 0;
-	if (strncmp(response, "OK", 2) != 0)
+	if (!tty_expect(hw.fd, "OK", 2, TIRA_REPLY_TIMEOUT, response))
 		return 0;
 	if (info != 0)
 		displayonline();
@@ -438,30 +424,20 @@ int ira_setup_sixbytes(unsigned char info)
 int ira_setup(void)
 {
 	int i;
-	int ptr;
+
 	/* Clear the port of any random data */
-	while (read(hw.fd, &ptr, 1) >= 0) ;
+	tty_flush(hw.fd, 0);
 
 	if (ira_setup_sixbytes(0) == 0)
 		return 0;
 
-	if (write(hw.fd, "I", 1) != 1) {
-		logprintf(LOG_ERR, failwrite);
+	if (!ira_command('P'))
 		return 0;
-	}
-	usleep(200000);
-	if (write(hw.fd, "P", 1) != 1) {
-		logprintf(LOG_ERR, failwrite);
-		return 0;
-	}
 
-	/* Wait till the chars are written, should use tcdrain but
-	   that don't seem to work... *shrug*
-	 */
+	/* the reply comes at 57600 baud */
 	if (!tty_setbaud(hw.fd, 57600))
 		return 0;
-	usleep(50000);
-	i = read(hw.fd, response, 5);
+	i = tty_read_timeout(hw.fd, response, 5, TIRA_REPLY_TIMEOUT);
 
 	if (!tty_setbaud(hw.fd, 9600))
 		return 0;
@@ -472,19 +448,10 @@ int ira_setup(void)
 		deviceflags = response[4] & 0x0f;
 		if (response[4] & 0xF0) {
 			/* Lets get the firmware version */
-			if (write(hw.fd, "I", 1) != 1) {
-				logprintf(LOG_ERR, failwrite);
-				return 0;
-			}
-			usleep(200000);
-			if (write(hw.fd, "V", 1) != 1) {
-				logprintf(LOG_ERR, failwrite);
+			if (!ira_command('V'))
 				return 0;
-			}
-
-			usleep(200000);
 			memset(response, 0, sizeof(response));
-			i = read(hw.fd, response, sizeof(response) - 1);
+			tty_read_timeout(hw.fd, response, sizeof(response) - 1, TIRA_VERSION_TIMEOUT);
 			logprintf(LOG_INFO, "Ira %s detected", response);
 		} else {
 			logprintf(LOG_INFO, "Ira-1 detected");
@@ -613,25 +580,22 @@ char *tira_rec(struct ir_remote *remotes)
 	int i, x;
 
 	last = end;
-	x = 0;
 	gettimeofday(&start, NULL);
-	for (i = 0; i < 6; i++) {
-		if (i > 0) {
-			if (!waitfordata(20000)) {
-				LOGPRINTF(0, "timeout reading byte %d", i);
-				/* likely to be !=6 bytes, so flush. */
-				tcflush(hw.fd, TCIFLUSH);
-				return NULL;
-			}
-		}
-		if (read(hw.fd, &b[i], 1) != 1) {
-			logprintf(LOG_ERR, "reading of byte %d failed.", i);
-			logperror(LOG_ERR, NULL);
-			return NULL;
-		}
-		LOGPRINTF(1, "byte %d: %02x", i, b[i]);
-		x++;
+	/* the first byte is there already, the others follow within
+	   a few milliseconds */
+	x = tty_read_timeout(hw.fd, b, 6, 6 * 20000);
+	if (x == -1) {
+		logprintf(LOG_ERR, "reading of code failed.");
+		return NULL;
+	}
+	if (x != 6) {
+		LOGPRINTF(0, "timeout reading byte %d", x);
+		/* likely to be !=6 bytes, so flush. */
+		tcflush(hw.fd, TCIFLUSH);
+		return NULL;
 	}
+	for (i = 0; i < x; i++)
+		LOGPRINTF(1, "byte %d: %02x", i, b[i]);
 	gettimeofday(&end, NULL);
 	code = 0;
 	for (i = 0; i < x; i++) {
@@ -755,24 +719,18 @@ static int tira_send(struct ir_remote *remote, struct ir_ncode *code)
 	length = 28 + tmp;
 
 	if (device_type == 'i') {
-		i = length;
-		if (write(hw.fd, wrtbuf, 1) != 1)
-			i = 0;
-		if (i != 0) {
-			usleep(200000);
-			if (write(hw.fd, &wrtbuf[1], length - 1) != length - 1) {
-				i = 0;
-			}
+		i = tty_write_all(hw.fd, wrtbuf, 1);
+		if (i) {
+			usleep(IRA_COMMAND_DELAY);
+			i = tty_write_all(hw.fd, &wrtbuf[1], length - 1);
 		}
 	} else
-		i = write(hw.fd, wrtbuf, length);
+		i = tty_write_all(hw.fd, wrtbuf, length);
 
-	if (i != length)
+	if (!i)
 		logprintf(LOG_ERR, failwrite);
 	else {
-		usleep(200000);
-		i = read(hw.fd, wrtbuf, 3);
-		if (strncmp((char *)wrtbuf, "OIX", 3) == 0)
+		if (tty_expect(hw.fd, "OIX", 3, TIRA_REPLY_TIMEOUT, NULL))
 			retval = 1;
 		else
 			logprintf(LOG_ERR, "no response from device");
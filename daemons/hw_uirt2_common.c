@@ -68,38 +68,9 @@ const int unit = UIRT2_UNIT;
 static ssize_t readagain(int fd, void *buf, size_t count)
 {
 	ssize_t rc;
-	size_t pos = 0;
-	struct timeval timeout = {.tv_sec = 0,.tv_usec = 200000 };
-	fd_set fds;
 
-	rc = read(fd, buf, count);
-
-	if (rc > 0) {
-		pos += rc;
-	}
-
-	while ((rc == -1 && errno == EAGAIN) || (rc >= 0 && pos < count)) {
-		FD_ZERO(&fds);
-		FD_SET(fd, &fds);
-
-		rc = select(fd + 1, &fds, NULL, NULL, &timeout);
-
-		if (rc == 0) {
-			/* timeout */
-			break;
-		} else if (rc == -1) {
-			/* continue for EAGAIN case */
-			continue;
-		}
-
-		rc = read(fd, ((char *)buf) + pos, count - pos);
-
-		if (rc > 0) {
-			pos += rc;
-		}
-
-	}
-	return (pos == 0) ? -1 : pos;
+	rc = tty_read_timeout(fd, buf, count, 200000);
+	return (rc <= 0) ? -1 : rc;
 }
 
 #ifdef DEBUG
@@ -127,41 +98,9 @@ static void hexdump(byte_t * buf, int len)
 }
 #endif /* DEBUG */
 
-static int mywaitfordata(uirt2_t * dev, long usec)
-{
-	int fd = dev->fd;
-	fd_set fds;
-	int maxfd = fd;
-	int ret;
-	struct timeval tv;
-
-	FD_ZERO(&fds);
-	FD_SET(fd, &fds);
-
-	tv.tv_sec = usec / 1000000;
-	tv.tv_usec = usec % 1000000;
-
-	ret = select(maxfd + 1, &fds, NULL, NULL, &tv);
-
-	if (ret <= 0) {
-		return 0;
-	} else {
-		return 1;
-	}
-}
-
 static int uirt2_readflush(uirt2_t * dev, long timeout)
 {
-	int res;
-	char c;
-
-	while (mywaitfordata(dev, timeout) > 0) {
-		res = readagain(dev->fd, &c, 1);
-		if (res < 1) {
-			return -1;
-		}
-	}
-	return 0;
+	return tty_flush(dev->fd, timeout) ? 0 : -1;
 }
 
 static byte_t checksum(byte_t * data, int len)
@@ -213,22 +152,19 @@ static int command_ext(uirt2_t * dev, const byte_t * in, byte_t * out)
 	LOGPRINTF(1, "writing command %02x", buf[0]);
 
 	HEXDUMP(tmp, len + 2);
-	res = write(dev->fd, tmp, len + 2);
-
-	if (res < len + 2) {
+	if (!tty_write_all(dev->fd, tmp, len + 2)) {
 		logprintf(LOG_ERR, "uirt2_raw: couldn't write command");
 		return -1;
 	}
 
-	LOGPRINTF(1, "wrote %d", res);
+	LOGPRINTF(1, "wrote %d", len + 2);
+
+	res = tty_read_timeout(dev->fd, out + 1, out[0], 1000000);
 
-	if (!mywaitfordata(dev, (long)1000000)) {
+	if (res == 0) {
 		logprintf(LOG_ERR, "uirt2_raw: did not receive results");
 		return -1;
 	}
-
-	res = readagain(dev->fd, out + 1, out[0]);
-
 	if (res < out[0]) {
 		logprintf(LOG_ERR, "uirt2_raw: couldn't read command result");
 		return -1;
@@ -549,29 +485,15 @@ int uirt2_refreshgpio(uirt2_t * dev)
 
 int uirt2_read_uir(uirt2_t * dev, byte_t * buf, int length)
 {
-	int pos = 0;
-	int res;
+	int pos;
 
 	if (uirt2_getmode(dev) != UIRT2_MODE_UIR) {
 		logprintf(LOG_ERR, "uirt2_raw: Not in UIR mode");
 		return -1;
 	}
 
-	while (1) {
-		res = readagain(dev->fd, buf + pos, 1);
-
-		if (res == -1) {
-			return pos;
-		}
-
-		pos += res;
-
-		if (pos == 6) {
-			break;
-		}
-	}
-
-	return pos;
+	pos = readagain(dev->fd, buf, 6);
+	return (pos == -1) ? 0 : pos;
 }
 
 lirc_t uirt2_read_raw(uirt2_t * dev, lirc_t timeout)
@@ -139,57 +139,15 @@ static int irtoy_decode(struct ir_remote *remote, ir_code * prep, ir_code * code
 static ssize_t read_with_timeout(int fd, void *buf, size_t count, long to_usec)
 {
 	ssize_t rc;
-	size_t numread = 0;
-	struct timeval timeout;
-	fd_set fds;
 
-	timeout.tv_sec = 0;
-	timeout.tv_usec = to_usec;
-
-	rc = read(fd, (char *) buf, count);
-
-	if (rc > 0) {
-		numread += rc;
-	}
-
-	while ((rc == -1 && errno == EAGAIN) || (rc >= 0 && numread < count)) {
-		FD_ZERO(&fds);
-		FD_SET(fd, &fds);
-
-		rc = select(fd + 1, &fds, NULL, NULL, &timeout);
-
-		if (rc == 0) {
-			/* timeout */
-			break;
-		} else if (rc == -1) {
-			/* continue for EAGAIN case */
-			continue;
-		}
-
-		rc = read(fd, ((char *)buf) + numread, count - numread);
-
-		if (rc > 0) {
-			numread += rc;
-		}
-
-	}
-
-	return(numread == 0) ? -1 : numread;
+	rc = tty_read_timeout(fd, buf, count, to_usec);
+	return (rc <= 0) ? -1 : rc;
 }
 
 
 static int irtoy_readflush(irtoy_t * dev, long timeout)
 {
-	int res;
-	char c;
-
-	while ((res = read_with_timeout(dev->fd, &c, 1, timeout)) == 1)
-		;
-
-	if (res != 0)
-		return -1;
-	else
-		return 0;
+	return tty_flush(dev->fd, timeout) ? 0 : -1;
 }
 
 static lirc_t irtoy_read(irtoy_t * dev, lirc_t timeout)
@@ -270,9 +228,8 @@ static int irtoy_getversion(irtoy_t *dev)
 
 
 	buf[0] = IRTOY_COMMAND_VERSION;
-	res = write(dev->fd, buf, 1);
 
-	if (res != 1) {
+	if (!tty_write_all(dev->fd, buf, 1)) {
 		logprintf(LOG_ERR, "irtoy_getversion: couldn't write command");
 		return 0;
 	}
@@ -304,13 +261,11 @@ static int irtoy_getversion(irtoy_t *dev)
 
 static int irtoy_reset(irtoy_t *dev)
 {
-	int res;
 	unsigned char buf[16];
 
 	buf[0] = IRTOY_COMMAND_RESET;
-	res = write(dev->fd, buf, 1);
 
-	if (res != 1) {
+	if (!tty_write_all(dev->fd, buf, 1)) {
 		logprintf(LOG_ERR, "irtoy_reset: couldn't write command");
 		return 0;
 	}
@@ -327,9 +282,8 @@ static int irtoy_enter_samplemode(irtoy_t *dev)
 	unsigned char buf[16];
 
 	buf[0] = IRTOY_COMMAND_SMODE_ENTER;
-	res = write(dev->fd, buf, 1);
 
-	if (res != 1) {
+	if (!tty_write_all(dev->fd, buf, 1)) {
 		logprintf(LOG_ERR, "irtoy_enter_samplemode: couldn't write command");
 		return 0;
 	}
@@ -500,9 +454,7 @@ static int irtoy_send_double_buffered(unsigned char * signals, int length)
 	int irtoyXmit;
 
 
-	res = write(dev->fd, IRTOY_COMMAND_TXSTART, sizeof(IRTOY_COMMAND_TXSTART));
-
-	if (res != sizeof(IRTOY_COMMAND_TXSTART)) {
+	if (!tty_write_all(dev->fd, IRTOY_COMMAND_TXSTART, sizeof(IRTOY_COMMAND_TXSTART))) {
 		logprintf(LOG_ERR, "irtoy_send: couldn't write command");
 		return 0;
 	}
@@ -520,9 +472,7 @@ static int irtoy_send_double_buffered(unsigned char * signals, int length)
 
 	while (numToXmit) {
 		numThisTime = (numToXmit < irToyBufLen) ? numToXmit : irToyBufLen;
-		res = write(dev->fd, txPtr, numThisTime);
-
-		if (res != numThisTime) {
+		if (!tty_write_all(dev->fd, txPtr, numThisTime)) {
 			logprintf(LOG_ERR, "irtoy_send: couldn't write command");
 			return 0;
 		}
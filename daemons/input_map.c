@@ -25,14 +25,26 @@ struct {
 	NULL, 0}
 };
 
+#define INPUT_MAP_SIZE (sizeof(input_map) / sizeof(input_map[0]) - 1)
+
+/* input_map.sh sorts the table, so we can do a binary search */
 int get_input_code(const char *name, linux_input_code * code)
 {
-	int i;
+	int lo, hi, mid, cmp;
 
-	for (i = 0; input_map[i].name != NULL; i++) {
-		if (strcasecmp(name, input_map[i].name) == 0) {
-			*code = input_map[i].code;
-			return i;
+	lo = 0;
+	hi = (int)INPUT_MAP_SIZE - 1;
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		cmp = strcasecmp(name, input_map[mid].name);
+		if (cmp == 0) {
+			*code = input_map[mid].code;
+			return mid;
+		}
+		if (cmp < 0) {
+			hi = mid - 1;
+		} else {
+			lo = mid + 1;
 		}
 	}
 	return -1;
@@ -3,7 +3,13 @@
 TYPES="KEY BTN"
 file=${1:-/usr/include/linux/input.h}
 
-for type in $TYPES; do
-	grep "^#define ${type}_" < $file|sort|sed -n --expression="s/^#define \([^ 	]*\)[ 	][ 	]*\([0-9][0-9a-fA-FxX]*\).*/{\"\1\", \2},/p"
-done
+# newer kernels keep the codes in a separate header
+if test $# -eq 0 -a -f /usr/include/linux/input-event-codes.h; then
+	file="$file /usr/include/linux/input-event-codes.h"
+fi
 
+# sorted the way strcasecmp() compares so that get_input_code() can
+# do a binary search
+for type in $TYPES; do
+	cat $file|grep "^#define ${type}_"|sed -n --expression="s/^#define \([^ 	]*\)[ 	][ 	]*\([0-9][0-9a-fA-FxX]*\).*/{\"\1\", \2},/p"
+done|awk '{ print tolower($0) "\t" $0 }'|LC_ALL=C sort -u|cut -f2
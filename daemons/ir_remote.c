@@ -17,8 +17,10 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <time.h>
 
 #include <sys/ioctl.h>
 
@@ -35,6 +37,42 @@ struct ir_remote *last_remote = NULL;
 struct ir_remote *repeat_remote = NULL;
 struct ir_ncode *repeat_code;
 
+/* incremented whenever a config is freed, so that caches built from
+   a remotes list can tell that it may no longer be valid */
+unsigned int config_generation = 0;
+
+int decode_best_fit = 0;
+int decode_fit = -1;
+lirc_t decode_lead = 0;
+struct decode_candidate decode_candidates[MAX_DECODE_CANDIDATES];
+int decode_candidate_count = 0;
+
+int decode_adaptive_order = 0;
+
+/*
+  The adaptive order is revised after every DECODE_ORDER_WINDOW
+  decoded signals. A remote only moves ahead of another one if its
+  score is higher by more than an eighth, so that two remotes that
+  are used about equally do not keep changing places.
+*/
+#define DECODE_ORDER_WINDOW 32
+
+static struct ir_remote **adaptive_order = NULL;
+static int adaptive_count = 0, adaptive_size = 0;
+static struct ir_remote *adaptive_remotes = NULL;
+static unsigned int adaptive_generation = 0;
+static unsigned int adaptive_signals = 0;
+
+/* here and not in receive.c, which not every driver links */
+int receive_buffer_size = 512;	/* RBUF_SIZE */
+lirc_t receive_noise_filter = -1;
+lirc_t receive_min_pulse = 0, receive_min_space = 0;
+lirc_t receive_max_pulse = 0, receive_max_gap = 0;
+unsigned long receive_dropped = 0;
+unsigned long receive_filtered = 0;
+unsigned long receive_bursts = 0;
+unsigned long receive_avoided = 0;
+
 extern struct hardware hw;
 
 static inline lirc_t time_left(struct timeval *current, struct timeval *last, lirc_t gap)
@@ -80,6 +118,131 @@ void get_frequency_range(struct ir_remote *remotes, unsigned int *min_freq, unsi
 	}
 }
 
+static void get_symbol_lengths(struct ir_remote *remote, lirc_t * length)
+{
+	length[SYM_PHEAD] = remote->phead;
+	length[SYM_PONE] = remote->pone;
+	length[SYM_SONE] = remote->sone;
+	length[SYM_PZERO] = remote->pzero;
+	length[SYM_SZERO] = remote->szero;
+	length[SYM_PREPEAT] = remote->prepeat;
+	length[SYM_SREPEAT] = remote->srepeat;
+	length[SYM_SONE2] = 2 * remote->sone;
+	length[SYM_PZERO2] = 2 * remote->pzero;
+}
+
+void init_symbols(struct ir_remote *remote)
+{
+	struct ir_symbols *sym = &remote->symbols;
+	lirc_t aeps = hw.resolution > remote->aeps ? hw.resolution : remote->aeps;
+	lirc_t bound[2 * SYM_CLASSES], tolerance;
+	int i, j, n;
+
+	memset(sym, 0, sizeof(*sym));
+	sym->resolution = hw.resolution;
+	sym->eps = remote->eps;
+	sym->aeps = remote->aeps;
+	get_symbol_lengths(remote, sym->length);
+
+	/* the same ranges as expect() */
+	for (i = 0, n = 0; i < SYM_CLASSES; i++) {
+		tolerance = sym->length[i] * remote->eps / 100;
+		if (tolerance < aeps)
+			tolerance = aeps;
+		sym->min[i] = sym->length[i] - tolerance;
+		sym->max[i] = sym->length[i] + tolerance;
+		bound[n++] = sym->min[i];
+		bound[n++] = sym->max[i] + 1;
+	}
+
+	/* sort and drop duplicates, there are only a few */
+	for (i = 1; i < n; i++) {
+		lirc_t val = bound[i];
+
+		for (j = i; j > 0 && bound[j - 1] > val; j--)
+			bound[j] = bound[j - 1];
+		bound[j] = val;
+	}
+	for (i = 0; i < n; i++) {
+		if (sym->bounds == 0 || bound[i] != sym->bound[sym->bounds - 1])
+			sym->bound[sym->bounds++] = bound[i];
+	}
+
+	/* interval i holds the lengths from bound[i - 1] up to bound[i] */
+	for (i = 1; i < sym->bounds; i++) {
+		for (j = 0; j < SYM_CLASSES; j++) {
+			if (sym->min[j] <= sym->bound[i - 1] && sym->bound[i - 1] <= sym->max[j])
+				sym->classes[i] |= 1 << j;
+		}
+	}
+}
+
+/* the table has to be made again if the remote or hw.resolution changed */
+int symbols_valid(struct ir_remote *remote)
+{
+	struct ir_symbols *sym = &remote->symbols;
+	lirc_t length[SYM_CLASSES];
+
+	if (sym->resolution != hw.resolution || sym->eps != remote->eps || sym->aeps != remote->aeps)
+		return 0;
+	get_symbol_lengths(remote, length);
+	return memcmp(length, sym->length, sizeof(length)) == 0;
+}
+
+/*
+  Whether every signal of the remote that receive_decode() can decode
+  begins with its header pulse or, if it is a repeat, its repeat
+  pulse. Not so e.g. if the header may be left out, merges with the
+  pulse before or is checked together with other lengths.
+*/
+static int has_lead(struct ir_remote *remote)
+{
+	if (!has_header(remote) || is_raw(remote) || is_rcmm(remote) || is_bo(remote))
+		return 0;
+	if (remote->flags & NO_HEAD_REP || has_toggle_mask(remote))
+		return 0;
+	if (has_repeat(remote) && (remote->plead != 0 || is_biphase(remote)))
+		return 0;
+	return 1;
+}
+
+/* the range expect() accepts for length */
+static void lead_range(struct ir_remote *remote, lirc_t length, lirc_t * min, lirc_t * max)
+{
+	lirc_t aeps = hw.resolution > remote->aeps ? hw.resolution : remote->aeps;
+	lirc_t tolerance = length * remote->eps / 100;
+
+	if (tolerance < aeps)
+		tolerance = aeps;
+	*min = length > tolerance ? length - tolerance : 0;
+	*max = length + tolerance;
+}
+
+void init_lead_table(struct ir_lead_table *table)
+{
+	struct ir_remote *remote;
+	int i;
+
+	table->resolution = hw.resolution;
+	for (i = 0; i < table->count; i++) {
+		remote = table->remote[i];
+		if (!has_lead(remote)) {
+			table->min_head[i] = 0;
+			table->max_head[i] = PULSE_MASK;
+			table->min_repeat[i] = 1;
+			table->max_repeat[i] = 0;
+			continue;
+		}
+		lead_range(remote, remote->phead, &table->min_head[i], &table->max_head[i]);
+		if (has_repeat(remote)) {
+			lead_range(remote, remote->prepeat, &table->min_repeat[i], &table->max_repeat[i]);
+		} else {
+			table->min_repeat[i] = 1;
+			table->max_repeat[i] = 0;
+		}
+	}
+}
+
 void get_filter_parameters(struct ir_remote *remotes, lirc_t * max_gap_lengthp, lirc_t * min_pulse_lengthp,
 			   lirc_t * min_space_lengthp, lirc_t * max_pulse_lengthp, lirc_t * max_space_lengthp)
 {
@@ -87,6 +250,7 @@ void get_filter_parameters(struct ir_remote *remotes, lirc_t * max_gap_lengthp,
 	lirc_t max_gap_length = 0;
 	lirc_t min_pulse_length = 0, min_space_length = 0;
 	lirc_t max_pulse_length = 0, max_space_length = 0;
+	int untimed = 0;
 
 	while (scan) {
 		lirc_t val;
@@ -94,12 +258,18 @@ void get_filter_parameters(struct ir_remote *remotes, lirc_t * max_gap_lengthp,
 		if (val > max_gap_length) {
 			max_gap_length = val;
 		}
+		if (scan->max_pulse_length == 0) {
+			/* no timing data, see calculate_signal_lengths() */
+			untimed = 1;
+			scan = scan->next;
+			continue;
+		}
 		val = lower_limit(scan, scan->min_pulse_length);
 		if (min_pulse_length == 0 || val < min_pulse_length) {
 			min_pulse_length = val;
 		}
 		val = lower_limit(scan, scan->min_space_length);
-		if (min_space_length == 0 || val > min_space_length) {
+		if (min_space_length == 0 || val < min_space_length) {
 			min_space_length = val;
 		}
 		val = upper_limit(scan, scan->max_pulse_length);
@@ -112,6 +282,11 @@ void get_filter_parameters(struct ir_remote *remotes, lirc_t * max_gap_lengthp,
 		}
 		scan = scan->next;
 	}
+	if (untimed) {
+		/* the limits of the other remotes would filter its signals */
+		min_pulse_length = min_space_length = 0;
+		max_pulse_length = max_space_length = 0;
+	}
 	*max_gap_lengthp = max_gap_length;
 	*min_pulse_lengthp = min_pulse_length;
 	*min_space_lengthp = min_space_length;
@@ -246,6 +421,35 @@ struct ir_ncode *get_code_by_name(struct ir_remote *remote, char *name)
 	return (0);
 }
 
+static int search_code_table(struct ir_code_table *table, ir_code key)
+{
+	int low = 0, high = table->count, mid;
+
+	while (low < high) {
+		mid = (low + high) / 2;
+		if (table->keys[mid] < key)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return (low < table->count && table->keys[low] == key ? table->index[low] : -1);
+}
+
+/* same result as the linear search in get_code(): the first code
+   that match_ir_code() accepts */
+static struct ir_ncode *find_code(struct ir_remote *remote, ir_code all)
+{
+	int index, toggled;
+
+	index = search_code_table(remote->code_table, all | remote->ignore_mask);
+	if (remote->toggle_bit_mask != 0) {
+		toggled = search_code_table(remote->code_table, (all ^ remote->toggle_bit_mask) | remote->ignore_mask);
+		if (toggled != -1 && (index == -1 || toggled < index))
+			index = toggled;
+	}
+	return (index == -1 ? NULL : &remote->codes[index]);
+}
+
 struct ir_ncode *get_code(struct ir_remote *remote, ir_code pre, ir_code code, ir_code post,
 			  ir_code * toggle_bit_mask_statep)
 {
@@ -309,7 +513,10 @@ struct ir_ncode *get_code(struct ir_remote *remote, ir_code pre, ir_code code, i
 	found_code = 0;
 	have_code = 0;
 	codes = remote->codes;
-	if (codes != NULL) {
+	if (remote->code_table != NULL) {
+		found = find_code(remote, all);
+		found_code = found != NULL;
+	} else if (codes != NULL) {
 		while (codes->name != NULL) {
 			ir_code next_all;
 
@@ -496,77 +703,409 @@ int write_message(char *buffer, size_t size, const char *remote_name, const char
 	return len;
 }
 
-char *decode_all(struct ir_remote *remotes)
+static unsigned long long decode_time(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		return (unsigned long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+	{
+		struct timeval tv;
+
+		gettimeofday(&tv, NULL);
+		return (unsigned long long)tv.tv_sec * 1000000000 + tv.tv_usec * 1000;
+	}
+}
+
+static void count_hit(struct ir_remote *remote)
+{
+	remote->decode_hits++;
+	remote->decode_recent++;
+}
+
+/* returns the current time for the next attempt */
+static unsigned long long count_miss(struct ir_remote *remote, unsigned long long start)
+{
+	unsigned long long now = decode_time();
+
+	remote->decode_misses++;
+	remote->decode_miss_time += now - start;
+	return (now);
+}
+
+static int moves_ahead(struct ir_remote *remote, struct ir_remote *ahead)
+{
+	return (remote->decode_score > ahead->decode_score + ahead->decode_score / 8);
+}
+
+static void revise_order(void)
+{
+	struct ir_remote *remote;
+	int i, j;
+
+	for (i = 1; i < adaptive_count; i++) {
+		remote = adaptive_order[i];
+		for (j = i; j > 0 && moves_ahead(remote, adaptive_order[j - 1]); j--)
+			adaptive_order[j] = adaptive_order[j - 1];
+		adaptive_order[j] = remote;
+	}
+}
+
+static void close_window(void)
 {
 	struct ir_remote *remote;
+	int i;
+
+	for (i = 0; i < adaptive_count; i++) {
+		remote = adaptive_order[i];
+		remote->decode_score = remote->decode_score / 2 + remote->decode_recent * 16;
+		remote->decode_recent = 0;
+	}
+	revise_order();
+}
+
+struct ir_remote **decode_order(struct ir_remote *remotes, int *count)
+{
+	struct ir_remote *remote, **order;
+	int n;
+
+	if (remotes != adaptive_remotes || config_generation != adaptive_generation || adaptive_order == NULL) {
+		n = 0;
+		for (remote = remotes; remote != NULL; remote = remote->next)
+			n++;
+		if (n > adaptive_size || adaptive_order == NULL) {
+			order = realloc(adaptive_order, (n > 0 ? n : 1) * sizeof(*order));
+			if (order == NULL) {
+				logprintf(LOG_ERR, "out of memory");
+				return (NULL);
+			}
+			adaptive_order = order;
+			adaptive_size = n;
+		}
+		n = 0;
+		for (remote = remotes; remote != NULL; remote = remote->next)
+			adaptive_order[n++] = remote;
+		adaptive_count = n;
+		adaptive_remotes = remotes;
+		adaptive_generation = config_generation;
+		adaptive_signals = 0;
+		/* the scores are kept in the remotes, start from them */
+		revise_order();
+	}
+	*count = adaptive_count;
+	return (adaptive_order);
+}
+
+static char *decode_found(struct ir_remote *remote, struct ir_ncode *ncode, ir_code toggle_bit_mask_state,
+			  int repeat_flag, lirc_t min_remaining_gap, lirc_t max_remaining_gap)
+{
 	static char message[PACKET_SIZE + 1];
+	ir_code code;
+	struct ir_remote *scan;
+	struct ir_ncode *scan_ncode;
+	int len;
+	int reps;
+
+	code = set_code(remote, ncode, toggle_bit_mask_state, repeat_flag, min_remaining_gap, max_remaining_gap);
+	if ((has_toggle_mask(remote) && remote->toggle_mask_state % 2) || ncode->current != NULL) {
+		decoding = NULL;
+		return (NULL);
+	}
+
+	for (scan = decoding; scan != NULL; scan = scan->next) {
+		for (scan_ncode = scan->codes; scan_ncode->name != NULL; scan_ncode++) {
+			scan_ncode->current = NULL;
+		}
+	}
+	if (is_xmp(remote)) {
+		remote->last_code->current = remote->last_code->next;
+	}
+	reps = remote->reps - (ncode->next ? 1 : 0);
+	if (reps > 0) {
+		if (reps <= remote->suppress_repeat) {
+			decoding = NULL;
+			return NULL;
+		} else {
+			reps -= remote->suppress_repeat;
+		}
+	}
+	register_button_press(remote, remote->last_code, code, reps);
+
+	len = write_message(message, PACKET_SIZE + 1, remote->name, remote->last_code->name, "", code, reps);
+	decoding = NULL;
+	if (len >= PACKET_SIZE + 1) {
+		logprintf(LOG_ERR, "message buffer overflow");
+		return (NULL);
+	} else {
+		return (message);
+	}
+}
+
+static void add_candidate(struct ir_remote *remote, struct ir_ncode *ncode, int fit, int best)
+{
+	int i, n;
+
+	n = decode_candidate_count < MAX_DECODE_CANDIDATES ? decode_candidate_count : MAX_DECODE_CANDIDATES - 1;
+	if (best) {
+		/* the winner goes first, the others keep list order */
+		for (i = n; i > 0; i--)
+			decode_candidates[i] = decode_candidates[i - 1];
+		n = 0;
+	} else if (decode_candidate_count >= MAX_DECODE_CANDIDATES) {
+		decode_candidate_count++;
+		return;
+	}
+	decode_candidates[n].remote = remote;
+	decode_candidates[n].ncode = ncode;
+	decode_candidates[n].fit = fit;
+	decode_candidate_count++;
+}
+
+/* smaller timing error wins, an unknown one only against nothing */
+static int better_fit(int fit, int best_fit)
+{
+	return fit >= 0 && (best_fit < 0 || fit < best_fit);
+}
+
+/* the lead table of remotes, up to date, NULL if there is none */
+static struct ir_lead_table *get_lead_table(struct ir_remote *remotes)
+{
+	struct ir_lead_table *table;
+
+	decode_lead = 0;
+	if (remotes == NULL || remotes->lead_table == NULL)
+		return (NULL);
+	table = remotes->lead_table;
+	if (table->remote[0] != remotes)
+		return (NULL);
+	if (table->resolution != hw.resolution)
+		init_lead_table(table);
+	return (table);
+}
+
+static inline int lead_ruled_out(struct ir_lead_table *table, int i)
+{
+	return (decode_lead != 0 && (decode_lead < table->min_head[i] || decode_lead > table->max_head[i])
+		&& (decode_lead < table->min_repeat[i] || decode_lead > table->max_repeat[i]));
+}
+
+static int ruled_out(struct ir_lead_table *table, struct ir_remote *remote)
+{
+	return (table != NULL && remote->lead_table == table && lead_ruled_out(table, remote->lead_index));
+}
+
+/* the next remote after position *i of the table that the lead
+   pulse does not rule out, then the remotes after the table */
+static struct ir_remote *next_lead(struct ir_lead_table *table, int *i, struct ir_remote **skipped)
+{
+	while (++*i < table->count) {
+		if (!lead_ruled_out(table, *i))
+			return (table->remote[*i]);
+		*skipped = table->remote[*i];
+	}
+	return (table->remote[table->count - 1]->next);
+}
+
+/*
+  A failed decode leaves the receive buffer where the last remote
+  gave up, which is where the next one starts. Skipping the last
+  remote must not change that, so it is tried after all. It fails on
+  the lead pulse like the others did.
+*/
+static void skipped_last(struct ir_remote *remote)
+{
 	ir_code pre, code, post;
-	struct ir_ncode *ncode;
 	int repeat_flag;
-	ir_code toggle_bit_mask_state;
 	lirc_t min_remaining_gap, max_remaining_gap;
-	struct ir_remote *scan;
-	struct ir_ncode *scan_ncode;
 
-	/* use remotes carefully, it may be changed on SIGHUP */
+	if (remote != NULL)
+		hw.decode_func(remote, &pre, &code, &post, &repeat_flag, &min_remaining_gap, &max_remaining_gap);
+}
+
+static char *decode_best(struct ir_remote *remotes)
+{
+	struct ir_remote *remote, *best = NULL, *tried = NULL;
+	ir_code pre, code, post;
+	struct ir_ncode *ncode, *best_ncode = NULL;
+	int repeat_flag, best_repeat_flag = 0;
+	ir_code toggle_bit_mask_state, best_toggle_bit_mask_state = 0;
+	lirc_t min_remaining_gap, max_remaining_gap, best_min_remaining_gap = 0, best_max_remaining_gap = 0;
+	int fit, best_fit = -1, i;
+	unsigned long long start;
+	struct ir_lead_table *table;
+	struct ir_remote *skipped = NULL;
+
+	decode_candidate_count = 0;
+	table = get_lead_table(remotes);
 	decoding = remote = remotes;
+	start = decode_time();
 	while (remote) {
+		if (ruled_out(table, remote)) {
+			skipped = remote;
+			remote = remote->next;
+			continue;
+		}
+		skipped = NULL;
 		LOGPRINTF(1, "trying \"%s\" remote", remote->name);
 
+		decode_fit = -1;
+		tried = remote;
 		if (hw.decode_func(remote, &pre, &code, &post, &repeat_flag, &min_remaining_gap, &max_remaining_gap)
 		    && (ncode = get_code(remote, pre, code, post, &toggle_bit_mask_state))) {
-			int len;
-			int reps;
-
-			code =
-			    set_code(remote, ncode, toggle_bit_mask_state, repeat_flag, min_remaining_gap,
-				     max_remaining_gap);
-			if ((has_toggle_mask(remote) && remote->toggle_mask_state % 2) || ncode->current != NULL) {
-				decoding = NULL;
-				return (NULL);
+			fit = decode_fit;
+			LOGPRINTF(1, "candidate \"%s\" remote, fit %d", remote->name, fit);
+			if (best == NULL || better_fit(fit, best_fit)) {
+				best = remote;
+				best_ncode = ncode;
+				best_fit = fit;
+				best_toggle_bit_mask_state = toggle_bit_mask_state;
+				best_repeat_flag = repeat_flag;
+				best_min_remaining_gap = min_remaining_gap;
+				best_max_remaining_gap = max_remaining_gap;
+				add_candidate(remote, ncode, fit, 1);
+			} else {
+				add_candidate(remote, ncode, fit, 0);
 			}
+			start = decode_time();
+		} else {
+			LOGPRINTF(1, "failed \"%s\" remote", remote->name);
+			remote->toggle_mask_state = 0;
+			start = count_miss(remote, start);
+		}
+		remote = remote->next;
+	}
+	if (best == NULL) {
+		skipped_last(skipped);
+		decoding = NULL;
+		last_remote = NULL;
+		LOGPRINTF(1, "decoding failed for all remotes");
+		return (NULL);
+	}
+	for (i = 1; i < decode_candidate_count && i < MAX_DECODE_CANDIDATES; i++)
+		decode_candidates[i].remote->toggle_mask_state = 0;
+
+	if (best != tried) {
+		int toggle_mask_state = best->toggle_mask_state;
+		struct ir_ncode *toggle_code = best->toggle_code;
+
+		/* the samples following the signal are where the next
+		   decode starts, so leave the buffer as the winner's
+		   decode left it, not as the last attempt did, whether
+		   that one succeeded or not */
+		if (hw.decode_func(best, &pre, &code, &post, &repeat_flag, &min_remaining_gap, &max_remaining_gap)) {
+			best_min_remaining_gap = min_remaining_gap;
+			best_max_remaining_gap = max_remaining_gap;
+		}
+		best->toggle_mask_state = toggle_mask_state;
+		best->toggle_code = toggle_code;
+	}
+	LOGPRINTF(1, "found \"%s\" remote out of %d", best->name, decode_candidate_count);
+	count_hit(best);
+	return decode_found(best, best_ncode, best_toggle_bit_mask_state, best_repeat_flag, best_min_remaining_gap,
+			    best_max_remaining_gap);
+}
 
-			for (scan = decoding; scan != NULL; scan = scan->next) {
-				for (scan_ncode = scan->codes; scan_ncode->name != NULL; scan_ncode++) {
-					scan_ncode->current = NULL;
-				}
-			}
-			if (is_xmp(remote)) {
-				remote->last_code->current = remote->last_code->next;
-			}
-			reps = remote->reps - (ncode->next ? 1 : 0);
-			if (reps > 0) {
-				if (reps <= remote->suppress_repeat) {
-					decoding = NULL;
-					return NULL;
-				} else {
-					reps -= remote->suppress_repeat;
-				}
-			}
-			register_button_press(remote, remote->last_code, code, reps);
+char *decode_all(struct ir_remote *remotes)
+{
+	struct ir_remote *remote;
+	ir_code pre, code, post;
+	struct ir_ncode *ncode;
+	int repeat_flag;
+	ir_code toggle_bit_mask_state;
+	lirc_t min_remaining_gap, max_remaining_gap;
+	struct ir_remote **order = NULL;
+	int i = 0, count = 0;
+	unsigned long long start;
+	struct ir_lead_table *table;
+	struct ir_remote *skipped = NULL;
 
-			len =
-			    write_message(message, PACKET_SIZE + 1, remote->name, remote->last_code->name, "", code,
-					  reps);
-			decoding = NULL;
-			if (len >= PACKET_SIZE + 1) {
-				logprintf(LOG_ERR, "message buffer overflow");
-				return (NULL);
-			} else {
-				return (message);
+	if (decode_best_fit)
+		return decode_best(remotes);
+
+	if (decode_adaptive_order)
+		order = decode_order(remotes, &count);
+
+	/* use remotes carefully, it may be changed on SIGHUP */
+	decoding = remotes;
+	table = get_lead_table(remotes);
+	if (order != NULL) {
+		remote = count > 0 ? order[0] : NULL;
+	} else if (table != NULL) {
+		/* walk the table, it only touches the remotes it can't
+		   rule out */
+		i = -1;
+		remote = next_lead(table, &i, &skipped);
+	} else {
+		remote = remotes;
+	}
+	start = decode_time();
+	while (remote) {
+		if (order != NULL && ruled_out(table, remote)) {
+			skipped = remote;
+			remote = ++i < count ? order[i] : NULL;
+			continue;
+		}
+		skipped = NULL;
+		LOGPRINTF(1, "trying \"%s\" remote", remote->name);
+
+		if (hw.decode_func(remote, &pre, &code, &post, &repeat_flag, &min_remaining_gap, &max_remaining_gap)
+		    && (ncode = get_code(remote, pre, code, post, &toggle_bit_mask_state))) {
+			count_hit(remote);
+			if (order != NULL && ++adaptive_signals >= DECODE_ORDER_WINDOW) {
+				adaptive_signals = 0;
+				close_window();
 			}
+			return decode_found(remote, ncode, toggle_bit_mask_state, repeat_flag, min_remaining_gap,
+					    max_remaining_gap);
 		} else {
 			LOGPRINTF(1, "failed \"%s\" remote", remote->name);
 		}
+		start = count_miss(remote, start);
 		remote->toggle_mask_state = 0;
-		remote = remote->next;
+		if (order != NULL) {
+			remote = ++i < count ? order[i] : NULL;
+		} else if (table != NULL && i < table->count) {
+			remote = next_lead(table, &i, &skipped);
+		} else {
+			remote = remote->next;
+		}
 	}
+	skipped_last(skipped);
 	decoding = NULL;
 	last_remote = NULL;
 	LOGPRINTF(1, "decoding failed for all remotes");
 	return (NULL);
 }
 
+/*
+  Like decode_all() but for drivers that already know which remote
+  and button a code belongs to (e.g. from a lookup table), so the
+  linear scan over all remotes can be skipped. The lookup must give
+  the same answer decode_all() would, i.e. the first match in list
+  order; it is only valid for remotes without toggle masks, ignore
+  masks or code sequences. A NULL remote means no remote matches.
+*/
+char *decode_ncode(struct ir_remote *remotes, struct ir_remote *remote, struct ir_ncode *ncode)
+{
+	ir_code pre, code, post;
+	int repeat_flag;
+	lirc_t min_remaining_gap, max_remaining_gap;
+
+	decoding = remotes;
+	if (remote == NULL
+	    || !hw.decode_func(remote, &pre, &code, &post, &repeat_flag, &min_remaining_gap, &max_remaining_gap)) {
+		decoding = NULL;
+		last_remote = NULL;
+		LOGPRINTF(1, "decoding failed for all remotes");
+		return (NULL);
+	}
+	LOGPRINTF(1, "found \"%s\" remote", remote->name);
+	count_hit(remote);
+	return decode_found(remote, ncode, 0, repeat_flag, min_remaining_gap, max_remaining_gap);
+}
+
 int send_ir_ncode(struct ir_remote *remote, struct ir_ncode *code)
 {
 	int ret;
@@ -27,6 +27,66 @@
 #include "ir_remote_types.h"
 
 extern struct hardware hw;
+extern unsigned int config_generation;
+
+/*
+  Best fit decoding: decode_all() tries every remote instead of
+  stopping at the first one that decodes a signal. decode_func sets
+  decode_fit to the mean timing error of the samples it matched (in
+  permille, -1 if unknown) and the remote with the smallest error
+  wins. All remotes that decoded the signal are listed in
+  decode_candidates, the winner first.
+*/
+#define MAX_DECODE_CANDIDATES 8
+
+struct decode_candidate {
+	struct ir_remote *remote;
+	struct ir_ncode *ncode;
+	int fit;
+};
+
+extern int decode_best_fit;
+extern int decode_fit;
+extern struct decode_candidate decode_candidates[MAX_DECODE_CANDIDATES];
+extern int decode_candidate_count;
+
+/*
+  Adaptive order: without best fit decoding, decode_all() tries the
+  remotes in list order and stops at the first one that decodes a
+  signal. With decode_adaptive_order the remotes that decoded most
+  signals lately are tried first. Every remote counts its hits and
+  misses and the time the misses took. decode_order() returns the
+  remotes in the order they are tried, NULL if it is out of memory.
+*/
+extern int decode_adaptive_order;
+
+/*
+  receive_decode() sets decode_lead to the first pulse after the
+  sync space once it is in the receive buffer. It is the same for
+  every remote tried on a signal, so decode_all() skips the remotes
+  whose lead_table ranges it is outside of. 0 if not known yet.
+*/
+extern lirc_t decode_lead;
+
+struct ir_remote **decode_order(struct ir_remote *remotes, int *count);
+
+/*
+  Settings and counters of the receive buffer and its noise filter
+  in receive.c. The filter drops pulses shorter than receive_min_pulse
+  or longer than receive_max_pulse and spaces shorter than
+  receive_min_space, a limit of 0 disables that check. lircd derives
+  the limits from the config file unless receive_noise_filter is 0,
+  a positive receive_noise_filter replaces receive_min_pulse.
+*/
+extern int receive_buffer_size;
+extern lirc_t receive_noise_filter;
+extern lirc_t receive_min_pulse, receive_min_space;
+extern lirc_t receive_max_pulse, receive_max_gap;
+extern unsigned long receive_dropped;
+extern unsigned long receive_filtered;	/* pulses and spaces too short */
+extern unsigned long receive_bursts;	/* pulses too long */
+extern unsigned long receive_avoided;	/* noise in a gap, each would have
+					   been decoded on its own */
 
 static inline ir_code get_ir_code(struct ir_ncode *ncode, struct ir_code_node *node)
 {
@@ -93,6 +153,7 @@ static inline void set_protocol(struct ir_remote *remote, int protocol)
 {
 	remote->flags &= ~(IR_PROTOCOL_MASK);
 	remote->flags |= protocol;
+	remote->bit_decoder = BIT_DECODER_GENERIC;
 }
 
 static inline int is_raw(struct ir_remote *remote)
@@ -373,6 +434,9 @@ static inline ir_code gen_ir_code(struct ir_remote *remote, ir_code pre, ir_code
 }
 
 void get_frequency_range(struct ir_remote *remotes, unsigned int *min_freq, unsigned int *max_freq);
+void init_symbols(struct ir_remote *remote);
+int symbols_valid(struct ir_remote *remote);
+void init_lead_table(struct ir_lead_table *table);
 void get_filter_parameters(struct ir_remote *remotes, lirc_t * max_gap_lengthp, lirc_t * min_pulse_lengthp,
 			   lirc_t * min_space_lengthp, lirc_t * max_pulse_lengthp, lirc_t * max_space_lengthp);
 struct ir_remote *is_in_remotes(struct ir_remote *remotes, struct ir_remote *remote);
@@ -389,6 +453,7 @@ __u64 set_code(struct ir_remote *remote, struct ir_ncode *found, ir_code toggle_
 int write_message(char *buffer, size_t size, const char *remote_name, const char *button_name,
 		  const char *button_suffix, ir_code code, int reps);
 char *decode_all(struct ir_remote *remotes);
+char *decode_ncode(struct ir_remote *remotes, struct ir_remote *remote, struct ir_ncode *ncode);
 int send_ir_ncode(struct ir_remote *remote, struct ir_ncode *code);
 
 #endif
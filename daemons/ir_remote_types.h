@@ -44,6 +44,37 @@ struct ir_ncode {
 	struct ir_code_node *transmit_state;
 };
 
+/*
+  Sorted lookup table for the codes of a remote, only built for
+  remotes without code sequences. keys[i] is the complete code
+  including pre and post data with the ignore mask set, index[i] the
+  position of the code in the codes array. Equal keys are sorted by
+  position.
+*/
+
+struct ir_code_table {
+	int count;
+	ir_code *keys;
+	int *index;
+};
+
+/*
+  The first pulse each remote of a config file can begin a signal
+  with, one array per field and the remotes in list order, so that
+  decode_all() can rule out remotes without touching them. Remotes
+  whose signals may begin some other way accept any pulse, a repeat
+  range with min > max is empty. The ranges are those expect() uses
+  for hw.resolution. See init_lead_table().
+*/
+
+struct ir_lead_table {
+	int count;
+	lirc_t resolution;	/* what the ranges were made for */
+	struct ir_remote **remote;
+	lirc_t *min_head, *max_head;
+	lirc_t *min_repeat, *max_repeat;
+};
+
 /*
   struct ir_remote
   defines the encoding of a remote control 
@@ -92,6 +123,40 @@ struct ir_ncode {
 #define IR_PARITY_EVEN 1
 #define IR_PARITY_ODD  2
 
+/* decoders for the data bits, see get_data() in receive.c */
+#define BIT_DECODER_GENERIC   0
+#define BIT_DECODER_SPACE_ENC 1	/* NEC, Sony SIRC, ... */
+#define BIT_DECODER_BIPHASE   2	/* RC-5, RC-6 */
+
+/* duration classes of struct ir_symbols */
+#define SYM_PHEAD   0
+#define SYM_PONE    1
+#define SYM_SONE    2
+#define SYM_PZERO   3
+#define SYM_SZERO   4
+#define SYM_PREPEAT 5
+#define SYM_SREPEAT 6
+#define SYM_SONE2   7		/* RC-6 bits of double length */
+#define SYM_PZERO2  8
+#define SYM_CLASSES 9
+
+/*
+  The pulse and space lengths the bit decoders expect and the range
+  of received lengths expect() accepts for each. Sorted, the borders
+  of the ranges split the lengths into intervals whose lengths belong
+  to the same classes, so classifying a received length takes one
+  binary search. See init_symbols().
+*/
+struct ir_symbols {
+	lirc_t resolution;	/* what the table was made for */
+	int eps, aeps;
+	lirc_t length[SYM_CLASSES];
+	lirc_t min[SYM_CLASSES], max[SYM_CLASSES];
+	int bounds;
+	lirc_t bound[2 * SYM_CLASSES];	/* interval i ends before bound[i] */
+	__u32 classes[2 * SYM_CLASSES + 1];	/* bit mask of each interval */
+};
+
 struct ir_remote {
 	char *name;		/* name of remote control */
 	struct ir_ncode *codes;
@@ -183,7 +248,29 @@ struct ir_remote {
 	lirc_t max_gap_length;	/* how long is the longest gap */
 	lirc_t min_pulse_length, max_pulse_length;
 	lirc_t min_space_length, max_space_length;
+	int bit_decoder;	/* BIT_DECODER_*, chosen by the config
+				   file parser */
+	struct ir_symbols symbols;	/* only for bit_decoder */
 	int release_detected;	/* set by release generator */
+	struct ir_code_table *code_table;	/* NULL: search codes */
+	struct ir_lead_table *lead_table;	/* of the whole config,
+						   NULL: try every remote */
+	int lead_index;		/* position in lead_table */
+	unsigned long decode_hits;	/* signals decoded */
+	unsigned long decode_misses;	/* signals tried but not decoded */
+	unsigned long long decode_miss_time;	/* nsecs spent on misses */
+	unsigned int decode_recent;	/* hits in the current window */
+	unsigned int decode_score;	/* decaying sum of the windows,
+					   for decode_adaptive_order */
+	int index;		/* position in the list, numbered
+				   by lircd, -1 once the config is
+				   replaced */
+	int button_base;	/* buttons of the remotes before it,
+				   for lircd's SUBSCRIBE, -1 once
+				   the config is replaced */
+	struct config_arena *arena;	/* memory of a parsed config file,
+					   NULL if the remote was put
+					   together with malloc() */
 	struct ir_remote *next;
 };
 
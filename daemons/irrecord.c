@@ -902,6 +902,10 @@ int waitfordata(__u32 maxusec)
 	int ret;
 	struct timeval tv;
 
+	/* the driver may already hold samples it has read */
+	if (hw.pending_func && hw.pending_func())
+		return (1);
+
 	while (1) {
 		FD_ZERO(&fds);
 		FD_SET(hw.fd, &fds);
@@ -939,6 +943,9 @@ int availabledata(void)
 	int ret;
 	struct timeval tv;
 
+	if (hw.pending_func && hw.pending_func())
+		return (1);
+
 	FD_ZERO(&fds);
 	FD_SET(hw.fd, &fds);
 	do {
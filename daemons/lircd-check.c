@@ -0,0 +1,788 @@
+/****************************************************************************
+ ** lircd-check.c ***********************************************************
+ ****************************************************************************
+ *
+ * lircd-check - validate a set of lircd config files at once
+ *
+ * Every file is parsed the way lircd parses it, written back with the
+ * code irrecord uses for its output and parsed again.  Afterwards the
+ * remotes of all files are compared with each other to find remotes
+ * that would decode the same signal.
+ *
+ * The parser keeps its state in globals, so the files are spread over
+ * worker processes instead of threads.  Each worker writes its results
+ * to a temporary file the parent reads when all workers are done.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <syslog.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include "hardware.h"
+#include "dump_config.h"
+#include "ir_remote.h"
+#include "config_file.h"
+
+#define LIRCD_CHECK_VERSION "$Revision: 1.1 $"
+#define MAX_JOBS 64
+#define TIMINGS 18
+
+struct check_file {
+	char *path;
+	int done;
+	int failed;
+	int remotes;
+	char *messages;
+	size_t messages_len;
+};
+
+struct check_code {
+	char *name;
+	ir_code code;		/* in transmission order */
+	int length;		/* raw codes only */
+	lirc_t *signals;
+};
+
+struct check_remote {
+	int file;
+	char *name;
+	int protocol;
+	int bits;
+	int eps;
+	lirc_t aeps;
+	ir_code mask;		/* bits that may differ */
+	ir_code rc6_mask;
+	lirc_t timing[TIMINGS];
+	int codes;
+	struct check_code *code;
+};
+
+char *progname;
+const char *usage = "Usage: %s [options] file|directory ...\n";
+struct hardware hw = {
+	"/dev/null",		/* default device */
+	-1,			/* fd */
+	0,			/* features */
+	0,			/* send_mode */
+	0,			/* rec_mode */
+	0,			/* code_length */
+	NULL,			/* init_func */
+	NULL,			/* deinit_func */
+	NULL,			/* send_func */
+	NULL,			/* rec_func */
+	NULL,			/* decode_func */
+	NULL,			/* ioctl_func */
+	NULL,			/* readdata */
+	"lircd-check",		/* name */
+	0,			/* resolution */
+	NULL			/* pending_func */
+};
+
+int debug = 0;
+FILE *lf = NULL;
+char *hostname = "";
+int daemonized = 0;
+
+static struct check_file *files = NULL;
+static int nr_files = 0;
+static struct check_remote *remotes = NULL;
+static int nr_remotes = 0;
+static int verbose = 0;
+
+/* worker state */
+static FILE *results = NULL;
+static int current_file = -1;
+static const char *context = "";
+
+void logprintf(int prio, const char *format_str, ...)
+{
+	va_list ap;
+	char message[1024], *nl;
+
+	/* the dump repeats the warnings of the original */
+	if (*context && prio == LOG_WARNING)
+		return;
+	va_start(ap, format_str);
+	vsnprintf(message, sizeof(message), format_str, ap);
+	va_end(ap);
+	while ((nl = strchr(message, '\n')) != NULL)
+		*nl = ' ';
+
+	if (results != NULL && current_file >= 0) {
+		fprintf(results, "M\t%d\t%s%s%s\n", current_file, prio == LOG_WARNING ? "WARNING: " : "", context,
+			message);
+	} else {
+		fprintf(stderr, "%s: %s%s\n", progname, prio == LOG_WARNING ? "WARNING: " : "", message);
+	}
+}
+
+void logperror(int prio, const char *s)
+{
+	if (s != NULL) {
+		logprintf(prio, "%s: %s", s, strerror(errno));
+	} else {
+		logprintf(prio, "%s", strerror(errno));
+	}
+}
+
+static void *check_malloc(size_t size)
+{
+	void *ptr;
+
+	ptr = malloc(size);
+	if (ptr == NULL) {
+		fprintf(stderr, "%s: out of memory\n", progname);
+		exit(EXIT_FAILURE);
+	}
+	return ptr;
+}
+
+static char *check_strdup(const char *s)
+{
+	return strcpy(check_malloc(strlen(s) + 1), s);
+}
+
+static void add_file(const char *path)
+{
+	static int size = 0;
+
+	if (nr_files == size) {
+		size = size ? 2 * size : 64;
+		files = realloc(files, size * sizeof(*files));
+		if (files == NULL) {
+			fprintf(stderr, "%s: out of memory\n", progname);
+			exit(EXIT_FAILURE);
+		}
+	}
+	memset(&files[nr_files], 0, sizeof(files[nr_files]));
+	files[nr_files].path = check_strdup(path);
+	nr_files++;
+}
+
+/* in directories only look at what looks like an lircd config */
+static int is_config_name(const char *name)
+{
+	size_t len = strlen(name);
+
+	if (name[0] == '.' || strncmp(name, "lircmd", 6) == 0)
+		return 0;
+	return strncmp(name, "lircd.conf", 10) == 0 || (len > 5 && strcmp(name + len - 5, ".conf") == 0);
+}
+
+static int add_path(const char *path, int explicit)
+{
+	struct stat s;
+	DIR *dir;
+	struct dirent *entry;
+	char *sub;
+
+	if (stat(path, &s) == -1) {
+		fprintf(stderr, "%s: could not stat %s: %s\n", progname, path, strerror(errno));
+		return 0;
+	}
+	if (!S_ISDIR(s.st_mode)) {
+		if (explicit || is_config_name(strrchr(path, '/') ? strrchr(path, '/') + 1 : path))
+			add_file(path);
+		return 1;
+	}
+	dir = opendir(path);
+	if (dir == NULL) {
+		fprintf(stderr, "%s: could not open %s: %s\n", progname, path, strerror(errno));
+		return 0;
+	}
+	while ((entry = readdir(dir)) != NULL) {
+		if (entry->d_name[0] == '.')
+			continue;
+		sub = check_malloc(strlen(path) + strlen(entry->d_name) + 2);
+		sprintf(sub, "%s/%s", path, entry->d_name);
+		add_path(sub, 0);
+		free(sub);
+	}
+	closedir(dir);
+	return 1;
+}
+
+static int compare_files(const void *a, const void *b)
+{
+	return strcmp(((const struct check_file *)a)->path, ((const struct check_file *)b)->path);
+}
+
+/*
+  worker side
+*/
+
+/* bring a complete code into the order the bits are sent in */
+static ir_code wire_code(struct ir_remote *remote, ir_code code)
+{
+	ir_code pre, data, post;
+
+	if (!(remote->flags & REVERSE))
+		return code;
+	post = code & gen_mask(remote->post_data_bits);
+	code >>= remote->post_data_bits;
+	data = code & gen_mask(remote->bits);
+	code = remote->bits < 64 ? code >> remote->bits : 0;
+	pre = code & gen_mask(remote->pre_data_bits);
+	return gen_ir_code(remote, reverse(pre, remote->pre_data_bits), reverse(data, remote->bits),
+			   reverse(post, remote->post_data_bits));
+}
+
+static void report_remote(struct ir_remote *remote)
+{
+	struct ir_ncode *code;
+	int i;
+
+	fprintf(results, "R\t%d\t%d\t%d\t%d\t%d\t%llx\t%llx\t", current_file, remote->flags & IR_PROTOCOL_MASK,
+		bit_count(remote), remote->eps, (int)remote->aeps,
+		(unsigned long long)wire_code(remote, remote->toggle_bit_mask | remote->ignore_mask),
+		(unsigned long long)remote->rc6_mask);
+	fprintf(results, "%u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u\t%s\n",
+		(__u32) remote->phead, (__u32) remote->shead, (__u32) remote->pthree, (__u32) remote->sthree,
+		(__u32) remote->ptwo, (__u32) remote->stwo, (__u32) remote->pone, (__u32) remote->sone,
+		(__u32) remote->pzero, (__u32) remote->szero, (__u32) remote->plead, (__u32) remote->ptrail,
+		(__u32) remote->pfoot, (__u32) remote->sfoot, (__u32) remote->pre_p, (__u32) remote->pre_s,
+		(__u32) remote->post_p, (__u32) remote->post_s, remote->name);
+	for (code = remote->codes; code->name != NULL; code++) {
+		if (is_raw(remote)) {
+			fprintf(results, "W\t%d\t", code->length);
+			for (i = 0; i < code->length; i++)
+				fprintf(results, "%s%u", i ? " " : "", (__u32) code->signals[i]);
+			fprintf(results, "\t%s\n", code->name);
+		} else {
+			fprintf(results, "C\t%llx\t%s\n",
+				(unsigned long long)wire_code(remote, gen_ir_code(remote, remote->pre_data, code->code,
+										  remote->post_data)), code->name);
+		}
+	}
+}
+
+/* the dump of a config without the comments, they contain the time */
+static char *read_dump(FILE * f)
+{
+	char line[1024], *text;
+	size_t len = 0, size = 4096;
+
+	text = check_malloc(size);
+	text[0] = 0;
+	rewind(f);
+	while (fgets(line, sizeof(line), f) != NULL) {
+		size_t n = strlen(line);
+
+		if (line[0] == '#')
+			continue;
+		if (len + n + 1 > size) {
+			size = 2 * (len + n + 1);
+			text = realloc(text, size);
+			if (text == NULL) {
+				fprintf(stderr, "%s: out of memory\n", progname);
+				exit(EXIT_FAILURE);
+			}
+		}
+		memcpy(text + len, line, n + 1);
+		len += n;
+	}
+	rewind(f);
+	return text;
+}
+
+static void report_difference(const char *first, const char *second)
+{
+	int line = 1;
+	const char *end1, *end2;
+
+	while (*first && *second) {
+		end1 = strchr(first, '\n');
+		end2 = strchr(second, '\n');
+		if (end1 == NULL || end2 == NULL || end1 - first != end2 - second
+		    || strncmp(first, second, end1 - first) != 0)
+			break;
+		first = end1 + 1;
+		second = end2 + 1;
+		line++;
+	}
+	end1 = strchr(first, '\n');
+	end2 = strchr(second, '\n');
+	logprintf(LOG_ERR, "round trip changes dump line %d from \"%.*s\" to \"%.*s\"", line,
+		  end1 ? (int)(end1 - first) : (int)strlen(first), first,
+		  end2 ? (int)(end2 - second) : (int)strlen(second), second);
+}
+
+static int round_trip(struct ir_remote *config, const char *path)
+{
+	FILE *dump;
+	struct ir_remote *reparsed;
+	char *first, *second;
+	int ok = 0;
+
+	dump = tmpfile();
+	if (dump == NULL) {
+		logperror(LOG_ERR, "tmpfile()");
+		return 0;
+	}
+	fprint_remotes(dump, config);
+	fflush(dump);
+	first = read_dump(dump);
+
+	context = "round trip: ";
+	reparsed = read_config(dump, path);
+	fclose(dump);
+	if (reparsed == (void *)-1 || reparsed == NULL) {
+		logprintf(LOG_ERR, "dumped config could not be parsed");
+	} else {
+		dump = tmpfile();
+		if (dump == NULL) {
+			logperror(LOG_ERR, "tmpfile()");
+		} else {
+			fprint_remotes(dump, reparsed);
+			fflush(dump);
+			second = read_dump(dump);
+			fclose(dump);
+			if (strcmp(first, second) == 0)
+				ok = 1;
+			else
+				report_difference(first, second);
+			free(second);
+		}
+		free_config(reparsed);
+	}
+	context = "";
+	free(first);
+	return ok;
+}
+
+static void check_file(int index)
+{
+	FILE *f;
+	struct ir_remote *config, *remote;
+	int failed = 1, count = 0;
+
+	current_file = index;
+	f = fopen(files[index].path, "r");
+	if (f == NULL) {
+		logperror(LOG_ERR, "could not open config file");
+	} else {
+		/* sanity checks and signal lengths are part of parsing */
+		config = read_config(f, files[index].path);
+		fclose(f);
+		if (config == (void *)-1) {
+			/* the parser has said why */
+		} else if (config == NULL) {
+			logprintf(LOG_WARNING, "config file contains no valid remote control definition");
+			failed = 0;
+		} else {
+			for (remote = config; remote != NULL; remote = remote->next) {
+				report_remote(remote);
+				count++;
+			}
+			failed = !round_trip(config, files[index].path);
+			free_config(config);
+		}
+	}
+	fprintf(results, "F\t%d\t%d\t%d\n", index, failed, count);
+	current_file = -1;
+}
+
+static void worker(int job, int jobs)
+{
+	int i;
+
+	for (i = job; i < nr_files; i += jobs)
+		check_file(i);
+	fflush(results);
+	_exit(ferror(results) ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/*
+  parent side
+*/
+
+static char *read_line(FILE * f)
+{
+	static char *line = NULL;
+	static size_t size = 0;
+	size_t len = 0;
+
+	if (line == NULL) {
+		size = 4096;
+		line = check_malloc(size);
+	}
+	while (fgets(line + len, size - len, f) != NULL) {
+		len += strlen(line + len);
+		if (len > 0 && line[len - 1] == '\n') {
+			line[len - 1] = 0;
+			return line;
+		}
+		size *= 2;
+		line = realloc(line, size);
+		if (line == NULL) {
+			fprintf(stderr, "%s: out of memory\n", progname);
+			exit(EXIT_FAILURE);
+		}
+	}
+	return len > 0 ? line : NULL;
+}
+
+static void add_message(struct check_file *file, const char *message)
+{
+	size_t n = strlen(message);
+
+	file->messages = realloc(file->messages, file->messages_len + n + 2);
+	if (file->messages == NULL) {
+		fprintf(stderr, "%s: out of memory\n", progname);
+		exit(EXIT_FAILURE);
+	}
+	memcpy(file->messages + file->messages_len, message, n);
+	file->messages_len += n;
+	file->messages[file->messages_len++] = '\n';
+	file->messages[file->messages_len] = 0;
+}
+
+static struct check_code *add_code(struct check_remote *remote)
+{
+	struct check_code *code;
+
+	/* codes grow in powers of two */
+	if ((remote->codes & (remote->codes - 1)) == 0) {
+		remote->code = realloc(remote->code, (remote->codes ? 2 * remote->codes : 1) * sizeof(*remote->code));
+		if (remote->code == NULL) {
+			fprintf(stderr, "%s: out of memory\n", progname);
+			exit(EXIT_FAILURE);
+		}
+	}
+	code = &remote->code[remote->codes++];
+	memset(code, 0, sizeof(*code));
+	return code;
+}
+
+static int read_results(FILE * f)
+{
+	static int size = 0;
+	struct check_remote *remote = NULL;
+	struct check_code *code;
+	char *line, *field, *end;
+	int index, i;
+
+	rewind(f);
+	while ((line = read_line(f)) != NULL) {
+		switch (line[0]) {
+		case 'M':
+			index = strtol(line + 2, &end, 10);
+			if (index < 0 || index >= nr_files || *end != '\t')
+				return 0;
+			add_message(&files[index], end + 1);
+			break;
+		case 'F':
+			index = strtol(line + 2, &end, 10);
+			if (index < 0 || index >= nr_files)
+				return 0;
+			files[index].failed = strtol(end, &end, 10);
+			files[index].remotes = strtol(end, &end, 10);
+			files[index].done = 1;
+			remote = NULL;
+			break;
+		case 'R':
+			if (nr_remotes == size) {
+				size = size ? 2 * size : 256;
+				remotes = realloc(remotes, size * sizeof(*remotes));
+				if (remotes == NULL) {
+					fprintf(stderr, "%s: out of memory\n", progname);
+					exit(EXIT_FAILURE);
+				}
+			}
+			remote = &remotes[nr_remotes++];
+			memset(remote, 0, sizeof(*remote));
+			remote->file = strtol(line + 2, &end, 10);
+			remote->protocol = strtol(end, &end, 10);
+			remote->bits = strtol(end, &end, 10);
+			remote->eps = strtol(end, &end, 10);
+			remote->aeps = strtol(end, &end, 10);
+			remote->mask = strtoull(end, &end, 16);
+			remote->rc6_mask = strtoull(end, &end, 16);
+			for (i = 0; i < TIMINGS; i++)
+				remote->timing[i] = strtoul(end, &end, 10);
+			if (*end != '\t' || remote->file < 0 || remote->file >= nr_files)
+				return 0;
+			remote->name = check_strdup(end + 1);
+			break;
+		case 'C':
+			if (remote == NULL)
+				return 0;
+			code = add_code(remote);
+			code->code = strtoull(line + 2, &end, 16);
+			if (*end != '\t')
+				return 0;
+			code->name = check_strdup(end + 1);
+			break;
+		case 'W':
+			if (remote == NULL)
+				return 0;
+			code = add_code(remote);
+			code->length = strtol(line + 2, &end, 10);
+			code->signals = check_malloc((code->length + 1) * sizeof(lirc_t));
+			field = end;
+			for (i = 0; i < code->length; i++)
+				code->signals[i] = strtoul(field, &field, 10);
+			if (*field != '\t')
+				return 0;
+			code->name = check_strdup(field + 1);
+			break;
+		default:
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* could a duration match both, see expect() */
+static int overlaps(struct check_remote *r1, lirc_t t1, struct check_remote *r2, lirc_t t2)
+{
+	lirc_t tol1, tol2, diff;
+
+	if (t1 == 0 || t2 == 0)
+		return t1 == t2;
+	tol1 = t1 * r1->eps / 100;
+	if (tol1 < r1->aeps)
+		tol1 = r1->aeps;
+	tol2 = t2 * r2->eps / 100;
+	if (tol2 < r2->aeps)
+		tol2 = r2->aeps;
+	diff = t1 > t2 ? t1 - t2 : t2 - t1;
+	return diff <= tol1 + tol2;
+}
+
+static int same_timing(struct check_remote *r1, struct check_remote *r2)
+{
+	int i;
+
+	if (r1->protocol != r2->protocol || r1->bits != r2->bits || r1->rc6_mask != r2->rc6_mask)
+		return 0;
+	for (i = 0; i < TIMINGS; i++) {
+		if (!overlaps(r1, r1->timing[i], r2, r2->timing[i]))
+			return 0;
+	}
+	return 1;
+}
+
+static int same_signal(struct check_remote *r1, struct check_code *c1, struct check_remote *r2, struct check_code *c2)
+{
+	int i;
+
+	if (r1->protocol != RAW_CODES)
+		return ((c1->code ^ c2->code) & ~(r1->mask | r2->mask) & gen_mask(r1->bits)) == 0;
+	if (c1->length != c2->length)
+		return 0;
+	for (i = 0; i < c1->length; i++) {
+		if (!overlaps(r1, c1->signals[i], r2, c2->signals[i]))
+			return 0;
+	}
+	return 1;
+}
+
+static int compare_remotes(const void *a, const void *b)
+{
+	const struct check_remote *r1 = a, *r2 = b;
+
+	if (r1->protocol != r2->protocol)
+		return r1->protocol - r2->protocol;
+	if (r1->bits != r2->bits)
+		return r1->bits - r2->bits;
+	return r1->file - r2->file;
+}
+
+static int check_ambiguities(void)
+{
+	struct check_remote *r1, *r2;
+	struct check_code *first1 = NULL, *first2 = NULL;
+	int i, j, k, l, shared, found = 0;
+
+	/* only remotes with the same protocol and length can clash */
+	qsort(remotes, nr_remotes, sizeof(*remotes), compare_remotes);
+	for (i = 0; i < nr_remotes; i++) {
+		r1 = &remotes[i];
+		for (j = i + 1; j < nr_remotes; j++) {
+			r2 = &remotes[j];
+			if (r1->protocol != r2->protocol || r1->bits != r2->bits)
+				break;
+			if (!same_timing(r1, r2))
+				continue;
+			shared = 0;
+			for (k = 0; k < r1->codes; k++) {
+				for (l = 0; l < r2->codes; l++) {
+					if (same_signal(r1, &r1->code[k], r2, &r2->code[l])) {
+						if (shared++ == 0) {
+							first1 = &r1->code[k];
+							first2 = &r2->code[l];
+						}
+						break;
+					}
+				}
+			}
+			if (shared == 0)
+				continue;
+			printf("%s: remote %s and %s: remote %s decode %d signal%s alike, e.g. %s and %s\n",
+			       files[r1->file].path, r1->name, files[r2->file].path, r2->name, shared,
+			       shared == 1 ? "" : "s", first1->name, first2->name);
+			found++;
+		}
+	}
+	return found;
+}
+
+int main(int argc, char **argv)
+{
+	int jobs = 0, ambiguities = 1;
+	int i, failed, status, warnings;
+	FILE *result[MAX_JOBS];
+	pid_t pid[MAX_JOBS];
+	struct timeval start, end;
+
+	progname = argv[0];
+	while (1) {
+		int c;
+		static struct option long_options[] = {
+			{"help", no_argument, NULL, 'h'},
+			{"version", no_argument, NULL, 'v'},
+			{"jobs", required_argument, NULL, 'j'},
+			{"no-ambiguities", no_argument, NULL, 'n'},
+			{"verbose", no_argument, NULL, 'V'},
+			{0, 0, 0, 0}
+		};
+		c = getopt_long(argc, argv, "hvj:nV", long_options, NULL);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 'h':
+			printf(usage, progname);
+			printf("\t -h --help\t\tdisplay this message\n");
+			printf("\t -v --version\t\tdisplay version\n");
+			printf("\t -j --jobs=n\t\tcheck n files in parallel\n");
+			printf("\t -n --no-ambiguities\tdo not compare the remotes with each other\n");
+			printf("\t -V --verbose\t\talso list the files without problems\n");
+			exit(EXIT_SUCCESS);
+		case 'v':
+			printf("lircd-check %s\n", LIRCD_CHECK_VERSION);
+			exit(EXIT_SUCCESS);
+		case 'j':
+			jobs = atoi(optarg);
+			if (jobs < 1 || jobs > MAX_JOBS) {
+				fprintf(stderr, "%s: invalid number of jobs: %s\n", progname, optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'n':
+			ambiguities = 0;
+			break;
+		case 'V':
+			verbose = 1;
+			break;
+		default:
+			printf("Try %s -h for help!\n", progname);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (optind == argc) {
+		fprintf(stderr, usage, progname);
+		exit(EXIT_FAILURE);
+	}
+	for (; optind < argc; optind++) {
+		if (!add_path(argv[optind], 1))
+			exit(EXIT_FAILURE);
+	}
+	if (nr_files == 0) {
+		fprintf(stderr, "%s: no config files found\n", progname);
+		exit(EXIT_FAILURE);
+	}
+	qsort(files, nr_files, sizeof(*files), compare_files);
+
+	if (jobs == 0) {
+#		ifdef _SC_NPROCESSORS_ONLN
+		jobs = sysconf(_SC_NPROCESSORS_ONLN);
+#		endif
+		if (jobs < 1)
+			jobs = 1;
+		if (jobs > MAX_JOBS)
+			jobs = MAX_JOBS;
+	}
+	if (jobs > nr_files)
+		jobs = nr_files;
+
+	gettimeofday(&start, NULL);
+	fflush(stdout);
+	for (i = 0; i < jobs; i++) {
+		result[i] = tmpfile();
+		if (result[i] == NULL) {
+			perror(progname);
+			exit(EXIT_FAILURE);
+		}
+		pid[i] = fork();
+		if (pid[i] == -1) {
+			perror(progname);
+			exit(EXIT_FAILURE);
+		}
+		if (pid[i] == 0) {
+			results = result[i];
+			worker(i, jobs);
+		}
+	}
+	for (i = 0; i < jobs; i++) {
+		if (waitpid(pid[i], &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			fprintf(stderr, "%s: worker %d failed\n", progname, i);
+		}
+		if (!read_results(result[i])) {
+			fprintf(stderr, "%s: corrupt results of worker %d\n", progname, i);
+			exit(EXIT_FAILURE);
+		}
+		fclose(result[i]);
+	}
+
+	failed = warnings = 0;
+	for (i = 0; i < nr_files; i++) {
+		if (!files[i].done) {
+			printf("%s: not checked\n", files[i].path);
+			failed++;
+			continue;
+		}
+		if (files[i].failed)
+			failed++;
+		else if (files[i].messages != NULL)
+			warnings++;
+		if (files[i].failed || files[i].messages != NULL || verbose) {
+			printf("%s: %s", files[i].path, files[i].failed ? "FAILED" : "OK");
+			printf(" (%d remote%s)\n", files[i].remotes, files[i].remotes == 1 ? "" : "s");
+		}
+		if (files[i].messages != NULL) {
+			char *message, *next;
+
+			for (message = files[i].messages; *message; message = next) {
+				next = strchr(message, '\n');
+				*next++ = 0;
+				printf("\t%s\n", message);
+			}
+		}
+	}
+	if (ambiguities)
+		ambiguities = check_ambiguities();
+	gettimeofday(&end, NULL);
+
+	printf("%d files, %d remotes checked in %.2f s: %d failed, %d with warnings", nr_files, nr_remotes,
+	       (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0, failed, warnings);
+	if (ambiguities)
+		printf(", %d ambiguous pair%s", ambiguities, ambiguities == 1 ? "" : "s");
+	printf("\n");
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -44,6 +44,7 @@
 #include <unistd.h>
 #include <time.h>
 #include <getopt.h>
+#include <fnmatch.h>
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -57,6 +58,13 @@
 #include <fcntl.h>
 #include <sys/file.h>
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#if defined(HAVE_MALLINFO2) || defined(HAVE_MALLINFO)
+#include <malloc.h>
+#endif
+
 #if defined(__linux__)
 #include <linux/input.h>
 #include <linux/uinput.h>
@@ -85,6 +93,11 @@
 #include "hardware.h"
 #include "hw-types.h"
 #include "release.h"
+#include "capture.h"
+#include "receive.h"
+#include "transmit.h"
+#include "event_ring.h"
+#include "thread_queue.h"
 
 struct ir_remote *remotes;
 struct ir_remote *free_remotes = NULL;
@@ -119,6 +132,10 @@ struct protocol_directive directives[] = {
 	{"VERSION", version},
 	{"SET_TRANSMITTERS", set_transmitters},
 	{"SIMULATE", simulate},
+	{"DECODE_STATS", decode_stats},
+	{"SET_REPEAT_RATE", set_repeat_rate},
+	{"SUBSCRIBE", subscribe},
+	{"UNSUBSCRIBE", unsubscribe},
 	{NULL, NULL}
 	/*
 	   {"DEBUG",debug},
@@ -132,7 +149,8 @@ enum protocol_string_num {
 	P_END,
 	P_ERROR,
 	P_SUCCESS,
-	P_SIGHUP
+	P_SIGHUP,
+	P_AMBIGUOUS
 };
 
 char *protocol_string[] = {
@@ -141,11 +159,26 @@ char *protocol_string[] = {
 	"END\n",
 	"ERROR\n",
 	"SUCCESS\n",
-	"SIGHUP\n"
+	"SIGHUP\n",
+	"AMBIGUOUS\n"
 };
 
 static void log_enable(int enabled);
 static int log_enabled = 1;
+#ifdef HAVE_PTHREAD
+/* the reload, receive and decode threads log as well */
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static int start_hardware(void);
+static void stop_hardware(void);
+static void lock_decoder(void);
+static void unlock_decoder(void);
+static void send_input(const char *message, const char *remote_name, const char *button_name, struct ir_remote *remote,
+		       struct ir_ncode *ncode, int reps, int release);
+static int format_ambiguity(char *packet, size_t size);
+static void broadcast_event(const char *message, const char *remote_name, const char *button_name, int id, int reps);
+static void compile_subscriptions(void);
 
 #ifndef USE_SYSLOG
 #define HOSTNAME_LEN 128
@@ -168,6 +201,48 @@ int clis[MAX_CLIENTS];
 static int cli_type[MAX_CLIENTS];
 static int clin = 0;
 
+/* commands not handled yet, kept for every descriptor that has been a client */
+#define CLIENT_BUFFER_SIZE (16 * PACKET_SIZE)
+
+struct client_input {
+	int len;
+	char data[CLIENT_BUFFER_SIZE + 1];
+};
+
+static struct client_input *cli_input[FD_SETSIZE];
+
+/* what a client asked for, reset for every new client */
+struct client_options {
+	long repeat_interval;	/* usec between repeats, 0: all of them */
+	struct timeval last_event;	/* last event sent to it */
+	char **patterns;	/* "remote\0button\0" given to SUBSCRIBE */
+	int pattern_count;	/* 0: all events */
+	unsigned char *subscribed;	/* bit per button of the config */
+};
+
+static struct client_options cli_options[FD_SETSIZE];
+static int button_total = 0;
+
+#ifndef FNM_CASEFOLD
+#define FNM_CASEFOLD 0
+#endif
+
+/* an event on its way to the clients, looked at only when needed */
+struct broadcast {
+	const char *message;
+	const char *remote_name, *button_name;	/* NULL: not an event */
+	int parsed;
+	int id;			/* -2: look up the names, -1: not in the config */
+	int reps;
+	struct timeval now;
+	char remote[PACKET_SIZE + 1], button[PACKET_SIZE + 1];
+};
+
+static void free_subscription(struct client_options *options);
+static void broadcast_init(struct broadcast *b, const char *message, const char *remote_name,
+			   const char *button_name, int id, int reps);
+static int wants_event(int fd, struct broadcast *b);
+
 int listen_tcpip = 0;
 unsigned short int port = LIRC_INET_PORT;
 struct in_addr address;
@@ -178,12 +253,31 @@ int peern = 0;
 int debug = 0;
 static int daemonized = 0;
 static int allow_simulate = 0;
+static int report_ambiguities = 0;
 static int userelease = 0;
 static int useuinput = 0;
+static char *capturefile = NULL;
+static unsigned long capturesize = 1024;
+static char *shmname = NULL;
+static int threads = 0;
+static int receive_running = 0;
 
 static sig_atomic_t term = 0, hup = 0, alrm = 0;
 static int termsig;
 
+#ifdef HAVE_PTHREAD
+/* the config file is reread in the background after SIGHUP */
+static pthread_t reload_thread;
+static int reload_running = 0;
+static int reload_again = 0;
+static int reload_pipe[2] = { -1, -1 };
+static struct ir_remote *reload_remotes;
+static struct timeval reload_start;
+
+/* samples from the receive thread, events from the decode thread */
+static struct thread_queue sample_queue, event_queue;
+#endif
+
 static __u32 setup_min_freq = 0, setup_max_freq = 0;
 static lirc_t setup_max_gap = 0;
 static lirc_t setup_min_pulse = 0, setup_min_space = 0;
@@ -191,7 +285,7 @@ static lirc_t setup_max_pulse = 0, setup_max_space = 0;
 
 inline int use_hw()
 {
-	return (clin > 0 || (useuinput && uinputfd != -1) || repeat_remote != NULL);
+	return (clin > 0 || (useuinput && uinputfd != -1) || shmname != NULL || repeat_remote != NULL);
 }
 
 /* set_transmitters only supports 32 bit int */
@@ -243,14 +337,77 @@ inline int write_socket(int fd, const char *buf, int len)
 	return (len);
 }
 
-inline int write_socket_len(int fd, const char *buf)
+/*
+  A reply packet is collected and written with one write(), instead
+  of one per line. Most replies fit into the buffer on the stack, a
+  LIST of a big remote moves to the heap.
+*/
+#define REPLY_SIZE 4096
+
+struct reply {
+	int fd;
+	int ok;
+	char *data;
+	size_t len, size;
+	char buffer[REPLY_SIZE];
+};
+
+static void reply_begin(struct reply *r, int fd)
 {
-	int len;
+	r->fd = fd;
+	r->ok = 1;
+	r->data = r->buffer;
+	r->len = 0;
+	r->size = sizeof(r->buffer);
+}
 
-	len = strlen(buf);
-	if (write_socket(fd, buf, len) < len)
-		return (0);
-	return (1);
+static void reply_flush(struct reply *r)
+{
+	if (r->ok && r->len > 0 && write_socket(r->fd, r->data, r->len) < (int)r->len)
+		r->ok = 0;
+	r->len = 0;
+}
+
+static void reply_add(struct reply *r, const char *s, size_t len)
+{
+	if (r->len + len > r->size) {
+		size_t size = r->size;
+		char *data;
+
+		while (size < r->len + len)
+			size *= 2;
+		data = r->data == r->buffer ? malloc(size) : realloc(r->data, size);
+		if (data != NULL) {
+			if (r->data == r->buffer)
+				memcpy(data, r->buffer, r->len);
+			r->data = data;
+			r->size = size;
+		} else {
+			/* then it goes out in parts */
+			reply_flush(r);
+			if (len > r->size) {
+				if (r->ok && write_socket(r->fd, s, len) < (int)len)
+					r->ok = 0;
+				return;
+			}
+		}
+	}
+	memcpy(r->data + r->len, s, len);
+	r->len += len;
+}
+
+static void reply_add_string(struct reply *r, const char *s)
+{
+	reply_add(r, s, strlen(s));
+}
+
+/* returns 0 if the client could not be written to */
+static int reply_send(struct reply *r)
+{
+	reply_flush(r);
+	if (r->data != r->buffer)
+		free(r->data);
+	return (r->ok);
 }
 
 inline int read_timeout(int fd, char *buf, int len, int timeout)
@@ -304,11 +461,29 @@ void sigterm(int sig)
 	termsig = sig;
 }
 
+static void log_receive_stats(void)
+{
+	if (receive_dropped) {
+		logprintf(LOG_INFO, "receive buffer: %lu samples dropped", receive_dropped);
+	}
+	if (receive_filtered || receive_bursts) {
+		logprintf(LOG_INFO, "noise filter: %lu short and %lu long samples merged, %lu decodes avoided",
+			  receive_filtered, receive_bursts, receive_avoided);
+	}
+#ifdef HAVE_PTHREAD
+	if (sample_queue.dropped || event_queue.dropped) {
+		logprintf(LOG_INFO, "thread queues: %lu samples and %lu events dropped", sample_queue.dropped,
+			  event_queue.dropped);
+	}
+#endif
+}
+
 void dosigterm(int sig)
 {
 	int i;
 
 	signal(SIGALRM, SIG_IGN);
+	log_receive_stats();
 
 	if (free_remotes != NULL) {
 		free_config(free_remotes);
@@ -337,7 +512,9 @@ void dosigterm(int sig)
 	fclose(pidf);
 	(void)unlink(pidfile);
 	if (use_hw() && hw.deinit_func)
-		hw.deinit_func();
+		stop_hardware();
+	capture_close();
+	event_ring_close();
 #ifdef USE_SYSLOG
 	closelog();
 #else
@@ -353,6 +530,21 @@ void sighup(int sig)
 	hup = 1;
 }
 
+/* tell clients that the config has changed */
+static void config_changed(void)
+{
+	char packet[PACKET_SIZE + 1];
+	int i, len;
+
+	len = sprintf(packet, "%s%s%s", protocol_string[P_BEGIN], protocol_string[P_SIGHUP], protocol_string[P_END]);
+	for (i = 0; i < clin; i++) {
+		if (write_socket(clis[i], packet, len) < len) {
+			remove_client(clis[i]);
+			i--;
+		}
+	}
+}
+
 void dosighup(int sig)
 {
 #ifndef USE_SYSLOG
@@ -365,11 +557,19 @@ void dosighup(int sig)
 	/* we don't need to do anyting as this is syslogd's task */
 #else
 	logprintf(LOG_INFO, "closing logfile");
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&log_mutex);
+#endif
 	if (-1 == fstat(fileno(lf), &s)) {
-		dosigterm(SIGTERM);	/* shouldn't ever happen */
+		fclose(lf);
+		lf = NULL;	/* shouldn't ever happen */
+	} else {
+		fclose(lf);
+		lf = fopen(logfile, "a");
 	}
-	fclose(lf);
-	lf = fopen(logfile, "a");
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&log_mutex);
+#endif
 	if (lf == NULL) {
 		/* can't print any error messagees */
 		dosigterm(SIGTERM);
@@ -380,18 +580,10 @@ void dosighup(int sig)
 		logperror(LOG_WARNING, NULL);
 	}
 #endif
+	log_receive_stats();
 
-	config();
+	reload_config();
 
-	for (i = 0; i < clin; i++) {
-		if (!
-		    (write_socket_len(clis[i], protocol_string[P_BEGIN])
-		     && write_socket_len(clis[i], protocol_string[P_SIGHUP])
-		     && write_socket_len(clis[i], protocol_string[P_END]))) {
-			remove_client(clis[i]);
-			i--;
-		}
-	}
 	/* restart all connection timers */
 	for (i = 0; i < peern; i++) {
 		if (peers[i]->socket == -1) {
@@ -561,10 +753,27 @@ static int setup_filter()
 	return 1;
 }
 
+/* drivers that cannot filter get the noise filter in receive.c */
+static void setup_receive_filter(void)
+{
+	if (receive_noise_filter == 0 || (hw.features & LIRC_CAN_SET_REC_FILTER)) {
+		receive_min_pulse = receive_min_space = 0;
+		receive_max_pulse = receive_max_gap = 0;
+		return;
+	}
+	receive_min_pulse = receive_noise_filter > 0 ? receive_noise_filter : setup_min_pulse;
+	receive_min_space = setup_min_space;
+	receive_max_pulse = setup_max_pulse;
+	receive_max_gap = setup_max_gap;
+	LOGPRINTF(1, "noise filter: pulses %lu-%lu, spaces from %lu", (__u32) receive_min_pulse,
+		  (__u32) receive_max_pulse, (__u32) receive_min_space);
+}
+
 static int setup_hardware()
 {
 	int ret = 1;
 
+	setup_receive_filter();
 	if (hw.fd != -1 && hw.ioctl_func) {
 		if ((hw.features & LIRC_CAN_SET_REC_CARRIER) || (hw.features & LIRC_CAN_SET_REC_TIMEOUT)
 		    || (hw.features & LIRC_CAN_SET_REC_FILTER)) {
@@ -576,10 +785,456 @@ static int setup_hardware()
 	return ret;
 }
 
-void config(void)
+#ifdef HAVE_PTHREAD
+/*
+  With --threads a thread of its own reads the device and only queues
+  the samples, and a second thread decodes them, so neither a slow
+  transmitter nor a busy client makes lircd miss a signal. The main
+  loop still serves the clients, sends the decoded events and
+  transmits. The decoder state (the remotes, last_remote and
+  repeat_remote, the receive buffer and the release timer) belongs to
+  whoever holds the decoder lock. The decode thread gives it up while
+  it waits for samples, just like decoding lets the main loop run in
+  waitfordata() otherwise.
+*/
+
+#define SAMPLE_QUEUE_SLOTS 4096
+#define EVENT_QUEUE_SLOTS 32
+
+#define EVENT_BUTTON    0
+#define EVENT_RELEASE   1
+#define EVENT_AMBIGUOUS 2
+
+struct decoded_event {
+	int type;
+	int reps;
+	struct ir_remote *remote;	/* only valid as long as */
+	struct ir_ncode *ncode;
+	unsigned int generation;	/* config_generation is this */
+	char remote_name[PACKET_SIZE + 1];
+	char button_name[PACKET_SIZE + 1];
+	char message[PACKET_SIZE * (MAX_DECODE_CANDIDATES + 1)];
+};
+
+static pthread_t receive_thread, receive_self, decode_thread;
+static volatile int receive_stop = 0, receive_gone = 0;
+static volatile int receive_park = 0;
+static int receive_parked = 0;
+static pthread_mutex_t receive_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t receive_cond = PTHREAD_COND_INITIALIZER;
+static int receive_pipe[2] = { -1, -1 };	/* stops the receive thread */
+static int event_pipe[2] = { -1, -1 };	/* wakes up the main loop */
+static lirc_t(*driver_readdata) (lirc_t timeout);
+
+static pthread_mutex_t decoder_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t decoder_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int decoder_next = 0, decoder_serving = 0;
+static int decoder_depth = 0;
+static pthread_t decoder_owner;
+
+/* a ticket lock, so that a stream of client commands cannot starve
+   the decode thread; the main loop takes it recursively when a
+   driver calls waitfordata() while sending */
+static void lock_decoder(void)
+{
+	unsigned int ticket;
+
+	if (!threads)
+		return;
+	pthread_mutex_lock(&decoder_mutex);
+	if (decoder_depth > 0 && pthread_equal(decoder_owner, pthread_self())) {
+		decoder_depth++;
+	} else {
+		ticket = decoder_next++;
+		while (ticket != decoder_serving)
+			pthread_cond_wait(&decoder_cond, &decoder_mutex);
+		decoder_owner = pthread_self();
+		decoder_depth = 1;
+	}
+	pthread_mutex_unlock(&decoder_mutex);
+}
+
+static void unlock_decoder(void)
+{
+	if (!threads)
+		return;
+	pthread_mutex_lock(&decoder_mutex);
+	if (--decoder_depth == 0) {
+		decoder_serving++;
+		pthread_cond_broadcast(&decoder_cond);
+	}
+	pthread_mutex_unlock(&decoder_mutex);
+}
+
+static void wake_main_loop(void)
+{
+	char c = 0;
+
+	/* a full pipe wakes it up as well */
+	if (write(event_pipe[1], &c, 1) == -1 && errno != EAGAIN) {
+		logperror(LOG_ERR, "could not wake up main loop");
+	}
+}
+
+/* waitfordata() of the receive thread, only the device counts there */
+static int wait_for_device(long maxusec)
+{
+	fd_set fds;
+	struct timeval tv;
+
+	if (hw.fd == -1 || receive_stop || receive_park)
+		return (0);
+	FD_ZERO(&fds);
+	FD_SET(hw.fd, &fds);
+	FD_SET(receive_pipe[0], &fds);
+	tv.tv_sec = maxusec / 1000000;
+	tv.tv_usec = maxusec % 1000000;
+	if (select(max(hw.fd, receive_pipe[0]) + 1, &fds, NULL, NULL, maxusec > 0 ? &tv : NULL) <= 0)
+		return (0);
+	return (FD_ISSET(hw.fd, &fds) && !receive_stop && !receive_park);
+}
+
+static void wait_parked(void)
+{
+	pthread_mutex_lock(&receive_mutex);
+	receive_parked = 1;
+	pthread_cond_broadcast(&receive_cond);
+	while (receive_park)
+		pthread_cond_wait(&receive_cond, &receive_mutex);
+	receive_parked = 0;
+	pthread_mutex_unlock(&receive_mutex);
+}
+
+static void *receive_worker(void *arg)
+{
+	lirc_t data, *slot;
+
+	receive_self = pthread_self();
+	while (!receive_stop && hw.fd != -1) {
+		if (receive_park) {
+			wait_parked();
+			continue;
+		}
+		data = driver_readdata(0);
+		if (data == 0)
+			continue;
+		slot = thread_queue_reserve(&sample_queue);
+		if (slot != NULL) {
+			*slot = data;
+			thread_queue_commit(&sample_queue);
+		}
+	}
+	/* the driver closes the device itself on errors, the main
+	   loop reopens it */
+	pthread_mutex_lock(&receive_mutex);
+	receive_gone = 1;
+	pthread_cond_broadcast(&receive_cond);
+	pthread_mutex_unlock(&receive_mutex);
+	wake_main_loop();
+	return NULL;
+}
+
+static int start_receive_thread(void)
+{
+	sigset_t all, old;
+	int ret;
+
+	/* the main loop reads drivers that decode themselves */
+	if (hw.rec_mode != LIRC_MODE_MODE2)
+		return (1);
+	if (driver_readdata == NULL || hw.fd == -1) {
+		logprintf(LOG_ERR, "driver cannot be read in a thread");
+		return (0);
+	}
+	receive_stop = receive_gone = 0;
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, &old);
+	ret = pthread_create(&receive_thread, NULL, receive_worker, NULL);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (ret != 0) {
+		logprintf(LOG_ERR, "could not start receive thread");
+		return (0);
+	}
+	receive_running = 1;
+	return (1);
+}
+
+static void stop_receive_thread(void)
+{
+	char c = 0;
+
+	if (!receive_running)
+		return;
+	receive_stop = 1;
+	if (write(receive_pipe[1], &c, 1) == -1 && errno != EAGAIN) {
+		logperror(LOG_ERR, "could not stop receive thread");
+	}
+	pthread_join(receive_thread, NULL);
+	while (read(receive_pipe[0], &c, 1) > 0) ;
+	receive_running = 0;
+}
+
+/*
+  Drivers like uirt2_raw read the answer of the transmitter from the
+  device the receive thread reads, so the thread waits while the main
+  loop transmits, and the driver sees the device as it would without
+  threads. A driver that does not wait for data with waitfordata()
+  only notices this after the next sample.
+*/
+static void park_receive_thread(void)
+{
+	char c = 0;
+
+	if (!receive_running)
+		return;
+	pthread_mutex_lock(&receive_mutex);
+	receive_park = 1;
+	if (write(receive_pipe[1], &c, 1) == -1 && errno != EAGAIN) {
+		logperror(LOG_ERR, "could not park receive thread");
+	}
+	while (!receive_parked && !receive_gone)
+		pthread_cond_wait(&receive_cond, &receive_mutex);
+	pthread_mutex_unlock(&receive_mutex);
+}
+
+static void unpark_receive_thread(void)
+{
+	char c;
+
+	if (!receive_running)
+		return;
+	pthread_mutex_lock(&receive_mutex);
+	while (read(receive_pipe[0], &c, 1) > 0) ;
+	receive_park = 0;
+	pthread_cond_broadcast(&receive_cond);
+	pthread_mutex_unlock(&receive_mutex);
+}
+
+/* hw.readdata of the decode thread */
+static lirc_t queue_readdata(lirc_t timeout)
+{
+	lirc_t *slot, data;
+
+	if (thread_queue_peek(&sample_queue) == NULL) {
+		unlock_decoder();
+		thread_queue_wait(&sample_queue, timeout);
+		lock_decoder();
+	}
+	slot = thread_queue_peek(&sample_queue);
+	if (slot == NULL)
+		return (0);
+	data = *slot;
+	thread_queue_release(&sample_queue);
+	register_input();
+	return (data);
+}
+
+static void queue_event(int type, const char *message, struct ir_remote *remote, struct ir_ncode *ncode, int reps)
+{
+	struct decoded_event *event;
+
+	event = thread_queue_reserve(&event_queue);
+	if (event == NULL)
+		return;
+	event->type = type;
+	event->reps = reps;
+	event->remote = remote;
+	event->ncode = ncode;
+	event->generation = config_generation;
+	snprintf(event->message, sizeof(event->message), "%s", message);
+	snprintf(event->remote_name, sizeof(event->remote_name), "%s", remote ? remote->name : "");
+	snprintf(event->button_name, sizeof(event->button_name), "%s", ncode ? ncode->name : "");
+	thread_queue_commit(&event_queue);
+	wake_main_loop();
+}
+
+static void *decode_worker(void *arg)
+{
+	char packet[PACKET_SIZE * (MAX_DECODE_CANDIDATES + 1)];
+	struct ir_remote *remote, *release_remote;
+	struct ir_ncode *ncode, *release_ncode;
+	const char *release_message;
+	char *message;
+	int reps;
+
+	while (1) {
+		thread_queue_wait(&sample_queue, 0);
+		lock_decoder();
+		message = hw.rec_func(remotes);
+		if (message != NULL) {
+			get_release_data(&remote, &ncode, &reps);
+
+			/* what input_message() does before sending */
+			release_message = check_release_event(&release_remote, &release_ncode);
+			if (release_message) {
+				queue_event(EVENT_RELEASE, release_message, release_remote, release_ncode, 0);
+			}
+			queue_event(EVENT_BUTTON, message, remote, ncode, reps);
+
+			if (report_ambiguities && decode_candidate_count > 1 && decode_candidates[0].remote->reps == 0
+			    && format_ambiguity(packet, sizeof(packet)))
+				queue_event(EVENT_AMBIGUOUS, packet, NULL, NULL, 0);
+			decode_candidate_count = 0;
+		}
+		unlock_decoder();
+	}
+	return NULL;
+}
+
+/* send what the decode thread found, called with the decoder lock */
+static void send_decoded_events(void)
+{
+	struct decoded_event *event;
+	char buffer[64];
+
+	while (read(event_pipe[0], buffer, sizeof(buffer)) > 0) ;
+	while ((event = thread_queue_peek(&event_queue)) != NULL) {
+		if (event->generation != config_generation) {
+			/* a config was freed since, go by the names */
+			event->remote = NULL;
+			event->ncode = NULL;
+		}
+		switch (event->type) {
+		case EVENT_BUTTON:
+			if (hw.ioctl_func && (hw.features & LIRC_CAN_NOTIFY_DECODE)) {
+				hw.ioctl_func(LIRC_NOTIFY_DECODE, NULL);
+			}
+			send_input(event->message, event->remote_name, event->button_name, event->remote, event->ncode,
+				   event->reps, 0);
+			break;
+		case EVENT_RELEASE:
+			send_input(event->message, event->remote_name, event->button_name, event->remote, event->ncode, 0,
+				   1);
+			break;
+		case EVENT_AMBIGUOUS:
+			broadcast_message(event->message);
+			break;
+		}
+		thread_queue_release(&event_queue);
+	}
+	if (receive_gone) {
+		stop_receive_thread();
+	}
+}
+
+static int open_pipe(int fds[2])
+{
+	int i;
+
+	if (pipe(fds) == -1)
+		return (0);
+	for (i = 0; i < 2; i++) {
+		(void)fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+		(void)fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+	}
+	return (1);
+}
+
+static void start_threads(void)
+{
+	sigset_t all, old;
+	int ret;
+
+	if (!hw.rec_func || !hw.readdata) {
+		logprintf(LOG_WARNING, "driver %s does not decode in lircd, not using threads", hw.name);
+		threads = 0;
+		return;
+	}
+	if (!open_pipe(receive_pipe) || !open_pipe(event_pipe)) {
+		logperror(LOG_ERR, "pipe()");
+		dosigterm(SIGTERM);
+	}
+	if (!thread_queue_init(&sample_queue, SAMPLE_QUEUE_SLOTS, sizeof(lirc_t))
+	    || !thread_queue_init(&event_queue, EVENT_QUEUE_SLOTS, sizeof(struct decoded_event))) {
+		logprintf(LOG_ERR, "out of memory");
+		dosigterm(SIGTERM);
+	}
+	driver_readdata = hw.readdata;
+	hw.readdata = queue_readdata;
+
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, &old);
+	ret = pthread_create(&decode_thread, NULL, decode_worker, NULL);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (ret != 0) {
+		logprintf(LOG_ERR, "could not start decode thread");
+		dosigterm(SIGTERM);
+	}
+	logprintf(LOG_INFO, "receiving and decoding in separate threads");
+}
+#else
+static void lock_decoder(void)
+{
+}
+
+static void unlock_decoder(void)
+{
+}
+
+static void park_receive_thread(void)
+{
+}
+
+static void unpark_receive_thread(void)
+{
+}
+#endif /* HAVE_PTHREAD */
+
+static int send_code(struct ir_remote *remote, struct ir_ncode *code)
+{
+	int ret;
+
+	park_receive_thread();
+	lock_send_buffer();
+	ret = send_ir_ncode(remote, code);
+	unlock_send_buffer();
+	unpark_receive_thread();
+	return (ret);
+}
+
+/* in threaded mode the device is read by the receive thread */
+static int start_hardware(void)
+{
+	if (!hw.init_func())
+		return (0);
+#ifdef HAVE_PTHREAD
+	if (threads && !start_receive_thread()) {
+		hw.deinit_func();
+		return (0);
+	}
+#endif
+	return (1);
+}
+
+static void stop_hardware(void)
+{
+#ifdef HAVE_PTHREAD
+	stop_receive_thread();
+#endif
+	hw.deinit_func();
+}
+
+static void log_memory(const char *when)
+{
+	struct config_memory memory;
+#if defined(HAVE_MALLINFO2)
+	struct mallinfo2 mi = mallinfo2();
+#elif defined(HAVE_MALLINFO)
+	struct mallinfo mi = mallinfo();
+#endif
+
+	get_config_memory(remotes, &memory);
+	logprintf(LOG_INFO, "%s: config uses %lu of %lu bytes in %lu blocks", when, memory.used, memory.size,
+		  memory.blocks);
+#if defined(HAVE_MALLINFO2) || defined(HAVE_MALLINFO)
+	logprintf(LOG_INFO, "%s: heap has %lu bytes in use, %lu bytes free in %lu chunks", when,
+		  (unsigned long)mi.uordblks, (unsigned long)mi.fordblks, (unsigned long)mi.ordblks);
+#endif
+}
+
+static FILE *open_config(void)
 {
 	FILE *fd;
-	struct ir_remote *config_remotes;
 	const char *filename = configfile;
 	if (filename == NULL)
 		filename = LIRCDCFGFILE;
@@ -587,7 +1242,7 @@ void config(void)
 	if (free_remotes != NULL) {
 		logprintf(LOG_ERR, "cannot read config file");
 		logprintf(LOG_ERR, "old config is still in use");
-		return;
+		return NULL;
 	}
 	fd = fopen(filename, "r");
 	if (fd == NULL && errno == ENOENT && configfile == NULL) {
@@ -603,11 +1258,14 @@ void config(void)
 	if (fd == NULL) {
 		logprintf(LOG_ERR, "could not open config file '%s'", filename);
 		logperror(LOG_ERR, NULL);
-		return;
+		return NULL;
 	}
 	configfile = filename;
-	config_remotes = read_config(fd, configfile);
-	fclose(fd);
+	return fd;
+}
+
+static void install_config(struct ir_remote *config_remotes)
+{
 	if (config_remotes == (void *)-1) {
 		logprintf(LOG_ERR, "reading of config file failed");
 	} else {
@@ -619,6 +1277,7 @@ void config(void)
 		   as they could still be in use */
 		free_remotes = remotes;
 		remotes = config_remotes;
+		compile_subscriptions();
 
 		get_frequency_range(remotes, &setup_min_freq, &setup_max_freq);
 		get_filter_parameters(remotes, &setup_max_gap, &setup_min_pulse, &setup_min_space, &setup_max_pulse,
@@ -628,6 +1287,100 @@ void config(void)
 	}
 }
 
+void config(void)
+{
+	FILE *fd;
+	struct ir_remote *config_remotes;
+
+	fd = open_config();
+	if (fd == NULL)
+		return;
+	config_remotes = read_config(fd, configfile);
+	fclose(fd);
+	install_config(config_remotes);
+}
+
+#ifdef HAVE_PTHREAD
+static void *reload_worker(void *arg)
+{
+	FILE *fd = arg;
+	char c = 0;
+
+	reload_remotes = read_config(fd, configfile);
+	fclose(fd);
+	/* wake up the main loop */
+	if (write(reload_pipe[1], &c, 1) != 1) {
+		logperror(LOG_ERR, "could not signal end of config reload");
+	}
+	return NULL;
+}
+
+/* called from waitfordata() once the worker has finished */
+static void finish_reload(void)
+{
+	struct timeval start, end;
+	char c;
+
+	if (read(reload_pipe[0], &c, 1) != 1) {
+		return;
+	}
+	pthread_join(reload_thread, NULL);
+	reload_running = 0;
+
+	/* the old remotes are kept in free_remotes until
+	   free_old_remotes() finds them unused */
+	log_memory("before reload");
+	gettimeofday(&start, NULL);
+	install_config(reload_remotes);
+	gettimeofday(&end, NULL);
+	reload_remotes = NULL;
+	logprintf(LOG_INFO, "config file reloaded in %lu ms, main loop stalled for %lu us",
+		  time_elapsed(&reload_start, &start) / 1000, time_elapsed(&start, &end));
+	config_changed();
+}
+#endif
+
+void reload_config(void)
+{
+#ifdef HAVE_PTHREAD
+	sigset_t all, old;
+	FILE *fd;
+
+	if (reload_running || free_remotes != NULL) {
+		/* try again once the current reload is through */
+		reload_again = 1;
+		return;
+	}
+	reload_again = 0;
+	if (reload_pipe[0] == -1) {
+		if (pipe(reload_pipe) == -1) {
+			logperror(LOG_WARNING, "pipe()");
+			reload_pipe[0] = reload_pipe[1] = -1;
+			goto sync;
+		}
+		(void)fcntl(reload_pipe[0], F_SETFD, FD_CLOEXEC);
+		(void)fcntl(reload_pipe[1], F_SETFD, FD_CLOEXEC);
+	}
+	fd = open_config();
+	if (fd == NULL)
+		return;
+	gettimeofday(&reload_start, NULL);
+
+	/* signals have to go to the main loop */
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, &old);
+	reload_running = pthread_create(&reload_thread, NULL, reload_worker, fd) == 0;
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (reload_running)
+		return;
+	logprintf(LOG_WARNING, "could not start config reload thread");
+	fclose(fd);
+sync:
+#endif
+	config();
+	config_changed();
+}
+
 void nolinger(int sock)
 {
 	static struct linger linger = { 0, 0 };
@@ -643,14 +1396,16 @@ void remove_client(int fd)
 		if (clis[i] == fd) {
 			shutdown(clis[i], 2);
 			close(clis[i]);
+			free_subscription(&cli_options[fd]);
 			logprintf(LOG_INFO, "removed client");
 
 			clin--;
 			if (!use_hw() && hw.deinit_func) {
-				hw.deinit_func();
+				stop_hardware();
 			}
 			for (; i < clin; i++) {
 				clis[i] = clis[i + 1];
+				cli_type[i] = cli_type[i + 1];
 			}
 			return;
 		}
@@ -679,6 +1434,17 @@ void add_client(int sock)
 		close(fd);
 		return;
 	}
+	if (cli_input[fd] == NULL) {
+		cli_input[fd] = malloc(sizeof(struct client_input));
+		if (cli_input[fd] == NULL) {
+			logprintf(LOG_ERR, "out of memory, connection rejected");
+			shutdown(fd, 2);
+			close(fd);
+			return;
+		}
+	}
+	cli_input[fd]->len = 0;
+	memset(&cli_options[fd], 0, sizeof(cli_options[fd]));
 	nolinger(fd);
 	flags = fcntl(fd, F_GETFL, 0);
 	if (flags != -1) {
@@ -697,7 +1463,7 @@ void add_client(int sock)
 	clis[clin] = fd;
 	if (!use_hw()) {
 		if (hw.init_func) {
-			if (!hw.init_func()) {
+			if (!start_hardware()) {
 				logprintf(LOG_WARNING, "Failed to initialize hardware");
 				/* Don't exit here, otherwise lirc
 				 * bails out, and lircd exits, making
@@ -815,6 +1581,7 @@ int get_peer_message(struct peer_connection *peer)
 	char buffer[PACKET_SIZE + 1];
 	char *end;
 	int i;
+	struct broadcast b;
 
 	length = read_timeout(peer->socket, buffer, PACKET_SIZE, 0);
 	if (length) {
@@ -829,10 +1596,13 @@ int get_peer_message(struct peer_connection *peer)
 		end[0] = 0;
 		length = strlen(buffer);
 		LOGPRINTF(1, "received peer message: \"%s\"", buffer);
+		broadcast_init(&b, buffer, NULL, NULL, -2, 0);
 		for (i = 0; i < clin; i++) {
 			/* don't relay messages to remote clients */
 			if (cli_type[i] == CT_REMOTE)
 				continue;
+			if (!wants_event(clis[i], &b))
+				continue;
 			LOGPRINTF(1, "writing to client %d", i);
 			if (write_socket(clis[i], buffer, length) < length) {
 				remove_client(clis[i]);
@@ -1029,12 +1799,15 @@ void logprintf(int prio, const char *format_str, ...)
 	if (!log_enabled)
 		return;
 
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&log_mutex);
+#endif
 	if (lf) {
 		time_t current;
-		char *currents;
+		char currents[32];
 
 		current = time(&current);
-		currents = ctime(&current);
+		ctime_r(&current, currents);
 
 		fprintf(lf, "%15.15s %s %s: ", currents + 4, hostname, progname);
 		va_start(ap, format_str);
@@ -1055,6 +1828,9 @@ void logprintf(int prio, const char *format_str, ...)
 		fflush(stderr);
 		va_end(ap);
 	}
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&log_mutex);
+#endif
 	errno = save_errno;
 }
 
@@ -1115,7 +1891,7 @@ void dosigalrm(int sig)
 			repeat_message = NULL;
 		}
 		if (!use_hw() && hw.deinit_func) {
-			hw.deinit_func();
+			stop_hardware();
 		}
 		return;
 	}
@@ -1123,7 +1899,7 @@ void dosigalrm(int sig)
 	    || (repeat_code->transmit_state != NULL && repeat_code->transmit_state->next == NULL)) {
 		repeat_remote->repeat_countdown--;
 	}
-	if (send_ir_ncode(repeat_remote, repeat_code) && repeat_remote->repeat_countdown > 0) {
+	if (send_code(repeat_remote, repeat_code) && repeat_remote->repeat_countdown > 0) {
 		repeat_timer.it_value.tv_sec = 0;
 		repeat_timer.it_value.tv_usec = repeat_remote->min_remaining_gap;
 		repeat_timer.it_interval.tv_sec = 0;
@@ -1141,7 +1917,7 @@ void dosigalrm(int sig)
 		repeat_fd = -1;
 	}
 	if (!use_hw() && hw.deinit_func) {
-		hw.deinit_func();
+		stop_hardware();
 	}
 }
 
@@ -1201,11 +1977,14 @@ arg_check:
 
 int send_success(int fd, char *message)
 {
-	if (!
-	    (write_socket_len(fd, protocol_string[P_BEGIN]) && write_socket_len(fd, message)
-	     && write_socket_len(fd, protocol_string[P_SUCCESS]) && write_socket_len(fd, protocol_string[P_END])))
-		return (0);
-	return (1);
+	struct reply r;
+
+	reply_begin(&r, fd);
+	reply_add_string(&r, protocol_string[P_BEGIN]);
+	reply_add_string(&r, message);
+	reply_add_string(&r, protocol_string[P_SUCCESS]);
+	reply_add_string(&r, protocol_string[P_END]);
+	return (reply_send(&r));
 }
 
 int send_error(int fd, char *message, char *format_str, ...)
@@ -1214,6 +1993,7 @@ int send_error(int fd, char *message, char *format_str, ...)
 	int i, n, len;
 	va_list ap;
 	char *s1, *s2;
+	struct reply r;
 
 	va_start(ap, format_str);
 	vsprintf(buffer, format_str, ap);
@@ -1239,18 +2019,22 @@ int send_error(int fd, char *message, char *format_str, ...)
 			n++;
 	sprintf(lines, "%d\n", n);
 
-	if (!(write_socket_len(fd, protocol_string[P_BEGIN]) &&
-	      write_socket_len(fd, message) && write_socket_len(fd, protocol_string[P_ERROR])
-	      && write_socket_len(fd, protocol_string[P_DATA]) && write_socket_len(fd, lines)
-	      && write_socket_len(fd, buffer) && write_socket_len(fd, protocol_string[P_END])))
-		return (0);
-	return (1);
+	reply_begin(&r, fd);
+	reply_add_string(&r, protocol_string[P_BEGIN]);
+	reply_add_string(&r, message);
+	reply_add_string(&r, protocol_string[P_ERROR]);
+	reply_add_string(&r, protocol_string[P_DATA]);
+	reply_add_string(&r, lines);
+	reply_add(&r, buffer, len);
+	reply_add_string(&r, protocol_string[P_END]);
+	return (reply_send(&r));
 }
 
 int send_remote_list(int fd, char *message)
 {
 	char buffer[PACKET_SIZE + 1];
 	struct ir_remote *all;
+	struct reply r;
 	int n, len;
 
 	n = 0;
@@ -1260,36 +2044,33 @@ int send_remote_list(int fd, char *message)
 		all = all->next;
 	}
 
-	if (!
-	    (write_socket_len(fd, protocol_string[P_BEGIN]) && write_socket_len(fd, message)
-	     && write_socket_len(fd, protocol_string[P_SUCCESS])))
-		return (0);
-
-	if (n == 0) {
-		return (write_socket_len(fd, protocol_string[P_END]));
+	reply_begin(&r, fd);
+	reply_add_string(&r, protocol_string[P_BEGIN]);
+	reply_add_string(&r, message);
+	reply_add_string(&r, protocol_string[P_SUCCESS]);
+	if (n > 0) {
+		sprintf(buffer, "%d\n", n);
+		reply_add_string(&r, protocol_string[P_DATA]);
+		reply_add_string(&r, buffer);
 	}
-	sprintf(buffer, "%d\n", n);
-	len = strlen(buffer);
-	if (!(write_socket_len(fd, protocol_string[P_DATA]) && write_socket_len(fd, buffer)))
-		return (0);
-
 	all = remotes;
 	while (all) {
 		len = snprintf(buffer, PACKET_SIZE + 1, "%s\n", all->name);
 		if (len >= PACKET_SIZE + 1) {
 			len = sprintf(buffer, "name_too_long\n");
 		}
-		if (write_socket(fd, buffer, len) < len)
-			return (0);
+		reply_add(&r, buffer, len);
 		all = all->next;
 	}
-	return (write_socket_len(fd, protocol_string[P_END]));
+	reply_add_string(&r, protocol_string[P_END]);
+	return (reply_send(&r));
 }
 
 int send_remote(int fd, char *message, struct ir_remote *remote)
 {
 	struct ir_ncode *codes;
 	char buffer[PACKET_SIZE + 1];
+	struct reply r;
 	int n, len;
 
 	n = 0;
@@ -1301,46 +2082,48 @@ int send_remote(int fd, char *message, struct ir_remote *remote)
 		}
 	}
 
-	if (!
-	    (write_socket_len(fd, protocol_string[P_BEGIN]) && write_socket_len(fd, message)
-	     && write_socket_len(fd, protocol_string[P_SUCCESS])))
-		return (0);
-	if (n == 0) {
-		return (write_socket_len(fd, protocol_string[P_END]));
-	}
-	sprintf(buffer, "%d\n", n);
-	if (!(write_socket_len(fd, protocol_string[P_DATA]) && write_socket_len(fd, buffer)))
-		return (0);
+	reply_begin(&r, fd);
+	reply_add_string(&r, protocol_string[P_BEGIN]);
+	reply_add_string(&r, message);
+	reply_add_string(&r, protocol_string[P_SUCCESS]);
+	if (n > 0) {
+		sprintf(buffer, "%d\n", n);
+		reply_add_string(&r, protocol_string[P_DATA]);
+		reply_add_string(&r, buffer);
 
-	codes = remote->codes;
-	while (codes->name != NULL) {
-		len = snprintf(buffer, PACKET_SIZE, "%016llx %s\n", (unsigned long long)codes->code, codes->name);
-		if (len >= PACKET_SIZE + 1) {
-			len = sprintf(buffer, "code_too_long\n");
+		codes = remote->codes;
+		while (codes->name != NULL) {
+			len = snprintf(buffer, PACKET_SIZE, "%016llx %s\n", (unsigned long long)codes->code,
+				       codes->name);
+			if (len >= PACKET_SIZE + 1) {
+				len = sprintf(buffer, "code_too_long\n");
+			}
+			reply_add(&r, buffer, len);
+			codes++;
 		}
-		if (write_socket(fd, buffer, len) < len)
-			return (0);
-		codes++;
 	}
-	return (write_socket_len(fd, protocol_string[P_END]));
+	reply_add_string(&r, protocol_string[P_END]);
+	return (reply_send(&r));
 }
 
 int send_name(int fd, char *message, struct ir_ncode *code)
 {
 	char buffer[PACKET_SIZE + 1];
+	struct reply r;
 	int len;
 
-	if (!
-	    (write_socket_len(fd, protocol_string[P_BEGIN]) && write_socket_len(fd, message)
-	     && write_socket_len(fd, protocol_string[P_SUCCESS]) && write_socket_len(fd, protocol_string[P_DATA])))
-		return (0);
 	len = snprintf(buffer, PACKET_SIZE, "1\n%016llx %s\n", (unsigned long long)code->code, code->name);
 	if (len >= PACKET_SIZE + 1) {
 		len = sprintf(buffer, "1\ncode_too_long\n");
 	}
-	if (write_socket(fd, buffer, len) < len)
-		return (0);
-	return (write_socket_len(fd, protocol_string[P_END]));
+	reply_begin(&r, fd);
+	reply_add_string(&r, protocol_string[P_BEGIN]);
+	reply_add_string(&r, message);
+	reply_add_string(&r, protocol_string[P_SUCCESS]);
+	reply_add_string(&r, protocol_string[P_DATA]);
+	reply_add(&r, buffer, len);
+	reply_add_string(&r, protocol_string[P_END]);
+	return (reply_send(&r));
 }
 
 int list(int fd, char *message, char *arguments)
@@ -1456,6 +2239,7 @@ int simulate(int fd, char *message, char *arguments)
 	strcpy(sim, arguments);
 	strcat(sim, "\n");
 	broadcast_message(sim);
+	event_ring_publish(sim, NULL, NULL, NULL, NULL, 0);
 	free(sim);
 
 	return (send_success(fd, message));
@@ -1506,7 +2290,7 @@ int send_core(int fd, char *message, char *arguments, int once)
 		remote->toggle_bit_mask_state = (remote->toggle_bit_mask_state ^ remote->toggle_bit_mask);
 	}
 	code->transmit_state = NULL;
-	if (!send_ir_ncode(remote, code)) {
+	if (!send_code(remote, code)) {
 		return (send_error(fd, message, "transmission failed\n"));
 	}
 	gettimeofday(&remote->last_send, NULL);
@@ -1592,191 +2376,417 @@ int send_stop(int fd, char *message, char *arguments)
 int version(int fd, char *message, char *arguments)
 {
 	char buffer[PACKET_SIZE + 1];
+	struct reply r;
 
 	if (arguments != NULL) {
 		return (send_error(fd, message, "bad send packet\n"));
 	}
 	sprintf(buffer, "1\n%s\n", VERSION);
-	if (!(write_socket_len(fd, protocol_string[P_BEGIN]) &&
-	      write_socket_len(fd, message) && write_socket_len(fd, protocol_string[P_SUCCESS])
-	      && write_socket_len(fd, protocol_string[P_DATA]) && write_socket_len(fd, buffer)
-	      && write_socket_len(fd, protocol_string[P_END])))
+	reply_begin(&r, fd);
+	reply_add_string(&r, protocol_string[P_BEGIN]);
+	reply_add_string(&r, message);
+	reply_add_string(&r, protocol_string[P_SUCCESS]);
+	reply_add_string(&r, protocol_string[P_DATA]);
+	reply_add_string(&r, buffer);
+	reply_add_string(&r, protocol_string[P_END]);
+	return (reply_send(&r));
+}
+
+int decode_stats(int fd, char *message, char *arguments)
+{
+	char buffer[PACKET_SIZE + 1];
+	struct ir_remote **order, *remote;
+	struct reply r;
+	int i, n, len;
+
+	if (arguments != NULL) {
+		return (send_error(fd, message, "bad send packet\n"));
+	}
+	/* in the order decode_all() tries them */
+	order = decode_order(remotes, &n);
+	if (order == NULL) {
+		return (send_error(fd, message, "out of memory\n"));
+	}
+	reply_begin(&r, fd);
+	reply_add_string(&r, protocol_string[P_BEGIN]);
+	reply_add_string(&r, message);
+	reply_add_string(&r, protocol_string[P_SUCCESS]);
+	if (n > 0) {
+		reply_add_string(&r, protocol_string[P_DATA]);
+		len = sprintf(buffer, "%d\n", n);
+		reply_add(&r, buffer, len);
+	}
+	for (i = 0; i < n; i++) {
+		remote = order[i];
+		len = snprintf(buffer, PACKET_SIZE + 1, "%s %lu %lu %llu\n", remote->name, remote->decode_hits,
+			       remote->decode_misses,
+			       remote->decode_misses ? remote->decode_miss_time / remote->decode_misses : 0);
+		if (len >= PACKET_SIZE + 1) {
+			len = sprintf(buffer, "name_too_long\n");
+		}
+		reply_add(&r, buffer, len);
+	}
+	reply_add_string(&r, protocol_string[P_END]);
+	return (reply_send(&r));
+}
+
+int set_repeat_rate(int fd, char *message, char *arguments)
+{
+	char *rate, *end;
+	unsigned long n;
+
+	if (arguments == NULL) {
+		return (send_error(fd, message, "no arguments given\n"));
+	}
+	rate = strtok(arguments, WHITE_SPACE);
+	if (rate == NULL || strtok(NULL, WHITE_SPACE) != NULL) {
+		return (send_error(fd, message, "bad send packet\n"));
+	}
+	n = strtoul(rate, &end, 10);
+	if (*end || n > 1000000) {
+		return (send_error(fd, message, "invalid argument\n"));
+	}
+	/* 0 sends every repeat again */
+	cli_options[fd].repeat_interval = n ? 1000000 / n : 0;
+	return (send_success(fd, message));
+}
+
+/*
+  SUBSCRIBE takes remote/button patterns with the wildcards of the
+  shell, compared without regard to case like lircrc does. They are
+  turned into a bit for every button of the config, so an event only
+  has to look up its button. Events of buttons that are not in the
+  config, e.g. from peers or SIMULATE, are matched against the
+  patterns themselves.
+*/
+static int match_pattern(struct client_options *options, const char *remote_name, const char *button_name)
+{
+	const char *remote, *button;
+	int i;
+
+	for (i = 0; i < options->pattern_count; i++) {
+		remote = options->patterns[i];
+		button = remote + strlen(remote) + 1;
+		if (fnmatch(remote, remote_name, FNM_CASEFOLD) == 0 && fnmatch(button, button_name, FNM_CASEFOLD) == 0)
+			return (1);
+	}
+	return (0);
+}
+
+static int compile_subscription(struct client_options *options)
+{
+	struct ir_remote *remote;
+	struct ir_ncode *code;
+	unsigned char *subscribed;
+	int id;
+
+	subscribed = calloc(button_total / CHAR_BIT + 1, 1);
+	if (subscribed == NULL) {
 		return (0);
+	}
+	for (remote = remotes; remote != NULL; remote = remote->next) {
+		if (remote->codes == NULL)
+			continue;
+		id = remote->button_base;
+		for (code = remote->codes; code->name != NULL; code++, id++) {
+			if (match_pattern(options, remote->name, code->name))
+				subscribed[id / CHAR_BIT] |= 1 << (id % CHAR_BIT);
+		}
+	}
+	free(options->subscribed);
+	options->subscribed = subscribed;
 	return (1);
 }
 
-int get_command(int fd)
+/* number the remotes and buttons of a new config and recompile all
+   subscriptions */
+static void compile_subscriptions(void)
 {
-	int length;
-	char buffer[PACKET_SIZE + 1], backup[PACKET_SIZE + 1];
-	char *end;
-	int packet_length, i;
-	char *directive;
+	struct ir_remote *remote;
+	struct ir_ncode *code;
+	struct client_options *options;
+	int i;
 
-	length = read_timeout(fd, buffer, PACKET_SIZE, 0);
-	packet_length = 0;
-	while (length > packet_length) {
-		buffer[length] = 0;
-		end = strchr(buffer, '\n');
-		if (end == NULL) {
-			logprintf(LOG_ERR, "bad send packet: \"%s\"", buffer);
-			/* remove clients that behave badly */
-			return (0);
+	/* buttons of the old config are looked up by name */
+	for (remote = free_remotes; remote != NULL; remote = remote->next)
+		remote->index = remote->button_base = -1;
+	button_total = 0;
+	for (remote = remotes, i = 0; remote != NULL; remote = remote->next, i++) {
+		remote->index = i;
+		remote->button_base = button_total;
+		if (remote->codes == NULL)
+			continue;
+		for (code = remote->codes; code->name != NULL; code++)
+			button_total++;
+	}
+	for (i = 0; i < clin; i++) {
+		options = &cli_options[clis[i]];
+		if (options->pattern_count > 0 && !compile_subscription(options)) {
+			/* match the names then */
+			free(options->subscribed);
+			options->subscribed = NULL;
 		}
-		end[0] = 0;
-		LOGPRINTF(1, "received command: \"%s\"", buffer);
-		packet_length = strlen(buffer) + 1;
+	}
+}
 
-		strcpy(backup, buffer);
-		strcat(backup, "\n");
+static int is_subscribed(struct client_options *options, struct broadcast *b)
+{
+	struct ir_remote *remote;
+	struct ir_ncode *code;
 
-		/* remove DOS line endings */
-		end = strrchr(buffer, '\r');
-		if (end && end[1] == 0)
-			*end = 0;
+	if (options->subscribed != NULL) {
+		/* only events that were not just decoded, like SIMULATE */
+		if (b->id == -2) {
+			b->id = -1;
+			remote = get_ir_remote(remotes, (char *)b->remote_name);
+			if (remote != NULL && remote->codes != NULL) {
+				code = get_code_by_name(remote, (char *)b->button_name);
+				if (code != NULL)
+					b->id = remote->button_base + (code - remote->codes);
+			}
+		}
+		if (b->id >= 0)
+			return ((options->subscribed[b->id / CHAR_BIT] >> (b->id % CHAR_BIT)) & 1);
+	}
+	return (match_pattern(options, b->remote_name, b->button_name));
+}
 
-		directive = strtok(buffer, WHITE_SPACE);
-		if (directive == NULL) {
-			if (!send_error(fd, backup, "bad send packet\n"))
-				return (0);
-			goto skip;
+static void free_subscription(struct client_options *options)
+{
+	int i;
+
+	for (i = 0; i < options->pattern_count; i++)
+		free(options->patterns[i]);
+	free(options->patterns);
+	free(options->subscribed);
+	options->patterns = NULL;
+	options->pattern_count = 0;
+	options->subscribed = NULL;
+}
+
+int subscribe(int fd, char *message, char *arguments)
+{
+	struct client_options *options = &cli_options[fd];
+	char **patterns, *pattern, *remote, *button;
+	size_t len;
+
+	if (arguments == NULL) {
+		return (send_error(fd, message, "no arguments given\n"));
+	}
+	for (pattern = strtok(arguments, WHITE_SPACE); pattern != NULL; pattern = strtok(NULL, WHITE_SPACE)) {
+		/* a remote alone stands for all of its buttons */
+		remote = pattern;
+		button = strchr(pattern, '/');
+		if (button != NULL)
+			*button++ = 0;
+		if (button == NULL || *button == 0)
+			button = "*";
+		if (*remote == 0)
+			remote = "*";
+		patterns = realloc(options->patterns, (options->pattern_count + 1) * sizeof(*patterns));
+		if (patterns == NULL) {
+			return (send_error(fd, message, "out of memory\n"));
 		}
-		for (i = 0; directives[i].name != NULL; i++) {
-			if (strcasecmp(directive, directives[i].name) == 0) {
-				if (!directives[i].function(fd, backup, strtok(NULL, "")))
-					return (0);
-				goto skip;
-			}
+		options->patterns = patterns;
+		len = strlen(remote) + 1;
+		patterns[options->pattern_count] = malloc(len + strlen(button) + 1);
+		if (patterns[options->pattern_count] == NULL) {
+			return (send_error(fd, message, "out of memory\n"));
 		}
+		strcpy(patterns[options->pattern_count], remote);
+		strcpy(patterns[options->pattern_count] + len, button);
+		options->pattern_count++;
+	}
+	if (!compile_subscription(options)) {
+		free(options->subscribed);
+		options->subscribed = NULL;
+	}
+	return (send_success(fd, message));
+}
 
-		if (!send_error(fd, backup, "unknown directive: \"%s\"\n", directive))
-			return (0);
-skip:
-		if (length > packet_length) {
-			int new_length;
-
-			memmove(buffer, buffer + packet_length, length - packet_length + 1);
-			if (strchr(buffer, '\n') == NULL) {
-				new_length =
-				    read_timeout(fd, buffer + length - packet_length,
-						 PACKET_SIZE - (length - packet_length), 5);
-				if (new_length > 0) {
-					length = length - packet_length + new_length;
-				} else {
-					length = new_length;
-				}
-			} else {
-				length -= packet_length;
-			}
-			packet_length = 0;
+int unsubscribe(int fd, char *message, char *arguments)
+{
+	if (arguments != NULL) {
+		return (send_error(fd, message, "bad send packet\n"));
+	}
+	free_subscription(&cli_options[fd]);
+	return (send_success(fd, message));
+}
+
+/*
+  Directives are found through a hash of their length and their first
+  and last character, which puts each of the current ones into a slot
+  of its own. Collisions of new ones are resolved by probing the next
+  slots.
+*/
+#define DIRECTIVE_HASH_SIZE 16
+
+static int directive_hash(const char *name, int len)
+{
+	return ((3 * len + tolower((unsigned char)name[0]) + tolower((unsigned char)name[len - 1])) &
+		(DIRECTIVE_HASH_SIZE - 1));
+}
+
+static struct protocol_directive *find_directive(const char *name, int len)
+{
+	static signed char table[DIRECTIVE_HASH_SIZE];
+	static int initialized = 0;
+	struct protocol_directive *d;
+	int i, h;
+
+	if (!initialized) {
+		memset(table, -1, sizeof(table));
+		for (i = 0; directives[i].name != NULL; i++) {
+			h = directive_hash(directives[i].name, strlen(directives[i].name));
+			while (table[h] != -1)
+				h = (h + 1) & (DIRECTIVE_HASH_SIZE - 1);
+			table[h] = i;
 		}
+		initialized = 1;
 	}
+	for (h = directive_hash(name, len); table[h] != -1; h = (h + 1) & (DIRECTIVE_HASH_SIZE - 1)) {
+		d = &directives[(int)table[h]];
+		if (strncasecmp(name, d->name, len) == 0 && d->name[len] == 0)
+			return (d);
+	}
+	return (NULL);
+}
 
-	if (length == 0) {	/* EOF: connection closed by client */
-		return (0);
+/* handles the command in line, which ends with the '\n' at end */
+static int do_command(int fd, char *line, char *end)
+{
+	char arguments[PACKET_SIZE + 1];
+	char *directive, *next, *stop, saved;
+	struct protocol_directive *d;
+	int ret;
+
+	*end = 0;
+	LOGPRINTF(1, "received command: \"%s\"", line);
+	*end = '\n';
+
+	/* the line is answered as it is, so it is terminated after the
+	   '\n' for the time of the command, and the arguments, which the
+	   directives take apart, are copied */
+	saved = end[1];
+	end[1] = 0;
+
+	/* remove DOS line endings */
+	stop = end;
+	if (stop > line && stop[-1] == '\r')
+		stop--;
+
+	directive = line + strspn(line, WHITE_SPACE);
+	for (next = directive; next < stop && *next != ' ' && *next != '\t'; next++) ;
+	if (next == directive) {
+		ret = send_error(fd, line, "bad send packet\n");
+	} else if ((d = find_directive(directive, next - directive)) == NULL) {
+		ret = send_error(fd, line, "unknown directive: \"%.*s\"\n", (int)(next - directive), directive);
+	} else if (next + 1 < stop) {
+		memcpy(arguments, next + 1, stop - next - 1);
+		arguments[stop - next - 1] = 0;
+		ret = d->function(fd, line, arguments);
+	} else {
+		ret = d->function(fd, line, NULL);
 	}
+	end[1] = saved;
+	return (ret);
+}
+
+/*
+  Commands are collected in a buffer of each client, whatever has
+  arrived is read at once and every complete line in it is handled.
+  An incomplete line waits there for the rest of it.
+*/
+int get_command(int fd)
+{
+	struct client_input *input = cli_input[fd];
+	char *line, *end;
+	int length, space;
+
+	do {
+		space = CLIENT_BUFFER_SIZE - input->len;
+		length = read(fd, input->data + input->len, space);
+		if (length == -1 && (errno == EAGAIN || errno == EINTR))
+			return (1);
+		if (length <= 0) {	/* EOF: connection closed by client */
+			return (0);
+		}
+		input->len += length;
+
+		line = input->data;
+		while ((end = memchr(line, '\n', input->data + input->len - line)) != NULL) {
+			if (end - line >= PACKET_SIZE)
+				break;
+			if (!do_command(fd, line, end))
+				return (0);
+			line = end + 1;
+		}
+		input->len -= line - input->data;
+		if (end != NULL || input->len >= PACKET_SIZE) {
+			logprintf(LOG_ERR, "bad send packet: \"%.*s\"", PACKET_SIZE, line);
+			/* remove clients that behave badly */
+			return (0);
+		}
+		memmove(input->data, line, input->len);
+	} while (length == space);
 	return (1);
 }
 
+/*
+  The old config is freed once nothing points into it any more. The
+  decoder state is not carried over to the new one: a button held
+  during the reload is released and its further repeats are lost,
+  and a SEND_START of the old config keeps it alive until SEND_STOP.
+*/
 void free_old_remotes()
 {
-	struct ir_remote *scan_remotes, *found;
-	struct ir_ncode *code;
 	const char *release_event;
-	const char *release_remote_name;
-	const char *release_button_name;
+	struct ir_remote *release_remote;
+	struct ir_ncode *release_ncode;
 
 	if (decoding == free_remotes)
 		return;
 
-	release_event = release_map_remotes(free_remotes, remotes, &release_remote_name, &release_button_name);
+	release_event = release_old_remotes(free_remotes, &release_remote, &release_ncode);
 	if (release_event != NULL) {
-		input_message(release_event, release_remote_name, release_button_name, 0, 1);
-	}
-	if (last_remote != NULL) {
-		if (is_in_remotes(free_remotes, last_remote)) {
-			logprintf(LOG_INFO, "last_remote found");
-			found = get_ir_remote(remotes, last_remote->name);
-			if (found != NULL) {
-				code = get_code_by_name(found, last_remote->last_code->name);
-				if (code != NULL) {
-					found->reps = last_remote->reps;
-					found->toggle_bit_mask_state = last_remote->toggle_bit_mask_state;
-					found->min_remaining_gap = last_remote->min_remaining_gap;
-					found->max_remaining_gap = last_remote->max_remaining_gap;
-					found->last_send = last_remote->last_send;
-					last_remote = found;
-					last_remote->last_code = code;
-					logprintf(LOG_INFO, "mapped last_remote");
-				}
-			}
-		} else {
-			last_remote = NULL;
-		}
+		input_message(release_event, release_remote, release_ncode, 0, 1);
 	}
-	/* check if last config is still needed */
-	found = NULL;
-	if (repeat_remote != NULL) {
-		scan_remotes = free_remotes;
-		while (scan_remotes != NULL) {
-			if (repeat_remote == scan_remotes) {
-				found = repeat_remote;
-				break;
-			}
-			scan_remotes = scan_remotes->next;
-		}
-		if (found != NULL) {
-			found = get_ir_remote(remotes, repeat_remote->name);
-			if (found != NULL) {
-				code = get_code_by_name(found, repeat_code->name);
-				if (code != NULL) {
-					struct itimerval repeat_timer;
-
-					repeat_timer.it_value.tv_sec = 0;
-					repeat_timer.it_value.tv_usec = 0;
-					repeat_timer.it_interval.tv_sec = 0;
-					repeat_timer.it_interval.tv_usec = 0;
-
-					found->last_code = code;
-					found->last_send = repeat_remote->last_send;
-					found->toggle_bit_mask_state = repeat_remote->toggle_bit_mask_state;
-					found->min_remaining_gap = repeat_remote->min_remaining_gap;
-					found->max_remaining_gap = repeat_remote->max_remaining_gap;
-
-					setitimer(ITIMER_REAL, &repeat_timer, &repeat_timer);
-					/* "atomic" (shouldn't be necessary any more) */
-					repeat_remote = found;
-					repeat_code = code;
-					/* end "atomic" */
-					setitimer(ITIMER_REAL, &repeat_timer, NULL);
-					found = NULL;
-				}
-			} else {
-				found = repeat_remote;
-			}
-		}
+	if (last_remote != NULL && is_in_remotes(free_remotes, last_remote)) {
+		last_remote = NULL;
 	}
-	if (found == NULL && decoding != free_remotes) {
-		free_config(free_remotes);
-		free_remotes = NULL;
-	} else {
+	if (repeat_remote != NULL && is_in_remotes(free_remotes, repeat_remote)) {
 		LOGPRINTF(1, "free_remotes still in use");
+		return;
 	}
+	free_config(free_remotes);
+	free_remotes = NULL;
+	log_memory("after reload");
 }
 
-void input_message(const char *message, const char *remote_name, const char *button_name, int reps, int release)
+void input_message(const char *message, struct ir_remote *remote, struct ir_ncode *ncode, int reps, int release)
 {
 	const char *release_message;
-	const char *release_remote_name;
-	const char *release_button_name;
+	struct ir_remote *release_remote;
+	struct ir_ncode *release_ncode;
 
-	release_message = check_release_event(&release_remote_name, &release_button_name);
+	release_message = check_release_event(&release_remote, &release_ncode);
 	if (release_message) {
-		input_message(release_message, release_remote_name, release_button_name, 0, 1);
+		input_message(release_message, release_remote, release_ncode, 0, 1);
 	}
+	send_input(message, remote->name, ncode->name, remote, ncode, reps, release);
+}
+
+/* remote and ncode are NULL if the button is not known to be in memory */
+static void send_input(const char *message, const char *remote_name, const char *button_name, struct ir_remote *remote,
+		       struct ir_ncode *ncode, int reps, int release)
+{
+	int id = -2;
 
+	if (remote != NULL && remote->button_base >= 0)
+		id = remote->button_base + (ncode - remote->codes);
 	if (!release || userelease) {
-		broadcast_message(message);
+		broadcast_event(message, remote_name, button_name, id, reps);
+		event_ring_publish(message, remote_name, button_name, remote, ncode, release);
 	}
 #ifdef __linux__
 	if (uinputfd != -1) {
@@ -1808,13 +2818,76 @@ void input_message(const char *message, const char *remote_name, const char *but
 #endif
 }
 
-void broadcast_message(const char *message)
+static void broadcast_init(struct broadcast *b, const char *message, const char *remote_name,
+			   const char *button_name, int id, int reps)
+{
+	b->message = message;
+	b->remote_name = remote_name;
+	b->button_name = button_name;
+	b->parsed = remote_name != NULL;
+	b->id = id;
+	b->reps = reps;
+	timerclear(&b->now);
+}
+
+/* "code reps button remote", anything else is no event */
+static void parse_event(struct broadcast *b)
+{
+	unsigned int reps;
+
+	b->parsed = 1;
+	if (sscanf(b->message, "%*x %x %256s %256s", &reps, b->button, b->remote) == 3) {
+		b->reps = reps;
+		b->remote_name = b->remote;
+		b->button_name = b->button;
+	} else {
+		b->reps = 0;
+	}
+}
+
+/*
+  A client that set a repeat rate gets every press and release but
+  only as many repeats as it asked for. The repeat count of the
+  messages goes on counting, so it still sees how long the button
+  has been held.
+*/
+static int wants_event(int fd, struct broadcast *b)
+{
+	struct client_options *options = &cli_options[fd];
+	struct timeval gap;
+
+	if (options->pattern_count == 0 && options->repeat_interval == 0)
+		return (1);
+	if (!b->parsed)
+		parse_event(b);
+	if (b->remote_name == NULL)
+		return (1);
+	if (options->pattern_count > 0 && !is_subscribed(options, b))
+		return (0);
+	if (options->repeat_interval == 0)
+		return (1);
+	if (!timerisset(&b->now))
+		gettimeofday(&b->now, NULL);
+	if (b->reps > 0) {
+		timersub(&b->now, &options->last_event, &gap);
+		if (gap.tv_sec == 0 && gap.tv_usec < options->repeat_interval)
+			return (0);
+	}
+	options->last_event = b->now;
+	return (1);
+}
+
+static void broadcast_event(const char *message, const char *remote_name, const char *button_name, int id, int reps)
 {
 	int len, i;
+	struct broadcast b;
 
 	len = strlen(message);
+	broadcast_init(&b, message, remote_name, button_name, id, reps);
 
 	for (i = 0; i < clin; i++) {
+		if (!wants_event(clis[i], &b))
+			continue;
 		LOGPRINTF(1, "writing to client %d", i);
 		if (write_socket(clis[i], message, len) < len) {
 			remove_client(clis[i]);
@@ -1823,14 +2896,24 @@ void broadcast_message(const char *message)
 	}
 }
 
+void broadcast_message(const char *message)
+{
+	broadcast_event(message, NULL, NULL, -2, 0);
+}
+
 int waitfordata(long maxusec)
 {
 	fd_set fds;
 	int maxfd, i, ret, reconnect;
 	struct timeval tv, start, now, timeout, release_time;
 
+#ifdef HAVE_PTHREAD
+	if (threads && pthread_equal(pthread_self(), receive_self))
+		return (wait_for_device(maxusec));
+#endif
 	while (1) {
 		do {
+			lock_decoder();
 			/* handle signals */
 			if (term) {
 				dosigterm(termsig);
@@ -1852,10 +2935,20 @@ int waitfordata(long maxusec)
 				FD_SET(sockinet, &fds);
 				maxfd = max(maxfd, sockinet);
 			}
-			if (use_hw() && hw.rec_mode != 0 && hw.fd != -1) {
+			if (!receive_running && use_hw() && hw.rec_mode != 0 && hw.fd != -1) {
 				FD_SET(hw.fd, &fds);
 				maxfd = max(maxfd, hw.fd);
 			}
+#ifdef HAVE_PTHREAD
+			if (reload_running) {
+				FD_SET(reload_pipe[0], &fds);
+				maxfd = max(maxfd, reload_pipe[0]);
+			}
+			if (threads) {
+				FD_SET(event_pipe[0], &fds);
+				maxfd = max(maxfd, event_pipe[0]);
+			}
+#endif
 
 			for (i = 0; i < clin; i++) {
 				/* Ignore this client until codes have been
@@ -1896,7 +2989,7 @@ int waitfordata(long maxusec)
 				tv.tv_sec = maxusec / 1000000;
 				tv.tv_usec = maxusec % 1000000;
 			}
-			if (hw.fd == -1 && use_hw()) {
+			if (!receive_running && hw.fd == -1 && use_hw()) {
 				/* try to reconnect */
 				timerclear(&timeout);
 				timeout.tv_sec = 1;
@@ -1919,6 +3012,7 @@ int waitfordata(long maxusec)
 					}
 				}
 			}
+			unlock_decoder();
 #ifdef SIM_REC
 			ret = select(maxfd + 1, &fds, NULL, NULL, NULL);
 #else
@@ -1934,20 +3028,39 @@ int waitfordata(long maxusec)
 				raise(SIGTERM);
 				continue;
 			}
+			lock_decoder();
+#ifdef HAVE_PTHREAD
+			if (threads && ret > 0 && FD_ISSET(event_pipe[0], &fds)) {
+				send_decoded_events();
+			}
+#endif
+			/* the decode thread may have moved it */
+			get_release_time(&release_time);
 			gettimeofday(&now, NULL);
 			if (timerisset(&release_time) && timercmp(&now, &release_time, >)) {
 				const char *release_message;
-				const char *release_remote_name;
-				const char *release_button_name;
+				struct ir_remote *release_remote;
+				struct ir_ncode *release_ncode;
 
-				release_message = trigger_release_event(&release_remote_name, &release_button_name);
+				release_message = trigger_release_event(&release_remote, &release_ncode);
 				if (release_message) {
-					input_message(release_message, release_remote_name, release_button_name, 0, 1);
+					input_message(release_message, release_remote, release_ncode, 0, 1);
 				}
 			}
+#ifdef HAVE_PTHREAD
+			if (reload_running && ret > 0 && FD_ISSET(reload_pipe[0], &fds)) {
+				finish_reload();
+			}
+#endif
 			if (free_remotes != NULL) {
 				free_old_remotes();
 			}
+#ifdef HAVE_PTHREAD
+			if (reload_again && free_remotes == NULL) {
+				reload_config();
+			}
+#endif
+			unlock_decoder();
 			if (maxusec > 0) {
 				if (ret == 0) {
 					return (0);
@@ -1965,9 +3078,10 @@ int waitfordata(long maxusec)
 		}
 		while (ret == -1 && errno == EINTR);
 
-		if (hw.fd == -1 && use_hw() && hw.init_func) {
+		lock_decoder();
+		if (!receive_running && hw.fd == -1 && use_hw() && hw.init_func) {
 			log_enable(0);
-			hw.init_func();
+			(void)start_hardware();
 			setup_hardware();
 			log_enable(1);
 		}
@@ -2001,7 +3115,8 @@ int waitfordata(long maxusec)
 			LOGPRINTF(1, "registering inet client");
 			add_client(sockinet);
 		}
-		if (use_hw() && hw.rec_mode != 0 && hw.fd != -1 && FD_ISSET(hw.fd, &fds)) {
+		unlock_decoder();
+		if (!receive_running && use_hw() && hw.rec_mode != 0 && hw.fd != -1 && FD_ISSET(hw.fd, &fds)) {
 			register_input();
 			/* we will read later */
 			return (1);
@@ -2009,30 +3124,80 @@ int waitfordata(long maxusec)
 	}
 }
 
+/* which other remotes the last signal matched, 0 if it does not fit */
+static int format_ambiguity(char *packet, size_t size)
+{
+	int i, n, len;
+
+	n = decode_candidate_count < MAX_DECODE_CANDIDATES ? decode_candidate_count : MAX_DECODE_CANDIDATES;
+	len = snprintf(packet, size, "%s%s%s%d\n", protocol_string[P_BEGIN], protocol_string[P_AMBIGUOUS],
+		       protocol_string[P_DATA], n);
+	for (i = 0; i < n; i++) {
+		char fit[16];
+
+		/* fit in permille, "?" if the driver cannot tell */
+		if (decode_candidates[i].fit >= 0)
+			sprintf(fit, "%d", decode_candidates[i].fit);
+		else
+			strcpy(fit, "?");
+		len += snprintf(packet + len, size - len, "fit=%s %s %s\n", fit,
+				decode_candidates[i].ncode->name, decode_candidates[i].remote->name);
+		if (len >= size)
+			return (0);
+	}
+	if (len + strlen(protocol_string[P_END]) >= size)
+		return (0);
+	strcpy(packet + len, protocol_string[P_END]);
+	return (1);
+}
+
+/* tell clients which other remotes the last signal matched */
+static void broadcast_ambiguity(void)
+{
+	char packet[PACKET_SIZE * (MAX_DECODE_CANDIDATES + 1)];
+
+	if (format_ambiguity(packet, sizeof(packet)))
+		broadcast_message(packet);
+}
+
 void loop()
 {
 	char *message;
 
 	logprintf(LOG_NOTICE, "lircd(%s) ready, using %s", hw.name, lircdfile);
+#ifdef HAVE_PTHREAD
+	if (threads)
+		start_threads();
+#endif
 	while (1) {
-		(void)waitfordata(0);
-		if (!hw.rec_func)
+		/* the decode thread takes over while the receive
+		   thread is running */
+		if (receive_running || !hw.pending_func || !hw.pending_func())
+			(void)waitfordata(0);
+		if (!hw.rec_func || receive_running)
 			continue;
+		lock_decoder();
 		message = hw.rec_func(remotes);
 
 		if (message != NULL) {
-			const char *remote_name;
-			const char *button_name;
+			struct ir_remote *remote;
+			struct ir_ncode *ncode;
 			int reps;
 
 			if (hw.ioctl_func && (hw.features & LIRC_CAN_NOTIFY_DECODE)) {
 				hw.ioctl_func(LIRC_NOTIFY_DECODE, NULL);
 			}
 
-			get_release_data(&remote_name, &button_name, &reps);
+			get_release_data(&remote, &ncode, &reps);
 
-			input_message(message, remote_name, button_name, reps, 0);
+			input_message(message, remote, ncode, reps, 0);
+
+			/* repeats of an ambiguous signal are ambiguous too */
+			if (report_ambiguities && decode_candidate_count > 1 && decode_candidates[0].remote->reps == 0)
+				broadcast_ambiguity();
+			decode_candidate_count = 0;
 		}
+		unlock_decoder();
 	}
 }
 
@@ -2070,12 +3235,25 @@ int main(int argc, char **argv)
 			{"uinput", no_argument, NULL, 'u'},
 #                       endif
 			{"repeat-max", required_argument, NULL, 'R'},
+			{"capture", required_argument, NULL, 'C'},
+			{"shm", optional_argument, NULL, 'S'},
+			{"best-fit", no_argument, NULL, 'b'},
+			{"ambiguities", no_argument, NULL, 'A'},
+			{"receive-buffer", required_argument, NULL, 'B'},
+			{"noise-filter", required_argument, NULL, 'N'},
+			{"adaptive-order", no_argument, NULL, 'O'},
+#                       ifdef HAVE_PTHREAD
+			{"threads", no_argument, NULL, 'T'},
+#                       endif
 			{0, 0, 0, 0}
 		};
-		c = getopt_long(argc, argv, "hvnp:H:d:o:P:l::c:r::aR:"
+		c = getopt_long(argc, argv, "hvnp:H:d:o:P:l::c:r::aR:C:S::bAB:N:O"
 #                               if defined(__linux__)
 				"u"
 #                               endif
+#                               ifdef HAVE_PTHREAD
+				"T"
+#                               endif
 #                               ifndef USE_SYSLOG
 				"L:"
 #                               endif
@@ -2110,6 +3288,16 @@ int main(int argc, char **argv)
 			printf("\t -u --uinput\t\tgenerate Linux input events\n");
 #                       endif
 			printf("\t -R --repeat-max=limit\t\tallow at most this many repeats\n");
+			printf("\t -C --capture=file[:size]\trecord received data, rotate after size kB\n");
+			printf("\t -S --shm[=name]\t\tpublish events in shared memory\n");
+			printf("\t -b --best-fit\t\t\ttry all remotes, take the closest match\n");
+			printf("\t -A --ambiguities\t\tlike -b, tell clients about other matches\n");
+			printf("\t -B --receive-buffer=samples\tsize of the receive buffer\n");
+			printf("\t -N --noise-filter=usec\t\tignore shorter pulses (0: no filter)\n");
+			printf("\t -O --adaptive-order\t\ttry the remotes used most lately first\n");
+#                       ifdef HAVE_PTHREAD
+			printf("\t -T --threads\t\t\treceive and decode in threads of their own\n");
+#                       endif
 			return (EXIT_SUCCESS);
 		case 'v':
 			printf("%s %s\n", progname, VERSION);
@@ -2202,6 +3390,68 @@ int main(int argc, char **argv)
 		case 'R':
 			repeat_max = atoi(optarg);
 			break;
+		case 'S':
+			shmname = optarg ? optarg : LIRC_SHM_NAME;
+			break;
+		case 'A':
+			report_ambiguities = 1;
+			/* fall through */
+		case 'b':
+			decode_best_fit = 1;
+			break;
+		case 'O':
+			decode_adaptive_order = 1;
+			break;
+		case 'B':
+			{
+				long samples;
+				char *endptr;
+
+				samples = strtol(optarg, &endptr, 10);
+				if (!*optarg || *endptr || samples < RBUF_MIN_SIZE || samples > RBUF_MAX_SIZE) {
+					fprintf(stderr, "%s: receive buffer size must be between %d and %d\n", progname,
+						RBUF_MIN_SIZE, RBUF_MAX_SIZE);
+					return (EXIT_FAILURE);
+				}
+				/* the buffer is a ring of a power of two */
+				for (receive_buffer_size = RBUF_MIN_SIZE; receive_buffer_size < samples; receive_buffer_size *= 2) ;
+			}
+			break;
+		case 'N':
+			{
+				long usec;
+				char *endptr;
+
+				usec = strtol(optarg, &endptr, 10);
+				if (!*optarg || *endptr || usec < 0 || usec > PULSE_MASK) {
+					fprintf(stderr, "%s: bad noise filter length \"%s\"\n", progname, optarg);
+					return (EXIT_FAILURE);
+				}
+				receive_noise_filter = usec;
+			}
+			break;
+#               ifdef HAVE_PTHREAD
+		case 'T':
+			threads = 1;
+			break;
+#               endif
+		case 'C':
+			{
+				char *sep = strrchr(optarg, ':');
+
+				capturefile = optarg;
+				if (sep) {
+					char *endptr;
+
+					capturesize = strtoul(sep + 1, &endptr, 10);
+					if (sep[1] == 0 || *endptr) {
+						fprintf(stderr, "%s: bad capture size \"%s\"\n", progname, sep + 1);
+						return (EXIT_FAILURE);
+					}
+					*sep = 0;
+				}
+			}
+			break;
 		default:
 			printf("Usage: %s [options] [config-file]\n", progname);
 			return (EXIT_FAILURE);
@@ -2217,7 +3467,7 @@ int main(int argc, char **argv)
 	if (device != NULL) {
 		hw.device = device;
 	}
-	if (strcmp(hw.name, "null") == 0 && peern == 0) {
+	if (strcmp(hw.name, "null") == 0 && peern == 0 && !allow_simulate) {
 		fprintf(stderr, "%s: there's no hardware I can use and no peers are specified\n", progname);
 		return (EXIT_FAILURE);
 	}
@@ -2231,6 +3481,13 @@ int main(int argc, char **argv)
 
 	start_server(permission, nodaemon);
 
+	if (capturefile != NULL && !capture_open(capturefile, capturesize * 1024)) {
+		dosigterm(SIGTERM);
+	}
+	if (shmname != NULL && !event_ring_open(shmname)) {
+		dosigterm(SIGTERM);
+	}
+
 	act.sa_handler = sigterm;
 	sigfillset(&act.sa_mask);
 	act.sa_flags = SA_RESTART;	/* don't fiddle with EINTR */
@@ -33,6 +33,7 @@ void sighup(int sig);
 void dosighup(int sig);
 int setup_uinput(const char *name);
 void config(void);
+void reload_config(void);
 void nolinger(int sock);
 void remove_client(int fd);
 void add_client(int);
@@ -74,9 +75,13 @@ int send_start(int fd, char *message, char *arguments);
 int send_stop(int fd, char *message, char *arguments);
 int send_core(int fd, char *message, char *arguments, int once);
 int version(int fd, char *message, char *arguments);
+int decode_stats(int fd, char *message, char *arguments);
+int set_repeat_rate(int fd, char *message, char *arguments);
+int subscribe(int fd, char *message, char *arguments);
+int unsubscribe(int fd, char *message, char *arguments);
 int get_pid(int fd, char *message, char *arguments);
 int get_command(int fd);
-void input_message(const char *message, const char *remote_name, const char *button_name, int reps, int release);
+void input_message(const char *message, struct ir_remote *remote, struct ir_ncode *ncode, int reps, int release);
 void broadcast_message(const char *message);
 int waitfordata(long maxusec);
 void loop(void);
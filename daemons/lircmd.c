@@ -26,6 +26,7 @@
 #include <syslog.h>
 #include <errno.h>
 #include <getopt.h>
+#include <ctype.h>
 
 #include "my_linux_types.h"
 #include <sys/stat.h>
@@ -118,8 +119,19 @@ struct trans_mouse {
 	char *tm_remote;
 	char *tm_button;
 	enum directive tm_directive;
+	int tm_seq;		/* position in config file */
+	struct trans_mouse *tm_hash_next;	/* same bucket, config order */
 } *tm_first = NULL;
 
+/* (remote, button) -> directives, "*" entries are hashed with ALL */
+#define TM_HASH_SIZE 256
+
+struct trans_mouse_index {
+	struct trans_mouse *bucket[TM_HASH_SIZE];
+};
+
+struct trans_mouse_index new_tm_index, tm_index;
+
 enum state_button { button_up, button_down };
 enum state_axis { axis_none, axis_up, axis_down };
 
@@ -209,6 +221,7 @@ void dohup(void)
 	} else {
 		freetm(tm_first);
 		tm_first = tm_list;
+		tm_index = new_tm_index;
 		ms = new_ms;
 	}
 }
@@ -277,17 +290,27 @@ setup_error:
 	return -1;
 }
 
-void write_uinput(__u16 type, __u16 code, __s32 value)
-{
 #ifdef __linux__
-	struct input_event event;
+/*
+  uinput events are queued and written with a single write() once
+  all lines of a read from lircd have been handled. Movements are
+  summed up and reported with one SYN_REPORT.
+*/
+#define UINPUT_QUEUE_SIZE 64
+
+static struct input_event uinput_queue[UINPUT_QUEUE_SIZE];
+static int uinput_queued = 0;
+static int pending_dx = 0, pending_dy = 0, pending_dz = 0;
 
-	memset(&event, 0, sizeof(event));
-	event.type = type;
-	event.code = code;
-	event.value = value;
+static void write_uinput_queue(void)
+{
+	ssize_t len;
 
-	if (write(uinputfd, &event, sizeof(event)) != sizeof(event)) {
+	if (uinput_queued == 0)
+		return;
+	len = uinput_queued * sizeof(struct input_event);
+	uinput_queued = 0;
+	if (write(uinputfd, uinput_queue, len) != len) {
 		static int once = 1;
 
 		if (once) {
@@ -299,9 +322,69 @@ void write_uinput(__u16 type, __u16 code, __s32 value)
 			syslog(LOG_ERR, "%m");
 		}
 	}
+}
+#endif
+
+void write_uinput(__u16 type, __u16 code, __s32 value)
+{
+#ifdef __linux__
+	struct input_event *event;
+
+	if (uinput_queued == UINPUT_QUEUE_SIZE) {
+		write_uinput_queue();
+	}
+	event = &uinput_queue[uinput_queued++];
+	memset(event, 0, sizeof(*event));
+	event->type = type;
+	event->code = code;
+	event->value = value;
+#endif
+}
+
+static void queue_motion(void)
+{
+#ifdef __linux__
+	if (pending_dx != 0 || pending_dy != 0) {
+		write_uinput(EV_REL, REL_X, pending_dx);
+		write_uinput(EV_REL, REL_Y, pending_dy);
+	}
+	if (pending_dz != 0) {
+		write_uinput(EV_REL, REL_WHEEL, pending_dz);
+	}
+	if (pending_dx != 0 || pending_dy != 0 || pending_dz != 0) {
+		write_uinput(EV_SYN, SYN_REPORT, 0);
+	}
+	pending_dx = pending_dy = pending_dz = 0;
+#endif
+}
+
+void flush_uinput(void)
+{
+#ifdef __linux__
+	if (uinputfd == -1)
+		return;
+	queue_motion();
+	write_uinput_queue();
 #endif
 }
 
+static void write_packets(const char *packet, int size, int count)
+{
+	char buffer[32 * 5];
+	int i, n;
+
+	if (lircm == -1)
+		return;
+	while (count > 0) {
+		n = count > 32 ? 32 : count;
+		for (i = 0; i < n; i++) {
+			memcpy(buffer + i * size, packet, size);
+		}
+		write(lircm, buffer, n * size);
+		count -= n;
+	}
+}
+
 void msend(int dx, int dy, int dz, int rep, int buttp, int buttr)
 {
 	static int buttons = 0;
@@ -328,9 +411,7 @@ void msend(int dx, int dy, int dz, int rep, int buttp, int buttr)
 		buffer[2] = dy;
 		buffer[3] = buffer[4] = 0;
 
-		for (i = 0; i < f; i++) {
-			write(lircm, buffer, 5);
-		}
+		write_packets(buffer, 5, f);
 		break;
 	case imps_2:
 		buffer[0] = ((buttons & BUTTON1) ? 0x01 : 0x00)
@@ -342,9 +423,7 @@ void msend(int dx, int dy, int dz, int rep, int buttp, int buttr)
 		buffer[2] = dy + (dy >= 0 ? 0 : 256);
 		buffer[3] = dz;
 
-		for (i = 0; i < f; i++) {
-			write(lircm, buffer, 4);
-		}
+		write_packets(buffer, 4, f);
 		break;
 	case im_serial:
 		dy = -dy;
@@ -358,24 +437,21 @@ void msend(int dx, int dy, int dz, int rep, int buttp, int buttr)
 		    | ((dz > 0) ? 0x01 : 0x00)
 		    | ((buttons & BUTTON2) ? 0x10 : 0x00);
 
-		for (i = 0; i < f; i++) {
-			write(lircm, buffer, 4);
-		}
+		write_packets(buffer, 4, f);
 		break;
 	}
 
 #if defined(__linux__)
 	if (uinputfd != -1) {
+		pending_dx += f * dx;
+		pending_dy += f * dy;
+		pending_dz += f * dz;
+		if (buttp == 0 && buttr == 0) {
+			return;
+		}
+		/* keep the order of movements and button events */
+		queue_motion();
 		for (i = 0; i < f; i++) {
-			if ((dx != 0) || (dy != 0)) {
-				write_uinput(EV_REL, REL_X, dx);
-				write_uinput(EV_REL, REL_Y, dy);
-				write_uinput(EV_SYN, SYN_REPORT, 0);
-			}
-			if (dz != 0) {
-				write_uinput(EV_REL, REL_WHEEL, dz);
-				write_uinput(EV_SYN, SYN_REPORT, 0);
-			}
 			if (buttp & BUTTON1) {
 				write_uinput(EV_KEY, BTN_LEFT, 1);
 				write_uinput(EV_SYN, SYN_REPORT, 0);
@@ -459,6 +535,7 @@ void mouse_circle(int r, int dirx, int diry)
 			x++;
 			incX += 2;
 			d += incX + 1;
+			flush_uinput();
 			usleep(1);
 		}
 	}
@@ -478,25 +555,88 @@ void deactivate()
 	mouse_circle(CIRCLE, -1, 1);
 }
 
+static unsigned int tm_hash_string(const char *s)
+{
+	unsigned int h = 5381;
+
+	if (s == ALL)
+		return 42;
+	while (*s) {
+		h = h * 33 + tolower((unsigned char)*s);
+		s++;
+	}
+	return h;
+}
+
+static unsigned int tm_hash(const char *remote, const char *button)
+{
+	return (tm_hash_string(remote) * 31 + tm_hash_string(button)) % TM_HASH_SIZE;
+}
+
+static int tm_key_match(const char *pattern, const char *key)
+{
+	if (pattern == ALL || key == ALL)
+		return pattern == key;
+	return strcasecmp(pattern, key) == 0;
+}
+
+static struct trans_mouse *tm_next_match(struct trans_mouse *tm, const char *remote, const char *button)
+{
+	while (tm != NULL && !(tm_key_match(tm->tm_remote, remote) && tm_key_match(tm->tm_button, button))) {
+		tm = tm->tm_hash_next;
+	}
+	return tm;
+}
+
+static void build_index(struct trans_mouse *tm_list, struct trans_mouse_index *index)
+{
+	struct trans_mouse *tail[TM_HASH_SIZE];
+	struct trans_mouse *tm;
+	unsigned int h;
+	int seq = 0;
+
+	memset(index, 0, sizeof(*index));
+	memset(tail, 0, sizeof(tail));
+	for (tm = tm_list; tm != NULL; tm = tm->tm_next) {
+		h = tm_hash(tm->tm_remote, tm->tm_button);
+		tm->tm_seq = seq++;
+		tm->tm_hash_next = NULL;
+		if (tail[h] == NULL) {
+			index->bucket[h] = tm;
+		} else {
+			tail[h]->tm_hash_next = tm;
+		}
+		tail[h] = tm;
+	}
+}
+
 void mouse_conv(int rep, char *button, char *remote)
 {
 	struct trans_mouse *tm;
 	int found = 0;
-
-	tm = tm_first;
-	while (tm != NULL) {
-		if (tm->tm_remote != ALL) {
-			if (strcasecmp(remote, tm->tm_remote) != 0) {
-				tm = tm->tm_next;
-				continue;
-			}
-		}
-		if (tm->tm_button != ALL) {
-			if (strcasecmp(button, tm->tm_button) != 0) {
-				tm = tm->tm_next;
-				continue;
+	/* exact, any button, any remote, both wildcards */
+	const char *keys_remote[4] = { remote, remote, ALL, ALL };
+	const char *keys_button[4] = { button, ALL, button, ALL };
+	struct trans_mouse *next[4];
+	int k, best;
+
+	for (k = 0; k < 4; k++) {
+		next[k] = tm_next_match(tm_index.bucket[tm_hash(keys_remote[k], keys_button[k])], keys_remote[k],
+					keys_button[k]);
+	}
+	while (1) {
+		/* merge the four lists back into config file order */
+		best = -1;
+		for (k = 0; k < 4; k++) {
+			if (next[k] != NULL && (best == -1 || next[k]->tm_seq < next[best]->tm_seq)) {
+				best = k;
 			}
 		}
+		if (best == -1)
+			break;
+		tm = next[best];
+		next[best] = tm_next_match(tm->tm_hash_next, keys_remote[best], keys_button[best]);
+
 		if (tm->tm_directive == mouse_activate) {
 			if (ms.active == 0 && ms.always_active == 0) {
 				activate();
@@ -543,6 +683,7 @@ void mouse_conv(int rep, char *button, char *remote)
 						if (down && up) {	/* click */
 							mouse_button(down, 0, rep);
 #ifdef CLICK_DELAY
+							flush_uinput();
 							usleep(CLICK_DELAY);
 #endif
 							mouse_button(0, up, rep);
@@ -556,7 +697,6 @@ void mouse_conv(int rep, char *button, char *remote)
 
 		}
 		found = 1;
-		tm = tm->tm_next;
 	}
 	if (found == 0) {
 		if (ms.active == 1 && ms.always_active == 0 && ms.toggle_active == 0) {
@@ -713,52 +853,74 @@ struct trans_mouse *read_config(FILE * fd)
 			tm_last = tm_new;
 		}
 	}
+	build_index(tm_list, &new_tm_index);
 	return (tm_list);
 }
 
+/* splits "code reps button remote" in place */
+static int parse_line(char *line, int *rep, char **button, char **remote)
+{
+	char *code, *reps, *end;
+
+	code = strtok(line, WHITE_SPACE);
+	reps = strtok(NULL, WHITE_SPACE);
+	*button = strtok(NULL, WHITE_SPACE);
+	*remote = strtok(NULL, WHITE_SPACE);
+	if (code == NULL || reps == NULL || *button == NULL || *remote == NULL) {
+		return 0;
+	}
+	*rep = strtol(reps, &end, 16);
+	if (*end != 0) {
+		return 0;
+	}
+	return 1;
+}
+
 void loop()
 {
-	ssize_t len = 0;
+	ssize_t len;
 	char buffer[PACKET_SIZE + 1];
-	int rep, ret;
-	char button[PACKET_SIZE + 1];
-	char remote[PACKET_SIZE + 1];
-	char *end;
+	int rep;
+	char *button, *remote;
+	char *line, *end;
 	int end_len = 0;
 	sigset_t block;
 
 	sigemptyset(&block);
 	sigaddset(&block, SIGHUP);
-	buffer[0] = 0;
 	while (1) {
 		if (hup) {
 			dohup();
 			hup = 0;
 		}
-		if (strchr(buffer, '\n') == NULL) {
-
-			sigprocmask(SIG_UNBLOCK, &block, NULL);
-			len = read(lircd, buffer + end_len, PACKET_SIZE - end_len);
-			sigprocmask(SIG_BLOCK, &block, NULL);
-			if (len <= 0) {
-				if (len == -1 && errno == EINTR)
-					continue;
-				raise(SIGTERM);
+		sigprocmask(SIG_UNBLOCK, &block, NULL);
+		len = read(lircd, buffer + end_len, PACKET_SIZE - end_len);
+		sigprocmask(SIG_BLOCK, &block, NULL);
+		if (len <= 0) {
+			if (len == -1 && errno == EINTR)
+				continue;
+			raise(SIGTERM);
+		}
+		end_len += len;
+		buffer[end_len] = 0;
+
+		/* handle everything we got in one go */
+		line = buffer;
+		while ((end = strchr(line, '\n')) != NULL) {
+			*end = 0;
+			if (parse_line(line, &rep, &button, &remote)) {
+				mouse_conv(rep, button, remote);
 			}
+			line = end + 1;
 		}
-		buffer[len + end_len] = 0;
-		ret = sscanf(buffer, "%*llx %x %s %s\n", &rep, button, remote);
-		end = strchr(buffer, '\n');
-		if (end == NULL) {
+		flush_uinput();
+
+		end_len -= line - buffer;
+		if (end_len == PACKET_SIZE) {
+			syslog(LOG_WARNING, "line too long, ignored");
 			end_len = 0;
-			continue;
-		}
-		end++;
-		end_len = strlen(end);
-		memmove(buffer, end, end_len + 1);
-		if (ret == 3) {
-			mouse_conv(rep, button, remote);
 		}
+		memmove(buffer, line, end_len + 1);
 	}
 
 }
@@ -889,6 +1051,7 @@ int main(int argc, char **argv)
 		fprintf(stderr, "%s: reading of config file failed\n", progname);
 		exit(EXIT_FAILURE);
 	} else {
+		tm_index = new_tm_index;
 		ms = new_ms;
 	}
 
@@ -19,12 +19,22 @@
 #include "hardware.h"
 #include "lircd.h"
 #include "receive.h"
+#include "capture.h"
 
 extern struct hardware hw;
 extern struct ir_remote *last_remote;
 
 struct rbuf rec_buffer;
 
+static lirc_t default_data[RBUF_SIZE];
+static int default_fit[RBUF_SIZE];
+static lirc_t read_ahead = 0;	/* sample read by the noise filter */
+static lirc_t pending_space = 0;	/* space with noise that has not ended */
+
+/* position in the ring of the sample pos after start */
+#define RBUF_DATA(pos) rec_buffer.data[(rec_buffer.start + (pos)) & rec_buffer.mask]
+#define RBUF_FIT(pos) rec_buffer.fit[(rec_buffer.start + (pos)) & rec_buffer.mask]
+
 inline lirc_t lirc_t_max(lirc_t a, lirc_t b)
 {
 	return (a > b ? a : b);
@@ -42,15 +52,173 @@ inline void set_pending_space(lirc_t deltas)
 	rec_buffer.pendings = deltas;
 }
 
+/* remember how well the sample at pos matched */
+static inline void record_fit_at(int pos, lirc_t delta, lirc_t exdelta)
+{
+	if (decode_best_fit && exdelta > 0 && pos >= 0) {
+		lirc_t error = delta > exdelta ? delta - exdelta : exdelta - delta;
+
+		RBUF_FIT(pos) = error * 1000 / exdelta;
+	}
+}
+
+/* remember how well the sample just read matched */
+static inline void record_fit(lirc_t delta, lirc_t exdelta)
+{
+	record_fit_at(rec_buffer.rptr - 1, delta, exdelta);
+}
+
+/* mean timing error of the samples used by the last decode */
+static int get_fit(void)
+{
+	int i, sum = 0, count = 0;
+
+	for (i = 0; i < rec_buffer.rptr; i++) {
+		if (RBUF_FIT(i) >= 0) {
+			sum += RBUF_FIT(i);
+			count++;
+		}
+	}
+	return count ? sum / count : -1;
+}
+
+static lirc_t read_sample(lirc_t timeout)
+{
+	lirc_t data;
+
+	data = hw.readdata(timeout);
+	if (data)
+		capture_sample(data);
+	return data;
+}
+
+static lirc_t add_length(lirc_t data, lirc_t delta)
+{
+	lirc_t sum = (data & PULSE_MASK) + (delta & PULSE_MASK);
+
+	return sum > PULSE_MASK ? PULSE_MASK : sum;
+}
+
+static int filter_enabled(void)
+{
+	return receive_min_pulse || receive_min_space || receive_max_pulse;
+}
+
+/*
+  Noise (e.g. from sunlight or plasma TVs) shows up as pulses shorter
+  or longer than any remote sends. They are merged with the spaces
+  around them, so that the decoders don't try every remote on them.
+  A space is only passed on once the following pulse is known, which
+  is there right after the space.
+*/
+static lirc_t filter_space(lirc_t space, lirc_t timeout)
+{
+	lirc_t pulse, next;
+
+	while (1) {
+		pulse = read_sample(timeout);
+		if (pulse == 0)
+			return space;
+		if (!is_pulse(pulse) || LIRC_IS_TIMEOUT(pulse)) {
+			read_ahead = pulse;
+			return space;
+		}
+		if ((pulse & PULSE_MASK) < receive_min_pulse) {
+			receive_filtered++;
+		} else if (receive_max_pulse && (pulse & PULSE_MASK) > receive_max_pulse) {
+			receive_bursts++;
+		} else {
+			read_ahead = pulse;
+			return space;
+		}
+		if (receive_max_gap && (space & PULSE_MASK) >= receive_max_gap) {
+			receive_avoided++;
+		}
+		space = add_length(space, pulse);
+
+		/* the rest of the space only arrives with the next
+		   signal, don't wait for it here */
+		next = read_sample(timeout ? timeout : 1);
+		if (next == 0) {
+			pending_space = space;
+			return 0;
+		}
+		if (is_pulse(next) || LIRC_IS_TIMEOUT(next)) {
+			read_ahead = next;
+			return space;
+		}
+		space = add_length(space, next);
+	}
+}
+
+/*
+  Likewise spaces shorter than any remote sends are merged with the
+  pulses around them. Such a space ends within receive_min_space after
+  the pulse, that is how long a pulse is held back.
+*/
+static lirc_t filter_pulse(lirc_t pulse, lirc_t timeout)
+{
+	lirc_t space, next;
+
+	while (receive_min_space) {
+		space = read_sample(receive_min_space);
+		if (space == 0)
+			break;
+		if (is_pulse(space) || LIRC_IS_TIMEOUT(space) || (space & PULSE_MASK) >= receive_min_space) {
+			read_ahead = space;
+			break;
+		}
+		receive_filtered++;
+		pulse = add_length(pulse, space) | PULSE_BIT;
+		next = read_sample(timeout);
+		if (next == 0)
+			break;
+		if (!is_pulse(next)) {
+			read_ahead = next;
+			break;
+		}
+		pulse = add_length(pulse, next) | PULSE_BIT;
+	}
+	return pulse;
+}
+
+static lirc_t readdata(lirc_t timeout)
+{
+	lirc_t data;
+
+	if (read_ahead) {
+		data = read_ahead;
+		read_ahead = 0;
+	} else if (pending_space) {
+		/* the space noise was found in is still going on */
+		data = read_sample(timeout);
+		if (data == 0)
+			return 0;
+		if (is_pulse(data) || LIRC_IS_TIMEOUT(data)) {
+			read_ahead = data;
+			data = pending_space;
+			pending_space = 0;
+			return data;
+		}
+		data = add_length(pending_space, data);
+		pending_space = 0;
+	} else {
+		data = read_sample(timeout);
+	}
+	if (data == 0 || LIRC_IS_TIMEOUT(data) || !filter_enabled())
+		return data;
+	return is_pulse(data) ? filter_pulse(data, timeout) : filter_space(data, timeout);
+}
+
 static lirc_t get_next_rec_buffer_internal(lirc_t maxusec)
 {
 	if (rec_buffer.rptr < rec_buffer.wptr) {
-		LOGPRINTF(3, "<%c%lu", rec_buffer.data[rec_buffer.rptr] & PULSE_BIT ? 'p' : 's', (__u32)
-			  rec_buffer.data[rec_buffer.rptr] & (PULSE_MASK));
-		rec_buffer.sum += rec_buffer.data[rec_buffer.rptr] & (PULSE_MASK);
-		return (rec_buffer.data[rec_buffer.rptr++]);
+		LOGPRINTF(3, "<%c%lu", RBUF_DATA(rec_buffer.rptr) & PULSE_BIT ? 'p' : 's', (__u32)
+			  RBUF_DATA(rec_buffer.rptr) & (PULSE_MASK));
+		rec_buffer.sum += RBUF_DATA(rec_buffer.rptr) & (PULSE_MASK);
+		return (RBUF_DATA(rec_buffer.rptr++));
 	} else {
-		if (rec_buffer.wptr < RBUF_SIZE) {
+		if (rec_buffer.wptr < rec_buffer.size) {
 			lirc_t data = 0;
 			unsigned long elapsed = 0;
 
@@ -60,11 +228,22 @@ static lirc_t get_next_rec_buffer_internal(lirc_t maxusec)
 				gettimeofday(&current, NULL);
 				elapsed = time_elapsed(&rec_buffer.last_signal_time, &current);
 			}
+			/* when all remotes are tried each of them would
+			   wait for the end of the signal again */
+			if (decode_best_fit && rec_buffer.timeout_wptr == rec_buffer.wptr
+			    && maxusec <= rec_buffer.timeout) {
+				LOGPRINTF(3, "timeout: %u", maxusec);
+				return 0;
+			}
 			if (elapsed < maxusec) {
-				data = hw.readdata(maxusec - elapsed);
+				data = readdata(maxusec - elapsed);
 			}
 			if (!data) {
 				LOGPRINTF(3, "timeout: %u", maxusec);
+				if (elapsed < maxusec) {
+					rec_buffer.timeout_wptr = rec_buffer.wptr;
+					rec_buffer.timeout = maxusec;
+				}
 				return 0;
 			}
 			if (LIRC_IS_TIMEOUT(data)) {
@@ -75,17 +254,14 @@ static lirc_t get_next_rec_buffer_internal(lirc_t maxusec)
 				return 0;
 			}
 
-			rec_buffer.data[rec_buffer.wptr] = data;
-			if (rec_buffer.data[rec_buffer.wptr] == 0)
-				return (0);
-			rec_buffer.sum += rec_buffer.data[rec_buffer.rptr]
-			    & (PULSE_MASK);
+			RBUF_DATA(rec_buffer.wptr) = data;
+			RBUF_FIT(rec_buffer.wptr) = -1;
+			rec_buffer.timeout_wptr = -1;
+			rec_buffer.sum += data & (PULSE_MASK);
 			rec_buffer.wptr++;
 			rec_buffer.rptr++;
-			LOGPRINTF(3, "+%c%lu", rec_buffer.data[rec_buffer.rptr - 1] & PULSE_BIT ? 'p' : 's', (__u32)
-				  rec_buffer.data[rec_buffer.rptr - 1]
-				  & (PULSE_MASK));
-			return (rec_buffer.data[rec_buffer.rptr - 1]);
+			LOGPRINTF(3, "+%c%lu", data & PULSE_BIT ? 'p' : 's', (__u32) data & (PULSE_MASK));
+			return (data);
 		} else {
 			rec_buffer.too_long = 1;
 			return (0);
@@ -101,7 +277,40 @@ lirc_t get_next_rec_buffer(lirc_t maxusec)
 
 void init_rec_buffer(void)
 {
+	lirc_t *data = rec_buffer.data;
+	int *fit = rec_buffer.fit;
+	int size = rec_buffer.size;
+
+	if (data == NULL || size != receive_buffer_size) {
+		if (data != default_data) {
+			free(data);
+			free(fit);
+		}
+		data = default_data;
+		fit = default_fit;
+		size = RBUF_SIZE;
+		if (receive_buffer_size != RBUF_SIZE) {
+			data = malloc(receive_buffer_size * sizeof(*data));
+			fit = malloc(receive_buffer_size * sizeof(*fit));
+			size = receive_buffer_size;
+			if (data == NULL || fit == NULL) {
+				logprintf(LOG_ERR, "out of memory, using a receive buffer of %d samples", RBUF_SIZE);
+				free(data);
+				free(fit);
+				data = default_data;
+				fit = default_fit;
+				size = RBUF_SIZE;
+			}
+		}
+	}
 	memset(&rec_buffer, 0, sizeof(rec_buffer));
+	rec_buffer.data = data;
+	rec_buffer.fit = fit;
+	rec_buffer.size = size;
+	rec_buffer.mask = size - 1;
+	rec_buffer.timeout_wptr = -1;
+	read_ahead = 0;
+	pending_space = 0;
 }
 
 void rewind_rec_buffer(void)
@@ -111,6 +320,12 @@ void rewind_rec_buffer(void)
 	set_pending_pulse(0);
 	set_pending_space(0);
 	rec_buffer.sum = 0;
+	if (decode_best_fit) {
+		int i;
+
+		for (i = 0; i < rec_buffer.wptr; i++)
+			RBUF_FIT(i) = -1;
+	}
 }
 
 int clear_rec_buffer(void)
@@ -118,6 +333,7 @@ int clear_rec_buffer(void)
 	int move, i;
 
 	timerclear(&rec_buffer.last_signal_time);
+	rec_buffer.timeout_wptr = -1;
 	if (hw.rec_mode == LIRC_MODE_LIRCCODE) {
 		unsigned char buffer[sizeof(ir_code)];
 		size_t count;
@@ -138,16 +354,20 @@ int clear_rec_buffer(void)
 
 		move = rec_buffer.wptr - rec_buffer.rptr;
 		if (move > 0 && rec_buffer.rptr > 0) {
-			memmove(&rec_buffer.data[0], &rec_buffer.data[rec_buffer.rptr],
-				sizeof(rec_buffer.data[0]) * move);
+			rec_buffer.start += rec_buffer.rptr;
 			rec_buffer.wptr -= rec_buffer.rptr;
 		} else {
+			if (move > 0) {
+				/* nothing could be decoded from it */
+				receive_dropped += move;
+			}
+			rec_buffer.start += rec_buffer.wptr;
 			rec_buffer.wptr = 0;
-			data = hw.readdata(0);
+			data = readdata(0);
 
 			LOGPRINTF(3, "c%lu", (__u32) data & (PULSE_MASK));
 
-			rec_buffer.data[rec_buffer.wptr] = data;
+			RBUF_DATA(rec_buffer.wptr) = data;
 			rec_buffer.wptr++;
 		}
 	}
@@ -163,9 +383,9 @@ inline void unget_rec_buffer(int count)
 	LOGPRINTF(5, "unget: %d", count);
 	if (count == 1 || count == 2) {
 		rec_buffer.rptr -= count;
-		rec_buffer.sum -= rec_buffer.data[rec_buffer.rptr] & (PULSE_MASK);
+		rec_buffer.sum -= RBUF_DATA(rec_buffer.rptr) & (PULSE_MASK);
 		if (count == 2) {
-			rec_buffer.sum -= rec_buffer.data[rec_buffer.rptr + 1]
+			rec_buffer.sum -= RBUF_DATA(rec_buffer.rptr + 1)
 			    & (PULSE_MASK);
 		}
 	}
@@ -175,7 +395,7 @@ inline void unget_rec_buffer_delta(lirc_t delta)
 {
 	rec_buffer.rptr--;
 	rec_buffer.sum -= delta & (PULSE_MASK);
-	rec_buffer.data[rec_buffer.rptr] = delta;
+	RBUF_DATA(rec_buffer.rptr) = delta;
 }
 
 inline lirc_t get_next_pulse(lirc_t maxusec)
@@ -216,6 +436,7 @@ inline int sync_pending_pulse(struct ir_remote *remote)
 			return 0;
 		if (!expect(remote, deltap, rec_buffer.pendingp))
 			return 0;
+		record_fit(deltap, rec_buffer.pendingp);
 		set_pending_pulse(0);
 	}
 	return 1;
@@ -231,6 +452,7 @@ inline int sync_pending_space(struct ir_remote *remote)
 			return 0;
 		if (!expect(remote, deltas, rec_buffer.pendings))
 			return 0;
+		record_fit(deltas, rec_buffer.pendings);
 		set_pending_space(0);
 	}
 	return 1;
@@ -254,9 +476,12 @@ int expectpulse(struct ir_remote *remote, int exdelta)
 		retval = expect(remote, deltap - rec_buffer.pendingp, exdelta);
 		if (!retval)
 			return (0);
+		record_fit(deltap - rec_buffer.pendingp, exdelta);
 		set_pending_pulse(0);
 	} else {
 		retval = expect(remote, deltap, exdelta);
+		if (retval)
+			record_fit(deltap, exdelta);
 	}
 	return (retval);
 }
@@ -279,13 +504,86 @@ int expectspace(struct ir_remote *remote, int exdelta)
 		retval = expect(remote, deltas - rec_buffer.pendings, exdelta);
 		if (!retval)
 			return (0);
+		record_fit(deltas - rec_buffer.pendings, exdelta);
 		set_pending_space(0);
 	} else {
 		retval = expect(remote, deltas, exdelta);
+		if (retval)
+			record_fit(deltas, exdelta);
 	}
 	return (retval);
 }
 
+/* the classes of struct ir_symbols a length belongs to */
+static inline __u32 classify(struct ir_symbols *sym, lirc_t delta)
+{
+	int low = 0, high = sym->bounds, mid;
+
+	while (low < high) {
+		mid = (low + high) / 2;
+		if (sym->bound[mid] <= delta)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return sym->classes[low];
+}
+
+static inline int in_class(struct ir_symbols *sym, lirc_t delta, int class)
+{
+	return delta >= sym->min[class] && delta <= sym->max[class];
+}
+
+/* expectpulse() for a length of the symbol table */
+static int expect_pulse_class(struct ir_remote *remote, int class)
+{
+	struct ir_symbols *sym = &remote->symbols;
+	lirc_t deltap;
+
+	if (!sync_pending_space(remote))
+		return 0;
+	deltap = get_next_pulse(rec_buffer.pendingp + sym->length[class]);
+	if (deltap == 0)
+		return 0;
+	if (rec_buffer.pendingp > 0) {
+		if (rec_buffer.pendingp > deltap)
+			return 0;
+		deltap -= rec_buffer.pendingp;
+		if (!in_class(sym, deltap, class))
+			return 0;
+		set_pending_pulse(0);
+	} else if (!in_class(sym, deltap, class)) {
+		return 0;
+	}
+	record_fit(deltap, sym->length[class]);
+	return 1;
+}
+
+/* expectspace() for a length of the symbol table */
+static int expect_space_class(struct ir_remote *remote, int class)
+{
+	struct ir_symbols *sym = &remote->symbols;
+	lirc_t deltas;
+
+	if (!sync_pending_pulse(remote))
+		return 0;
+	deltas = get_next_space(rec_buffer.pendings + sym->length[class]);
+	if (deltas == 0)
+		return 0;
+	if (rec_buffer.pendings > 0) {
+		if (rec_buffer.pendings > deltas)
+			return 0;
+		deltas -= rec_buffer.pendings;
+		if (!in_class(sym, deltas, class))
+			return 0;
+		set_pending_space(0);
+	} else if (!in_class(sym, deltas, class)) {
+		return 0;
+	}
+	record_fit(deltas, sym->length[class]);
+	return 1;
+}
+
 inline int expectone(struct ir_remote *remote, int bit)
 {
 	if (is_biphase(remote)) {
@@ -449,7 +747,7 @@ inline int get_header(struct ir_remote *remote)
 		set_pending_pulse(remote->phead);
 		return 1;
 	}
-	if (!expectpulse(remote, remote->phead)) {
+	if (!(remote->bit_decoder ? expect_pulse_class(remote, SYM_PHEAD) : expectpulse(remote, remote->phead))) {
 		unget_rec_buffer(1);
 		return (0);
 	}
@@ -528,13 +826,18 @@ inline int get_repeat(struct ir_remote *remote)
 {
 	if (!get_lead(remote))
 		return (0);
-	if (is_biphase(remote)) {
+	if (remote->bit_decoder == BIT_DECODER_BIPHASE) {
+		if (!expect_space_class(remote, SYM_SREPEAT))
+			return (0);
+		if (!expect_pulse_class(remote, SYM_PREPEAT))
+			return (0);
+	} else if (is_biphase(remote)) {
 		if (!expectspace(remote, remote->srepeat))
 			return (0);
 		if (!expectpulse(remote, remote->prepeat))
 			return (0);
 	} else {
-		if (!expectpulse(remote, remote->prepeat))
+		if (!(remote->bit_decoder ? expect_pulse_class(remote, SYM_PREPEAT) : expectpulse(remote, remote->prepeat)))
 			return (0);
 		set_pending_space(remote->srepeat);
 	}
@@ -550,6 +853,222 @@ inline int get_repeat(struct ir_remote *remote)
 	return (1);
 }
 
+/*
+  Decoders for the data bits of the common protocols. They do the
+  same as expectone() and expectzero() but look at the protocol once
+  per call instead of for every bit and classify the samples with the
+  remote's symbol table.
+*/
+
+/* a pulse and a space, the space may be left pending */
+static int expect_bit_space_enc(struct ir_remote *remote, int pulse, int space, int trail)
+{
+	if (!expect_pulse_class(remote, pulse)) {
+		unget_rec_buffer(1);
+		return 0;
+	}
+	if (!trail) {
+		set_pending_space(remote->symbols.length[space]);
+	} else if (!expect_space_class(remote, space)) {
+		unget_rec_buffer(2);
+		return 0;
+	}
+	return 1;
+}
+
+/*
+  Without a pending pulse the samples of a bit are read only once and
+  compared with both bit lengths, in the order expectone() and
+  expectzero() would. Returns the bit or -1.
+*/
+static int read_bit_space_enc(struct ir_remote *remote, int trail)
+{
+	struct ir_symbols *sym = &remote->symbols;
+	lirc_t deltap, deltas;
+	__u32 pulse, space;
+
+	if (!sync_pending_space(remote))
+		return -1;
+	deltap = get_next_pulse(lirc_t_max(sym->length[SYM_PONE], sym->length[SYM_PZERO]));
+	if (deltap == 0)
+		return -1;
+	pulse = classify(sym, deltap);
+	if (!trail) {
+		if (pulse & (1 << SYM_PONE)) {
+			record_fit(deltap, sym->length[SYM_PONE]);
+			set_pending_space(sym->length[SYM_SONE]);
+			return 1;
+		} else if (pulse & (1 << SYM_PZERO)) {
+			record_fit(deltap, sym->length[SYM_PZERO]);
+			set_pending_space(sym->length[SYM_SZERO]);
+			return 0;
+		}
+		return -1;
+	}
+	if (!(pulse & (1 << SYM_PONE | 1 << SYM_PZERO)))
+		return -1;
+	deltas = get_next_space(lirc_t_max(sym->length[SYM_SONE], sym->length[SYM_SZERO]));
+	if (deltas == 0)
+		return -1;
+	space = classify(sym, deltas);
+	if ((pulse & (1 << SYM_PONE)) && (space & (1 << SYM_SONE))) {
+		record_fit_at(rec_buffer.rptr - 2, deltap, sym->length[SYM_PONE]);
+		record_fit(deltas, sym->length[SYM_SONE]);
+		return 1;
+	} else if ((pulse & (1 << SYM_PZERO)) && (space & (1 << SYM_SZERO))) {
+		record_fit_at(rec_buffer.rptr - 2, deltap, sym->length[SYM_PZERO]);
+		record_fit(deltas, sym->length[SYM_SZERO]);
+		return 0;
+	}
+	return -1;
+}
+
+/*
+  When another remote has been tried before, all samples of the bits
+  usually are in the buffer already. They are classified in one pass
+  then, without reading them one by one. Pulses and spaces alternate
+  and, without a trailing pulse, the space of the last bit is left
+  pending.
+*/
+static ir_code get_buffered_space_enc(struct ir_remote *remote, int bits, int trail)
+{
+	struct ir_symbols *sym = &remote->symbols;
+	int i, pos = rec_buffer.rptr, bit = 0;
+	lirc_t data, sum = 0;
+	__u32 pulse, space = 0;
+	ir_code code = 0;
+
+	for (i = 0; i < bits; i++) {
+		data = RBUF_DATA(pos++);
+		if (!is_pulse(data))
+			return ((ir_code) - 1);
+		pulse = classify(sym, data & PULSE_MASK);
+		sum += data & PULSE_MASK;
+		if (!trail) {
+			if (pulse & (1 << SYM_PONE))
+				bit = 1;
+			else if (pulse & (1 << SYM_PZERO))
+				bit = 0;
+			else
+				return ((ir_code) - 1);
+			record_fit_at(pos - 1, data & PULSE_MASK, sym->length[bit ? SYM_PONE : SYM_PZERO]);
+			if (i == bits - 1)
+				break;
+		}
+		data = RBUF_DATA(pos++);
+		if (data == 0 || !is_space(data))
+			return ((ir_code) - 1);
+		space = classify(sym, data);
+		sum += data;
+		if (trail) {
+			if ((pulse & (1 << SYM_PONE)) && (space & (1 << SYM_SONE)))
+				bit = 1;
+			else if ((pulse & (1 << SYM_PZERO)) && (space & (1 << SYM_SZERO)))
+				bit = 0;
+			else
+				return ((ir_code) - 1);
+			record_fit_at(pos - 2, RBUF_DATA(pos - 2) & PULSE_MASK, sym->length[bit ? SYM_PONE : SYM_PZERO]);
+		} else if (!(space & (1 << (bit ? SYM_SONE : SYM_SZERO)))) {
+			return ((ir_code) - 1);
+		}
+		record_fit_at(pos - 1, data, sym->length[bit ? SYM_SONE : SYM_SZERO]);
+		code = code << 1 | bit;
+	}
+	if (!trail) {
+		code = code << 1 | bit;
+		set_pending_space(sym->length[bit ? SYM_SONE : SYM_SZERO]);
+	}
+	rec_buffer.rptr = pos;
+	rec_buffer.sum += sum;
+	return (code);
+}
+
+static ir_code get_data_space_enc(struct ir_remote *remote, int bits, int done)
+{
+	int trail = remote->ptrail > 0;
+	ir_code code = 0;
+	int i, bit, rptr;
+	lirc_t sum, pendings;
+
+	if (bits > 0 && rec_buffer.pendingp == 0) {
+		rptr = rec_buffer.rptr;
+		sum = rec_buffer.sum;
+		pendings = rec_buffer.pendings;
+		if (sync_pending_space(remote) && rec_buffer.wptr - rec_buffer.rptr >= 2 * bits - (trail ? 0 : 1)) {
+			code = get_buffered_space_enc(remote, bits, trail);
+			if (code != (ir_code) - 1)
+				return (code);
+			LOGPRINTF(1, "failed on buffered bits %d-%d", done + 1, done + bits);
+			code = 0;
+		}
+		/* the failing bit is looked for below */
+		rec_buffer.rptr = rptr;
+		rec_buffer.sum = sum;
+		set_pending_space(pendings);
+	}
+
+	for (i = 0; i < bits; i++) {
+		code = code << 1;
+		if (rec_buffer.pendingp == 0) {
+			rptr = rec_buffer.rptr;
+			sum = rec_buffer.sum;
+			pendings = rec_buffer.pendings;
+			bit = read_bit_space_enc(remote, trail);
+			if (bit < 0) {
+				/* leave the buffer where expectone() and
+				   expectzero() would leave it */
+				rec_buffer.rptr = rptr;
+				rec_buffer.sum = sum;
+				set_pending_space(pendings);
+				bit = expectone(remote, done + i) ? 1 : (expectzero(remote, done + i) ? 0 : -1);
+			}
+		} else if (expect_bit_space_enc(remote, SYM_PONE, SYM_SONE, trail)) {
+			bit = 1;
+		} else if (expect_bit_space_enc(remote, SYM_PZERO, SYM_SZERO, trail)) {
+			bit = 0;
+		} else {
+			bit = -1;
+		}
+		if (bit < 0) {
+			LOGPRINTF(1, "failed on bit %d", done + i + 1);
+			return ((ir_code) - 1);
+		}
+		LOGPRINTF(2, "%d", bit);
+		code |= bit;
+	}
+	return (code);
+}
+
+/* RC-6 doubles the length of the bits in rc6_mask */
+static ir_code get_data_biphase(struct ir_remote *remote, int bits, int done)
+{
+	int all_bits = bit_count(remote);
+	ir_code code = 0, mask;
+	int i, dbl;
+
+	mask = ((ir_code) 1) << (all_bits - 1 - done);
+	for (i = 0; i < bits; i++, mask >>= 1) {
+		code = code << 1;
+		dbl = (mask & remote->rc6_mask) ? 1 : 0;
+		if (expect_space_class(remote, dbl ? SYM_SONE2 : SYM_SONE)) {
+			LOGPRINTF(2, "1");
+			code |= 1;
+			set_pending_pulse(remote->pone << dbl);
+			continue;
+		}
+		unget_rec_buffer(1);
+		if (expect_pulse_class(remote, dbl ? SYM_PZERO2 : SYM_PZERO)) {
+			LOGPRINTF(2, "0");
+			set_pending_space(remote->szero << dbl);
+			continue;
+		}
+		unget_rec_buffer(1);
+		LOGPRINTF(1, "failed on bit %d", done + i + 1);
+		return ((ir_code) - 1);
+	}
+	return (code);
+}
+
 ir_code get_data(struct ir_remote * remote, int bits, int done)
 {
 	ir_code code;
@@ -860,6 +1379,12 @@ ir_code get_data(struct ir_remote * remote, int bits, int done)
 		return code;
 	}
 
+	if (remote->bit_decoder == BIT_DECODER_SPACE_ENC) {
+		return get_data_space_enc(remote, bits, done);
+	} else if (remote->bit_decoder == BIT_DECODER_BIPHASE) {
+		return get_data_biphase(remote, bits, done);
+	}
+
 	for (i = 0; i < bits; i++) {
 		code = code << 1;
 		if (is_goldstar(remote)) {
@@ -940,6 +1465,8 @@ int receive_decode(struct ir_remote *remote, ir_code * prep, ir_code * codep, ir
 	if (hw.rec_mode == LIRC_MODE_MODE2 || hw.rec_mode == LIRC_MODE_PULSE || hw.rec_mode == LIRC_MODE_RAW) {
 		rewind_rec_buffer();
 		rec_buffer.is_biphase = is_biphase(remote) ? 1 : 0;
+		if (remote->bit_decoder != BIT_DECODER_GENERIC && !symbols_valid(remote))
+			init_symbols(remote);
 
 		/* we should get a long space first */
 		if (!(sync = sync_rec_buffer(remote))) {
@@ -949,6 +1476,11 @@ int receive_decode(struct ir_remote *remote, ir_code * prep, ir_code * codep, ir
 
 		LOGPRINTF(1, "sync");
 
+		/* rcmm remotes sync differently */
+		if (decode_lead == 0 && !is_rcmm(remote) && rec_buffer.rptr < rec_buffer.wptr
+		    && is_pulse(RBUF_DATA(rec_buffer.rptr)))
+			decode_lead = RBUF_DATA(rec_buffer.rptr) & PULSE_MASK;
+
 		if (has_repeat(remote) && last_remote == remote) {
 			if (remote->flags & REPEAT_HEADER && has_header(remote)) {
 				if (!get_header(remote)) {
@@ -978,6 +1510,8 @@ int receive_decode(struct ir_remote *remote, ir_code * prep, ir_code * codep, ir
 							rec_buffer.sum ? max_gap(remote) -
 							rec_buffer.sum : 0) : (has_repeat_gap(remote) ? remote->
 									       repeat_gap : max_gap(remote));
+				if (decode_best_fit)
+					decode_fit = get_fit();
 				return (1);
 			} else {
 				LOGPRINTF(1, "no repeat");
@@ -1138,5 +1672,7 @@ int receive_decode(struct ir_remote *remote, ir_code * prep, ir_code * codep, ir
 		*min_remaining_gapp = min_gap(remote);
 		*max_remaining_gapp = max_gap(remote);
 	}
+	if (decode_best_fit && hw.rec_mode != LIRC_MODE_LIRCCODE)
+		decode_fit = get_fit();
 	return (1);
 }
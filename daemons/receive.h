@@ -15,14 +15,24 @@
 
 #include "ir_remote.h"
 
-#define RBUF_SIZE (512)
+#define RBUF_SIZE (512)		/* default, see receive_buffer_size */
+#define RBUF_MIN_SIZE (256)		/* room for a frame of long remotes */
+#define RBUF_MAX_SIZE (65536)
 
 #define REC_SYNC 8
 
 #define MIN_RECEIVE_TIMEOUT 100000
 
+/*
+  The samples are kept in a ring of a power of two size. rptr and
+  wptr count from start, the first sample of the signal being
+  decoded, so consuming a signal only moves start.
+*/
 struct rbuf {
-	lirc_t data[RBUF_SIZE];
+	lirc_t *data;
+	int size;
+	unsigned int mask;
+	unsigned int start;
 	ir_code decoded;
 	int rptr;
 	int wptr;
@@ -32,6 +42,13 @@ struct rbuf {
 	lirc_t pendings;
 	lirc_t sum;
 	struct timeval last_signal_time;
+
+	/* best fit decoding only */
+	int *fit;		/* timing error of each sample in
+				   permille, -1 if not matched */
+	int timeout_wptr;	/* readdata() timed out at this
+				   position ... */
+	lirc_t timeout;		/* ... after waiting this long */
 };
 
 static inline lirc_t receive_timeout(lirc_t usec)
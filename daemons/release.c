@@ -68,10 +68,10 @@ void register_button_press(struct ir_remote *remote, struct ir_ncode *ncode, ir_
 	register_input();
 }
 
-void get_release_data(const char **remote_name, const char **button_name, int *reps)
+void get_release_data(struct ir_remote **remote, struct ir_ncode **ncode, int *reps)
 {
-	*remote_name = release_remote->name;
-	*button_name = release_ncode->name;
+	*remote = release_remote;
+	*ncode = release_ncode;
 	*reps = release_reps;
 }
 
@@ -85,13 +85,13 @@ void get_release_time(struct timeval *tv)
 	*tv = release_time;
 }
 
-const char *check_release_event(const char **remote_name, const char **button_name)
+const char *check_release_event(struct ir_remote **remote, struct ir_ncode **ncode)
 {
 	int len = 0;
 
 	if (release_remote2 != NULL) {
-		*remote_name = release_remote2->name;
-		*button_name = release_ncode2->name;
+		*remote = release_remote2;
+		*ncode = release_ncode2;
 		len =
 		    write_message(message, PACKET_SIZE + 1, release_remote2->name, release_ncode2->name, release_suffix,
 				  release_code2, 0);
@@ -110,14 +110,14 @@ const char *check_release_event(const char **remote_name, const char **button_na
 	return NULL;
 }
 
-const char *trigger_release_event(const char **remote_name, const char **button_name)
+const char *trigger_release_event(struct ir_remote **remote, struct ir_ncode **ncode)
 {
 	int len = 0;
 
 	if (release_remote != NULL) {
 		release_remote->release_detected = 1;
-		*remote_name = release_remote->name;
-		*button_name = release_ncode->name;
+		*remote = release_remote;
+		*ncode = release_ncode;
 		len =
 		    write_message(message, PACKET_SIZE + 1, release_remote->name, release_ncode->name, release_suffix,
 				  release_code, 0);
@@ -136,25 +136,16 @@ const char *trigger_release_event(const char **remote_name, const char **button_
 	return NULL;
 }
 
-const char *release_map_remotes(struct ir_remote *old, struct ir_remote *new, const char **remote_name,
-				const char **button_name)
+/* a button of a config that is about to be freed is released now */
+const char *release_old_remotes(struct ir_remote *old, struct ir_remote **remote, struct ir_ncode **ncode)
 {
-	struct ir_remote *remote;
-	struct ir_ncode *ncode;
-
 	if (release_remote2 != NULL) {
 		/* should not happen */
 		logprintf(LOG_ERR, "release_remote2 still in use");
 		release_remote2 = NULL;
 	}
 	if (release_remote && is_in_remotes(old, release_remote)) {
-		if ((remote = get_ir_remote(new, release_remote->name))
-		    && (ncode = get_code_by_name(remote, release_ncode->name))) {
-			release_remote = remote;
-			release_ncode = ncode;
-		} else {
-			return trigger_release_event(remote_name, button_name);
-		}
+		return trigger_release_event(remote, ncode);
 	}
 	return NULL;
 }
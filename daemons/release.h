@@ -17,12 +17,11 @@
 
 void register_input(void);
 void register_button_press(struct ir_remote *remote, struct ir_ncode *ncode, ir_code code, int reps);
-void get_release_data(const char **remote_name, const char **button_name, int *reps);
+void get_release_data(struct ir_remote **remote, struct ir_ncode **ncode, int *reps);
 void set_release_suffix(const char *s);
 void get_release_time(struct timeval *tv);
-const char *check_release_event(const char **remote_name, const char **button_name);
-const char *trigger_release_event(const char **remote_name, const char **button_name);
-const char *release_map_remotes(struct ir_remote *old, struct ir_remote *new, const char **remote_name,
-				const char **button_name);
+const char *check_release_event(struct ir_remote **remote, struct ir_ncode **ncode);
+const char *trigger_release_event(struct ir_remote **remote, struct ir_ncode **ncode);
+const char *release_old_remotes(struct ir_remote *old, struct ir_remote **remote, struct ir_ncode **ncode);
 
 #endif /* RELEASE_H */
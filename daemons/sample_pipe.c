@@ -0,0 +1,108 @@
+/****************************************************************************
+ ** sample_pipe.c ***********************************************************
+ ****************************************************************************
+ *
+ * sample_pipe.c - batched transport of samples from a driver's child
+ *                 process to lircd
+ *
+ * The USB drivers decode the device's reports in a child process.
+ * Instead of one write() per sample the child collects the samples of
+ * a report and hands them over with a single write(), and lircd reads
+ * everything that is in the pipe at once, so a whole signal usually
+ * costs one wakeup on either side.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "hardware.h"
+#include "lircd.h"
+#include "sample_pipe.h"
+
+static unsigned char read_buffer[4 * SAMPLE_BATCH * sizeof(lirc_t)];
+static size_t read_pos = 0;
+static size_t read_len = 0;
+
+void sample_writer_init(struct sample_writer *w, int fd)
+{
+	w->fd = fd;
+	w->count = 0;
+}
+
+int sample_flush(struct sample_writer *w)
+{
+	const char *p = (const char *)w->buffer;
+	size_t left = w->count * sizeof(lirc_t);
+	ssize_t ret;
+
+	w->count = 0;
+	while (left > 0) {
+		ret = write(w->fd, p, left);
+		if (ret == -1) {
+			if (errno == EINTR)
+				continue;
+			return (0);
+		}
+		p += ret;
+		left -= ret;
+	}
+	return (1);
+}
+
+int sample_write(struct sample_writer *w, lirc_t data)
+{
+	w->buffer[w->count++] = data;
+	if (w->count == SAMPLE_BATCH)
+		return sample_flush(w);
+	return (1);
+}
+
+void sample_reader_init(void)
+{
+	read_pos = read_len = 0;
+}
+
+int sample_pending(void)
+{
+	return read_len - read_pos >= sizeof(lirc_t);
+}
+
+/* returns 1 if a sample was read, 0 on timeout and -1 if the child
+   is gone */
+int sample_read(lirc_t * data, lirc_t timeout)
+{
+	ssize_t n;
+
+	if (!sample_pending()) {
+		if (!waitfordata((long)timeout))
+			return (0);
+
+		/* keep a partial sample at the start of the buffer */
+		memmove(read_buffer, read_buffer + read_pos, read_len - read_pos);
+		read_len -= read_pos;
+		read_pos = 0;
+
+		n = read(hw.fd, read_buffer + read_len, sizeof(read_buffer) - read_len);
+		if (n == -1 && (errno == EAGAIN || errno == EINTR))
+			return (0);
+		if (n <= 0) {
+			if (n == -1)
+				logperror(LOG_ERR, "error reading from child process");
+			else
+				logprintf(LOG_ERR, "child process closed the pipe");
+			return (-1);
+		}
+		read_len += n;
+		if (!sample_pending())
+			return (0);
+	}
+	memcpy(data, read_buffer + read_pos, sizeof(lirc_t));
+	read_pos += sizeof(lirc_t);
+	return (1);
+}
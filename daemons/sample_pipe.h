@@ -0,0 +1,35 @@
+/****************************************************************************
+ ** sample_pipe.h ***********************************************************
+ ****************************************************************************
+ *
+ * sample_pipe.h - batched transport of samples from a driver's child
+ *                 process to lircd
+ *
+ */
+
+#ifndef _SAMPLE_PIPE_H
+#define _SAMPLE_PIPE_H
+
+#include "hardware.h"
+
+/* 64 samples stay well below PIPE_BUF, so a batch is written
+   atomically on every system */
+#define SAMPLE_BATCH 64
+
+struct sample_writer {
+	int fd;
+	int count;
+	lirc_t buffer[SAMPLE_BATCH];
+};
+
+/* child side */
+void sample_writer_init(struct sample_writer *w, int fd);
+int sample_write(struct sample_writer *w, lirc_t data);
+int sample_flush(struct sample_writer *w);
+
+/* lircd side, reads from hw.fd */
+void sample_reader_init(void);
+int sample_read(lirc_t * data, lirc_t timeout);
+int sample_pending(void);
+
+#endif
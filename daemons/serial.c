@@ -22,8 +22,10 @@
 #include <errno.h>
 #include <dirent.h>
 #include <signal.h>
+#include <unistd.h>
 
 #include <sys/types.h>
+#include <sys/time.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
 
@@ -520,47 +522,155 @@ int tty_clear(int fd, int rts, int dtr)
 	return (1);
 }
 
+/* waits up to usec for fd to become readable (or writable) */
+static int tty_wait(int fd, int output, long usec)
+{
+	fd_set fds;
+	struct timeval tv;
+	int ret;
+
+	FD_ZERO(&fds);
+	FD_SET(fd, &fds);
+	tv.tv_sec = usec / 1000000;
+	tv.tv_usec = usec % 1000000;
+	do {
+		ret = select(fd + 1, output ? NULL : &fds, output ? &fds : NULL, NULL, &tv);
+	}
+	while (ret == -1 && errno == EINTR);
+	return (ret);
+}
+
+static long tty_time_left(const struct timeval *start, long usec)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	usec -= (now.tv_sec - start->tv_sec) * 1000000 + now.tv_usec - start->tv_usec;
+	return (usec > 0 ? usec : 0);
+}
+
+/* writes all of buf, also on non-blocking descriptors, and waits
+   until the UART has sent it */
+int tty_write_all(int fd, const void *buf, size_t count)
+{
+	const char *p = buf;
+	ssize_t ret;
+
+	while (count > 0) {
+		ret = write(fd, p, count);
+		if (ret == -1 && (errno == EAGAIN || errno == EINTR)) {
+			if (tty_wait(fd, 1, 1000000) <= 0) {
+				LOGPRINTF(1, "tty_write_all(): device does not accept data");
+				return (0);
+			}
+			continue;
+		}
+		if (ret <= 0) {
+			LOGPRINTF(1, "tty_write_all(): write() failed");
+			LOGPERROR(1, "tty_write_all()");
+			return (0);
+		}
+		p += ret;
+		count -= ret;
+	}
+	if (tcdrain(fd) == -1) {
+		LOGPRINTF(1, "tty_write_all(): tcdrain() failed");
+		LOGPERROR(1, "tty_write_all()");
+		return (0);
+	}
+	return (1);
+}
+
+/* reads up to count bytes, taking everything available with each
+   read(), and gives up usec after the call; returns the number of
+   bytes read or -1 on errors */
+ssize_t tty_read_timeout(int fd, void *buf, size_t count, long usec)
+{
+	struct timeval start;
+	char *p = buf;
+	size_t got = 0;
+	ssize_t ret;
+
+	gettimeofday(&start, NULL);
+	while (got < count) {
+		ret = tty_wait(fd, 0, tty_time_left(&start, usec));
+		if (ret == 0)
+			break;	/* timeout */
+		if (ret == -1) {
+			LOGPRINTF(1, "tty_read_timeout(): select() failed");
+			LOGPERROR(1, "tty_read_timeout()");
+			return (-1);
+		}
+		ret = read(fd, p + got, count - got);
+		if (ret == -1 && (errno == EAGAIN || errno == EINTR))
+			continue;
+		if (ret <= 0) {
+			LOGPRINTF(1, "tty_read_timeout(): read() failed");
+			LOGPERROR(1, "tty_read_timeout()");
+			return (-1);
+		}
+		got += ret;
+	}
+	return (got);
+}
+
+/* returns 1 if the next count bytes arrive within usec and match
+   expect; the reply is left in buf if that is not NULL */
+int tty_expect(int fd, const char *expect, size_t count, long usec, char *buf)
+{
+	char reply[64];
+
+	if (buf == NULL) {
+		if (count > sizeof(reply))
+			return (0);
+		buf = reply;
+	}
+	if (tty_read_timeout(fd, buf, count, usec) != count) {
+		LOGPRINTF(1, "tty_expect(): no reply");
+		return (0);
+	}
+	if (memcmp(buf, expect, count) != 0) {
+		LOGPRINTF(1, "tty_expect(): unexpected reply");
+		return (0);
+	}
+	return (1);
+}
+
+/* discards input until the line has been quiet for usec */
+int tty_flush(int fd, long usec)
+{
+	char buf[64];
+	ssize_t ret;
+
+	if (tcflush(fd, TCIFLUSH) == -1) {
+		LOGPRINTF(1, "tty_flush(): tcflush() failed");
+		LOGPERROR(1, "tty_flush()");
+		return (0);
+	}
+	while (usec > 0 && (ret = tty_read_timeout(fd, buf, sizeof(buf), usec)) > 0)
+		LOGPRINTF(2, "tty_flush(): discarded %d bytes", (int)ret);
+	return (1);
+}
+
 int tty_write(int fd, char byte)
 {
-	if (write(fd, &byte, 1) != 1) {
+	if (!tty_write_all(fd, &byte, 1)) {
 		LOGPRINTF(1, "tty_write(): write() failed");
-		LOGPERROR(1, "tty_write()");
 		return (-1);
 	}
-	/* wait until the stop bit of Control Byte is sent
-	   (for 9600 baud rate, it takes about 100 msec */
-	usleep(100 * 1000);
-
-	/* we don't wait because tcdrain() does this for us */
-	/* tcdrain(fd); */
-	/* but unfortunately this does not seem to be
-	   implemented in 2.0.x kernels ... */
 	return (1);
 }
 
 int tty_read(int fd, char *byte)
 {
-	fd_set fds;
-	int ret;
-	struct timeval tv;
+	ssize_t ret;
 
-	FD_ZERO(&fds);
-	FD_SET(fd, &fds);
-
-	tv.tv_sec = 1;		/* timeout after 1 sec */
-	tv.tv_usec = 0;
-	ret = select(fd + 1, &fds, NULL, NULL, &tv);
+	ret = tty_read_timeout(fd, byte, 1, 1000000);
 	if (ret == 0) {
 		logprintf(LOG_ERR, "tty_read(): timeout");
 		return (-1);	/* received nothing, bad */
 	} else if (ret != 1) {
-		LOGPRINTF(1, "tty_read(): select() failed");
-		LOGPERROR(1, "tty_read()");
-		return (-1);
-	}
-	if (read(fd, byte, 1) != 1) {
 		LOGPRINTF(1, "tty_read(): read() failed");
-		LOGPERROR(1, "tty_read()");
 		return (-1);
 	}
 	return (1);
@@ -13,6 +13,8 @@
 #ifndef _SERIAL_H
 #define _SERIAL_H
 
+#include <sys/types.h>
+
 int tty_reset(int fd);
 int tty_setrtscts(int fd, int enable);
 int tty_setdtr(int fd, int enable);
@@ -25,5 +27,9 @@ int tty_clear(int fd, int rts, int dtr);
 int tty_write(int fd, char byte);
 int tty_read(int fd, char *byte);
 int tty_write_echo(int fd, char byte);
+int tty_write_all(int fd, const void *buf, size_t count);
+ssize_t tty_read_timeout(int fd, void *buf, size_t count, long usec);
+int tty_expect(int fd, const char *expect, size_t count, long usec, char *buf);
+int tty_flush(int fd, long usec);
 
 #endif
@@ -0,0 +1,113 @@
+/****************************************************************************
+ ** thread_queue.c **********************************************************
+ ****************************************************************************
+ *
+ * thread_queue.c - single producer, single consumer queue between two
+ *                  of lircd's threads
+ *
+ * Each index is only written by one side, so putting an item into the
+ * queue and taking it out needs no lock.  The mutex and the condition
+ * are only used by a consumer that has to sleep, and a producer only
+ * touches them when it sees one sleeping.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#ifdef HAVE_PTHREAD
+
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/time.h>
+
+#include "thread_queue.h"
+
+int thread_queue_init(struct thread_queue *q, unsigned int slots, size_t item_size)
+{
+	q->items = malloc(slots * item_size);
+	if (q->items == NULL)
+		return (0);
+	q->slots = slots;
+	q->item_size = item_size;
+	q->head = q->tail = 0;
+	q->waiting = 0;
+	q->dropped = 0;
+	pthread_mutex_init(&q->mutex, NULL);
+	pthread_cond_init(&q->cond, NULL);
+	return (1);
+}
+
+void *thread_queue_reserve(struct thread_queue *q)
+{
+	if (q->head - q->tail >= q->slots) {
+		q->dropped++;
+		return (NULL);
+	}
+	return (q->items + (q->head & (q->slots - 1)) * q->item_size);
+}
+
+void thread_queue_commit(struct thread_queue *q)
+{
+	/* the item has to be visible before the new head */
+	__sync_synchronize();
+	q->head++;
+	/* and the new head before looking for a sleeping consumer */
+	__sync_synchronize();
+	if (q->waiting) {
+		pthread_mutex_lock(&q->mutex);
+		pthread_cond_signal(&q->cond);
+		pthread_mutex_unlock(&q->mutex);
+	}
+}
+
+void *thread_queue_peek(struct thread_queue *q)
+{
+	if (q->head == q->tail)
+		return (NULL);
+	__sync_synchronize();
+	return (q->items + (q->tail & (q->slots - 1)) * q->item_size);
+}
+
+void thread_queue_release(struct thread_queue *q)
+{
+	/* done with the item before the producer may reuse it */
+	__sync_synchronize();
+	q->tail++;
+}
+
+/* waits up to maxusec (0: forever) for an item, returns 0 on timeout */
+int thread_queue_wait(struct thread_queue *q, long maxusec)
+{
+	struct timeval now;
+	struct timespec end;
+	int ret = 0;
+
+	if (q->head != q->tail)
+		return (1);
+
+	if (maxusec > 0) {
+		gettimeofday(&now, NULL);
+		end.tv_sec = now.tv_sec + maxusec / 1000000;
+		end.tv_nsec = (now.tv_usec + maxusec % 1000000) * 1000;
+		if (end.tv_nsec >= 1000000000) {
+			end.tv_sec++;
+			end.tv_nsec -= 1000000000;
+		}
+	}
+	pthread_mutex_lock(&q->mutex);
+	q->waiting = 1;
+	__sync_synchronize();
+	while (q->head == q->tail && ret != ETIMEDOUT) {
+		if (maxusec > 0)
+			ret = pthread_cond_timedwait(&q->cond, &q->mutex, &end);
+		else
+			pthread_cond_wait(&q->cond, &q->mutex);
+	}
+	q->waiting = 0;
+	pthread_mutex_unlock(&q->mutex);
+	return (q->head != q->tail);
+}
+
+#endif /* HAVE_PTHREAD */
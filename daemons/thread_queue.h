@@ -0,0 +1,43 @@
+/****************************************************************************
+ ** thread_queue.h **********************************************************
+ ****************************************************************************
+ *
+ * thread_queue.h - single producer, single consumer queue between two
+ *                  of lircd's threads
+ *
+ */
+
+#ifndef _THREAD_QUEUE_H
+#define _THREAD_QUEUE_H
+
+#ifdef HAVE_PTHREAD
+
+#include <stddef.h>
+#include <pthread.h>
+
+struct thread_queue {
+	char *items;
+	unsigned int slots;	/* power of two */
+	size_t item_size;
+	volatile unsigned int head;	/* written by the producer only */
+	volatile unsigned int tail;	/* written by the consumer only */
+	volatile int waiting;
+	unsigned long dropped;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
+
+int thread_queue_init(struct thread_queue *q, unsigned int slots, size_t item_size);
+
+/* producer side */
+void *thread_queue_reserve(struct thread_queue *q);
+void thread_queue_commit(struct thread_queue *q);
+
+/* consumer side */
+void *thread_queue_peek(struct thread_queue *q);
+void thread_queue_release(struct thread_queue *q);
+int thread_queue_wait(struct thread_queue *q, long maxusec);
+
+#endif /* HAVE_PTHREAD */
+
+#endif
@@ -18,12 +18,20 @@
    signals and send the signal chain at a single blow */
 #define LIRCD_EXACT_GAP_THRESHOLD 10000
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
 #include "lircd.h"
 #include "transmit.h"
 
 extern struct ir_remote *repeat_remote;
 struct sbuf send_buffer;
 
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t send_buffer_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 static void send_signals(lirc_t * signals, int n);
 static int init_send_or_sim(struct ir_remote *remote, struct ir_ncode *code, int sim, int repeat_preset);
 
@@ -37,6 +45,22 @@ inline void set_bit(ir_code * code, int bit, int data)
   sending stuff
 */
 
+/* lircd's config reload thread simulates the codes of the new config
+   in send_buffer while the main loop may be transmitting */
+void lock_send_buffer(void)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&send_buffer_mutex);
+#endif
+}
+
+void unlock_send_buffer(void)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&send_buffer_mutex);
+#endif
+}
+
 void init_send_buffer(void)
 {
 	memset(&send_buffer, 0, sizeof(send_buffer));
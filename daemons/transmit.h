@@ -29,6 +29,8 @@ struct sbuf {
 };
 
 void init_send_buffer(void);
+void lock_send_buffer(void);
+void unlock_send_buffer(void);
 inline void set_bit(ir_code * code, int bit, int data);
 int init_send(struct ir_remote *remote, struct ir_ncode *code);
 int init_sim(struct ir_remote *remote, struct ir_ncode *code, int repeat_preset);
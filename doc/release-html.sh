@@ -13,7 +13,7 @@ FILES1="index.html install.html configure.html programs.html
 technical.html help.html audio.html audio-alsa.html alsa-usb.html
 devinput.html imon.html imon-24g.html pronto2lirc.html tira.html"
 FILES2="irexec.html ircat.html irw.html irpty.html irrecord.html
-irxevent.html lircd.html lircmd.html lircrcd.html mode2.html
+irxevent.html lircd.html lircd-check.html lircmd.html lircrcd.html mode2.html
 smode2.html xmode2.html irsend.html"
 
 echo -n "Pass1:"
@@ -51,6 +51,10 @@ select_vars ()
 		MANPAGE=$PROG.$SECTION
 		DIR=$TOPDIR/daemons/
 	;;
+	lircd-check)
+		MANPAGE=$PROG.$SECTION
+		DIR=$TOPDIR/daemons/
+	;;
 	lircd)
 		SECTION=8
 		MANPAGE=$PROG.$SECTION
@@ -88,7 +92,7 @@ install -d man-html
 HELP2MAN=help2man
 MAN2HTML=${BUILDDIR}/man2html
 
-for PROG in irpty irexec ircat irw mode2 smode2 xmode2 irsend irrecord lircd lircmd lircrcd irxevent
+for PROG in irpty irexec ircat irw mode2 smode2 xmode2 irsend irrecord lircd-check lircd lircmd lircrcd irxevent
 do
 	PROG_PARAMS=""
 	PROG_PRE_PARAMS=""
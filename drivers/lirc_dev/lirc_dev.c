@@ -53,6 +53,8 @@
 #endif
 
 static int debug;
+static int wakeup_chunks = 1;
+static int wakeup_delay;
 #define dprintk(fmt, args...)					\
 	do {							\
 		if (debug)					\
@@ -83,6 +85,9 @@ struct irctl {
 	struct task_struct *task;
 #endif
 	long jiffies_to_wait;
+
+	int wakeup_pending;
+	unsigned long wakeup_due;
 };
 
 static DEFINE_MUTEX(lirc_dev_lock);
@@ -152,6 +157,19 @@ get_data:
 	return 0;
 }
 
+/*  helper function
+ *  readers are only woken once wakeup_chunks codes are waiting, the
+ *  first of them has waited for wakeup_delay ms or the buffer is full
+ */
+static int lirc_wakeup_due(struct irctl *ir)
+{
+	int len = lirc_buffer_len(ir->buf);
+
+	return len >= wakeup_chunks * ir->chunk_size ||
+		len == ir->buf->size * ir->chunk_size ||
+		time_after_eq(jiffies, ir->wakeup_due);
+}
+
 /* main function of the polling thread */
 static int lirc_thread(void *irctl)
 {
@@ -182,8 +200,15 @@ static int lirc_thread(void *irctl)
 			if (kthread_should_stop())
 #endif
 				break;
-			if (!lirc_add_to_buf(ir))
+			if (!lirc_add_to_buf(ir) && !ir->wakeup_pending) {
+				ir->wakeup_pending = 1;
+				ir->wakeup_due = jiffies +
+					msecs_to_jiffies(wakeup_delay);
+			}
+			if (ir->wakeup_pending && lirc_wakeup_due(ir)) {
+				ir->wakeup_pending = 0;
 				wake_up_interruptible(&ir->buf->wait_poll);
+			}
 		} else {
 			set_current_state(TASK_INTERRUPTIBLE);
 			schedule();
@@ -755,6 +780,7 @@ ssize_t lirc_dev_fop_read(struct file *file, char __user *buffer,
 {
 	struct irctl *ir = irctls[iminor(file->f_dentry->d_inode)];
 	unsigned char *buf;
+	unsigned int count, got;
 	int ret = 0, written = 0;
 	DECLARE_WAITQUEUE(wait, current);
 
@@ -765,7 +791,9 @@ ssize_t lirc_dev_fop_read(struct file *file, char __user *buffer,
 
 	dprintk(LOGHEAD "read called\n", ir->d.name, ir->d.minor);
 
-	buf = kzalloc(ir->chunk_size, GFP_KERNEL);
+	/* as many codes as fit into the buffer are copied at once */
+	count = min_t(size_t, length / ir->chunk_size, ir->buf->size);
+	buf = kzalloc(max(count, 1U) * ir->chunk_size, GFP_KERNEL);
 	if (!buf)
 		return -ENOMEM;
 
@@ -828,11 +856,12 @@ ssize_t lirc_dev_fop_read(struct file *file, char __user *buffer,
 				break;
 			}
 		} else {
-			lirc_buffer_read(ir->buf, buf);
-			ret = copy_to_user((void *)buffer+written, buf,
-					   ir->buf->chunk_size);
+			got = lirc_buffer_read_bulk(ir->buf, buf,
+				min_t(unsigned int, count,
+				      (length - written) / ir->chunk_size));
+			ret = copy_to_user((void *)buffer+written, buf, got);
 			if (!ret)
-				written += ir->buf->chunk_size;
+				written += got;
 			else
 				ret = -EFAULT;
 		}
@@ -932,3 +961,11 @@ MODULE_LICENSE("GPL");
 
 module_param(debug, bool, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(debug, "Enable debugging messages");
+
+module_param(wakeup_chunks, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(wakeup_chunks, "Wake up readers of polled devices once "
+		 "this many codes are waiting (default: 1)");
+
+module_param(wakeup_delay, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(wakeup_delay, "Wake up readers of polled devices at the "
+		 "latest after this many ms (default: 0)");
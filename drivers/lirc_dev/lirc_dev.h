@@ -46,8 +46,10 @@ static inline void lirc_buffer_clear(struct lirc_buffer *buf)
 	unsigned long flags;
 
 	if (buf->fifo_initialized) {
+		/* only the reader's side is reset, so that a producer
+		 * using lirc_buffer_write_nolock() is not disturbed */
 		spin_lock_irqsave(&buf->fifo_lock, flags);
-		kfifo_reset(&buf->fifo);
+		kfifo_reset_out(&buf->fifo);
 		spin_unlock_irqrestore(&buf->fifo_lock, flags);
 	} else
 		WARN(1, "calling %s on an uninitialized lirc_buffer\n",
@@ -156,6 +158,50 @@ static inline unsigned int lirc_buffer_write(struct lirc_buffer *buf,
 	return ret;
 }
 
+/* reads as many complete chunks as are available, but not more than
+ * count, with one copy and returns the number of bytes read */
+static inline unsigned int lirc_buffer_read_bulk(struct lirc_buffer *buf,
+						 unsigned char *dest,
+						 unsigned int count)
+{
+	unsigned int len;
+
+	len = lirc_buffer_len(buf) / buf->chunk_size;
+	if (len > count)
+		len = count;
+	if (len == 0)
+		return 0;
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 33)
+	return kfifo_get(buf->fifo, dest, len * buf->chunk_size);
+#else
+	return kfifo_out_locked(&buf->fifo, dest, len * buf->chunk_size,
+				&buf->fifo_lock);
+#endif
+}
+
+/* lirc_buffer_write() without taking the lock
+ *
+ * The fifo needs no lock with a single reader and a single writer,
+ * and the readers are serialized by lirc_dev. A driver that writes
+ * from one context only (e.g. its interrupt handler) can use this
+ * instead of lirc_buffer_full() and lirc_buffer_write(). Returns 0
+ * and drops the chunk if the buffer is full. Older kernels, whose
+ * lirc_buffer_clear() resets both sides of the fifo, take the lock.
+ */
+static inline unsigned int lirc_buffer_write_nolock(struct lirc_buffer *buf,
+						    unsigned char *orig)
+{
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 33)
+	if (lirc_buffer_full(buf))
+		return 0;
+	return lirc_buffer_write(buf, orig);
+#else
+	if (kfifo_avail(&buf->fifo) < buf->chunk_size)
+		return 0;
+	return kfifo_in(&buf->fifo, orig, buf->chunk_size);
+#endif
+}
+
 struct lirc_driver {
 	char name[40];
 	int minor;
@@ -596,14 +596,13 @@ static void send_space_homebrew(long length)
 	safe_udelay(length);
 }
 
+/* only called from the interrupt handler, so no lock is needed */
 static void rbwrite(int l)
 {
-	if (lirc_buffer_full(&rbuf)) {
+	if (!lirc_buffer_write_nolock(&rbuf, (void *)&l)) {
 		/* no new signals will be accepted */
 		dprintk("Buffer overrun\n");
-		return;
 	}
-	lirc_buffer_write(&rbuf, (void *)&l);
 }
 
 static void frbwrite(int l)
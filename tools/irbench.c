@@ -0,0 +1,620 @@
+/*
+
+  irbench - put lircd under load and measure how fast it answers
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+*/
+
+/*
+  Every connection sends the commands in turn, either as soon as the
+  previous reply is in or at a fixed rate, and receives the events
+  lircd broadcasts. With --simulate one more connection injects
+  events through SIMULATE (lircd has to run with --allow-simulate),
+  their sequence number is sent as the code so that every connection
+  can tell how long the broadcast took. For this lircd needs no
+  hardware, e.g. lircd --allow-simulate --driver=null.
+
+  The results go to stdout, one line per measurement, as a keyword
+  followed by name=value pairs. Times are in microseconds; with a
+  fixed rate they are counted from when a command was due, so that
+  a lircd that falls behind is not measured at its own pace.
+*/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#define PACKET_SIZE 256
+#define BUFFER_SIZE 65536
+#define MAX_COMMANDS 16
+#define SIMULATE_WINDOW 65536	/* send times kept for broadcasts */
+#define SIMULATE_PENDING 64	/* unanswered SIMULATEs before pausing */
+#define SIMULATE_REMOTE "irbench"
+
+char *progname;
+
+struct samples {
+	const char *name;
+	unsigned int *usec;
+	unsigned long count, size;
+	unsigned long errors;
+};
+
+enum reply_state {
+	R_NONE,			/* between packets */
+	R_MESSAGE,		/* after BEGIN */
+	R_OURS,			/* in the reply to our command */
+	R_OTHER			/* in some other packet, e.g. SIGHUP */
+};
+
+struct connection {
+	int fd;
+	int tcp;
+	int injector;
+	char buffer[BUFFER_SIZE];
+	size_t len;
+	enum reply_state state;
+	int error;
+	int waiting;		/* command sent, reply outstanding */
+	int command;		/* which one */
+	unsigned long long sent;	/* when it was sent or due */
+	unsigned long long next;	/* when the next one is due */
+	unsigned long long retry;	/* when to reconnect */
+};
+
+static char *lircd;
+static struct sockaddr_in addr_in;
+
+static char commands[MAX_COMMANDS][PACKET_SIZE + 1];
+static struct samples replies[MAX_COMMANDS];
+static int command_count = 0;
+static double rate = -1;	/* <0: closed loop, 0: no commands */
+
+static struct samples broadcasts = { "broadcast" };
+static double simulate_rate = 0;
+static unsigned long long simulate_sent_at[SIMULATE_WINDOW];
+static unsigned long simulate_sent = 0, simulate_answered = 0, simulate_errors = 0;
+static unsigned long broadcasts_expected = 0;
+
+static unsigned long opened = 0, dropped = 0, failed = 0;
+
+static unsigned long long now_usec(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+	{
+		struct timeval tv;
+
+		gettimeofday(&tv, NULL);
+		return (unsigned long long)tv.tv_sec * 1000000 + tv.tv_usec;
+	}
+}
+
+static void add_sample(struct samples *s, unsigned long long usec)
+{
+	if (s->count == s->size) {
+		unsigned int *usecs;
+
+		usecs = realloc(s->usec, (s->size ? 2 * s->size : 1024) * sizeof(*s->usec));
+		if (usecs == NULL) {
+			/* keep measuring with what we have */
+			return;
+		}
+		s->usec = usecs;
+		s->size = s->size ? 2 * s->size : 1024;
+	}
+	s->usec[s->count++] = usec > UINT_MAX ? UINT_MAX : usec;
+}
+
+static int compare_usec(const void *a, const void *b)
+{
+	unsigned int x = *(const unsigned int *)a, y = *(const unsigned int *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static unsigned int percentile(struct samples *s, int p)
+{
+	return s->usec[(s->count - 1) * p / 100];
+}
+
+static void print_samples(const char *kind, struct samples *s, double seconds)
+{
+	printf("%s name=%s count=%lu errors=%lu rate=%.1f", kind, s->name, s->count, s->errors, s->count / seconds);
+	if (s->count > 0) {
+		qsort(s->usec, s->count, sizeof(*s->usec), compare_usec);
+		printf(" p50=%u p90=%u p99=%u p999=%u max=%u", percentile(s, 50), percentile(s, 90),
+		       percentile(s, 99), s->usec[(s->count - 1) * 999 / 1000], s->usec[s->count - 1]);
+	}
+	printf("\n");
+}
+
+static int open_connection(struct connection *c)
+{
+	struct sockaddr_un addr_un;
+	int flags;
+
+	if (c->tcp) {
+		c->fd = socket(AF_INET, SOCK_STREAM, 0);
+	} else {
+		addr_un.sun_family = AF_UNIX;
+		strcpy(addr_un.sun_path, lircd);
+		c->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	}
+	if (c->fd == -1
+	    || connect(c->fd, c->tcp ? (struct sockaddr *)&addr_in : (struct sockaddr *)&addr_un,
+		       c->tcp ? sizeof(addr_in) : sizeof(addr_un)) == -1) {
+		if (c->fd != -1)
+			close(c->fd);
+		c->fd = -1;
+		failed++;
+		return (0);
+	}
+	flags = fcntl(c->fd, F_GETFL, 0);
+	if (flags != -1)
+		fcntl(c->fd, F_SETFL, flags | O_NONBLOCK);
+	c->len = 0;
+	c->state = R_NONE;
+	c->waiting = 0;
+	opened++;
+	return (1);
+}
+
+static void close_connection(struct connection *c)
+{
+	close(c->fd);
+	c->fd = -1;
+	c->waiting = 0;
+}
+
+static int write_packet(struct connection *c, const char *packet)
+{
+	size_t todo = strlen(packet);
+	ssize_t done;
+	struct pollfd pfd;
+
+	while (todo > 0) {
+		done = write(c->fd, packet, todo);
+		if (done == -1 && errno == EAGAIN) {
+			/* lircd is behind, it will come back */
+			pfd.fd = c->fd;
+			pfd.events = POLLOUT;
+			poll(&pfd, 1, 1000);
+			continue;
+		}
+		if (done <= 0)
+			return (0);
+		packet += done;
+		todo -= done;
+	}
+	return (1);
+}
+
+static int send_command(struct connection *c, unsigned long long due)
+{
+	if (!write_packet(c, commands[c->command]))
+		return (0);
+	c->sent = due;
+	c->waiting = 1;
+	return (1);
+}
+
+static int send_simulate(struct connection *c, unsigned long long now)
+{
+	char packet[PACKET_SIZE + 1];
+
+	sprintf(packet, "SIMULATE %016lx 00 KEY_%lu " SIMULATE_REMOTE "\n", simulate_sent, simulate_sent);
+	simulate_sent_at[simulate_sent % SIMULATE_WINDOW] = now;
+	if (!write_packet(c, packet))
+		return (0);
+	simulate_sent++;
+	return (1);
+}
+
+/* an event lircd sent to all clients */
+static void handle_event(struct connection *c, char *line, unsigned long long now)
+{
+	unsigned long seq;
+	char remote[PACKET_SIZE + 1];
+
+	if (c->injector)
+		return;
+	if (sscanf(line, "%lx %*x %*s %256s", &seq, remote) != 2 || strcmp(remote, SIMULATE_REMOTE) != 0)
+		return;
+	if (seq >= simulate_sent || simulate_sent - seq > SIMULATE_WINDOW)
+		return;
+	add_sample(&broadcasts, now - simulate_sent_at[seq % SIMULATE_WINDOW]);
+}
+
+static void handle_line(struct connection *c, char *line, unsigned long long now)
+{
+	const char *ours;
+
+	switch (c->state) {
+	case R_NONE:
+		if (strcmp(line, "BEGIN") == 0)
+			c->state = R_MESSAGE;
+		else
+			handle_event(c, line, now);
+		break;
+	case R_MESSAGE:
+		c->error = 0;
+		if (c->injector) {
+			c->state = strncmp(line, "SIMULATE ", 9) == 0 ? R_OURS : R_OTHER;
+			break;
+		}
+		ours = c->waiting ? commands[c->command] : "";
+		if (strlen(line) + 1 == strlen(ours) && strncasecmp(line, ours, strlen(line)) == 0)
+			c->state = R_OURS;
+		else
+			c->state = R_OTHER;
+		break;
+	case R_OURS:
+		if (strcmp(line, "ERROR") == 0) {
+			c->error = 1;
+		} else if (strcmp(line, "END") == 0) {
+			if (c->injector) {
+				simulate_answered++;
+				simulate_errors += c->error;
+			} else {
+				add_sample(&replies[c->command], now - c->sent);
+				replies[c->command].errors += c->error;
+				c->waiting = 0;
+				c->command = (c->command + 1) % command_count;
+			}
+			c->state = R_NONE;
+		}
+		break;
+	case R_OTHER:
+		if (strcmp(line, "END") == 0)
+			c->state = R_NONE;
+		break;
+	}
+}
+
+/* returns 0 if lircd closed the connection */
+static int read_connection(struct connection *c)
+{
+	unsigned long long now;
+	char *line, *end;
+	ssize_t ret;
+
+	ret = read(c->fd, c->buffer + c->len, BUFFER_SIZE - c->len);
+	if (ret == -1 && (errno == EAGAIN || errno == EINTR))
+		return (1);
+	if (ret <= 0)
+		return (0);
+	now = now_usec();
+	c->len += ret;
+	line = c->buffer;
+	while ((end = memchr(line, '\n', c->buffer + c->len - line)) != NULL) {
+		*end = 0;
+		handle_line(c, line, now);
+		line = end + 1;
+	}
+	c->len -= line - c->buffer;
+	if (c->len == BUFFER_SIZE) {
+		fprintf(stderr, "%s: line too long\n", progname);
+		return (0);
+	}
+	memmove(c->buffer, line, c->len);
+	return (1);
+}
+
+static int parse_rate(const char *s, double *value)
+{
+	char *end;
+
+	*value = strtod(s, &end);
+	return (*s && !*end && *value >= 0);
+}
+
+int main(int argc, char **argv)
+{
+	char *address = NULL;
+	unsigned short port = LIRC_INET_PORT;
+	int local_count = 1, tcp_count = 0, count, i, n, busy, injector;
+	double seconds = 5, period = 0, simulate_period = 0;
+	struct connection *connections;
+	struct pollfd *pfds;
+	unsigned long long start, now, end, stop, simulate_next = 0;
+	long timeout;
+
+	progname = "irbench";
+	lircd = LIRCD;
+	while (1) {
+		int c;
+		static struct option long_options[] = {
+			{"help", no_argument, NULL, 'h'},
+			{"version", no_argument, NULL, 'v'},
+			{"device", required_argument, NULL, 'd'},
+			{"address", required_argument, NULL, 'a'},
+			{"connections", required_argument, NULL, 'n'},
+			{"tcp-connections", required_argument, NULL, 'N'},
+			{"rate", required_argument, NULL, 'r'},
+			{"simulate", required_argument, NULL, 's'},
+			{"time", required_argument, NULL, 't'},
+			{0, 0, 0, 0}
+		};
+		c = getopt_long(argc, argv, "hvd:a:n:N:r:s:t:", long_options, NULL);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 'h':
+			printf("Usage: %s [options] [command...]\n", progname);
+			printf("\t -h --help\t\t\tdisplay usage summary\n");
+			printf("\t -v --version\t\t\tdisplay version\n");
+			printf("\t -d --device=socket\t\tuse given lircd socket [%s]\n", LIRCD);
+			printf("\t -a --address=host[:port]\tlircd address for TCP connections [localhost]\n");
+			printf("\t -n --connections=n\t\tthis many connections to the socket [1]\n");
+			printf("\t -N --tcp-connections=n\t\tthis many TCP connections [0]\n");
+			printf("\t -r --rate=n\t\t\tcommands per second and connection\n");
+			printf("\t\t\t\t\t(default: next one after the reply, 0: none)\n");
+			printf("\t -s --simulate=n\t\tSIMULATE this many events per second\n");
+			printf("\t -t --time=seconds\t\trun this long [5]\n");
+			printf("The commands (default: LIST and VERSION) are sent in turn.\n");
+			return (EXIT_SUCCESS);
+		case 'v':
+			printf("%s %s\n", progname, VERSION);
+			return (EXIT_SUCCESS);
+		case 'd':
+			lircd = optarg;
+			break;
+		case 'a':
+			{
+				char *p;
+				char *end;
+				unsigned long val;
+
+				address = strdup(optarg);
+				if (!address) {
+					fprintf(stderr, "%s: out of memory\n", progname);
+					return (EXIT_FAILURE);
+				}
+				p = strchr(address, ':');
+				if (p != NULL) {
+					val = strtoul(p + 1, &end, 10);
+					if (!(*(p + 1)) || *end || val < 1 || val > USHRT_MAX) {
+						fprintf(stderr, "%s: invalid port number: %s\n", progname, p + 1);
+						return (EXIT_FAILURE);
+					}
+					port = (unsigned short)val;
+					*p = 0;
+				}
+				break;
+			}
+		case 'n':
+		case 'N':
+			{
+				char *end;
+				long val;
+
+				val = strtol(optarg, &end, 10);
+				if (!*optarg || *end || val < 0 || val > 10000) {
+					fprintf(stderr, "%s: invalid number of connections: %s\n", progname, optarg);
+					return (EXIT_FAILURE);
+				}
+				if (c == 'n')
+					local_count = val;
+				else
+					tcp_count = val;
+				break;
+			}
+		case 'r':
+			if (!parse_rate(optarg, &rate)) {
+				fprintf(stderr, "%s: invalid rate: %s\n", progname, optarg);
+				return (EXIT_FAILURE);
+			}
+			break;
+		case 's':
+			if (!parse_rate(optarg, &simulate_rate)) {
+				fprintf(stderr, "%s: invalid rate: %s\n", progname, optarg);
+				return (EXIT_FAILURE);
+			}
+			break;
+		case 't':
+			if (!parse_rate(optarg, &seconds) || seconds == 0) {
+				fprintf(stderr, "%s: invalid time: %s\n", progname, optarg);
+				return (EXIT_FAILURE);
+			}
+			break;
+		default:
+			return (EXIT_FAILURE);
+		}
+	}
+	if (optind == argc) {
+		strcpy(commands[command_count++], "LIST\n");
+		strcpy(commands[command_count++], "VERSION\n");
+	}
+	for (; optind < argc; optind++) {
+		if (command_count == MAX_COMMANDS || strlen(argv[optind]) + 2 > sizeof(commands[0])) {
+			fprintf(stderr, "%s: too many or too long commands\n", progname);
+			return (EXIT_FAILURE);
+		}
+		sprintf(commands[command_count++], "%s\n", argv[optind]);
+	}
+	for (i = 0; i < command_count; i++) {
+		replies[i].name = strdup(commands[i]);
+		if (replies[i].name == NULL) {
+			fprintf(stderr, "%s: out of memory\n", progname);
+			return (EXIT_FAILURE);
+		}
+		/* no spaces in the results */
+		for (n = 0; commands[i][n] != 0; n++)
+			((char *)replies[i].name)[n] = commands[i][n] == ' ' ? '_' : commands[i][n] == '\n' ? 0 : commands[i][n];
+	}
+	if (rate > 0)
+		period = 1000000 / rate;
+	if (simulate_rate > 0)
+		simulate_period = 1000000 / simulate_rate;
+
+	if (strlen(lircd) + 1 > sizeof(((struct sockaddr_un *)NULL)->sun_path)) {
+		fprintf(stderr, "%s: socket name is too long\n", progname);
+		return (EXIT_FAILURE);
+	}
+	if (tcp_count > 0) {
+		struct hostent *hostInfo;
+
+		hostInfo = gethostbyname(address ? address : "localhost");
+		if (hostInfo == NULL) {
+			fprintf(stderr, "%s: host %s unknown\n", progname, address ? address : "localhost");
+			return (EXIT_FAILURE);
+		}
+		addr_in.sin_family = hostInfo->h_addrtype;
+		memcpy((char *)&addr_in.sin_addr.s_addr, hostInfo->h_addr_list[0], hostInfo->h_length);
+		addr_in.sin_port = htons(port);
+	}
+
+	/* the injector comes last */
+	injector = simulate_rate > 0;
+	count = local_count + tcp_count + injector;
+	if (count == 0) {
+		fprintf(stderr, "%s: no connections\n", progname);
+		return (EXIT_FAILURE);
+	}
+	connections = calloc(count, sizeof(*connections));
+	pfds = calloc(count, sizeof(*pfds));
+	if (connections == NULL || pfds == NULL) {
+		fprintf(stderr, "%s: out of memory\n", progname);
+		return (EXIT_FAILURE);
+	}
+	start = now_usec();
+	for (i = 0; i < count; i++) {
+		connections[i].tcp = i >= local_count && i < local_count + tcp_count;
+		connections[i].injector = injector && i == count - 1;
+		/* spread the commands over the period */
+		connections[i].next = start + (unsigned long long)(period * i / count);
+		if (!open_connection(&connections[i])) {
+			fprintf(stderr, "%s: could not connect to lircd\n", progname);
+			perror(progname);
+			return (EXIT_FAILURE);
+		}
+	}
+
+	simulate_next = start;
+	end = start + (unsigned long long)(seconds * 1000000);
+	stop = 0;
+	while (1) {
+		now = now_usec();
+		if (stop == 0 && now >= end) {
+			/* wait up to a second for what is still on its way */
+			stop = now + 1000000;
+		}
+		busy = 0;
+		timeout = 100000;
+		for (i = 0; i < count; i++) {
+			struct connection *c = &connections[i];
+
+			if (c->fd == -1) {
+				if (stop != 0 || now < c->retry)
+					continue;
+				if (!open_connection(c)) {
+					c->retry = now + 100000;
+					continue;
+				}
+			}
+			if (c->injector) {
+				while (stop == 0 && now >= simulate_next
+				       && simulate_sent - simulate_answered < SIMULATE_PENDING) {
+					if (!send_simulate(c, now))
+						break;
+					simulate_next += (unsigned long long)simulate_period;
+				}
+				if (stop == 0 && simulate_next > now && simulate_next - now < timeout)
+					timeout = simulate_next - now;
+				busy |= simulate_answered < simulate_sent;
+			} else if (stop == 0 && rate != 0 && !c->waiting) {
+				if (rate < 0) {
+					send_command(c, now);
+				} else if (now >= c->next) {
+					send_command(c, c->next);
+					c->next += (unsigned long long)period;
+				} else if (c->next - now < timeout) {
+					timeout = c->next - now;
+				}
+			}
+			busy |= c->waiting;
+		}
+		if (stop != 0) {
+			broadcasts_expected = simulate_answered * (count - injector);
+			if (now >= stop || (!busy && broadcasts.count >= broadcasts_expected))
+				break;
+		}
+
+		for (i = 0; i < count; i++) {
+			pfds[i].fd = connections[i].fd;
+			pfds[i].events = POLLIN;
+			pfds[i].revents = 0;
+		}
+		/* rather early than late, this is counted as latency */
+		if (poll(pfds, count, timeout / 1000) == -1) {
+			if (errno == EINTR)
+				continue;
+			perror(progname);
+			return (EXIT_FAILURE);
+		}
+		for (i = 0; i < count; i++) {
+			if (connections[i].fd == -1 || !(pfds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+				continue;
+			if (!read_connection(&connections[i])) {
+				close_connection(&connections[i]);
+				dropped++;
+			}
+		}
+	}
+
+	seconds = (end - start) / 1000000.0;
+	printf("run seconds=%.1f connections=%d tcp=%d rate=%.1f simulate=%.1f\n", seconds, local_count + tcp_count,
+	       tcp_count, rate, simulate_rate);
+	for (i = 0; i < command_count; i++) {
+		if (rate != 0)
+			print_samples("reply", &replies[i], seconds);
+	}
+	if (injector) {
+		printf("simulate sent=%lu answered=%lu errors=%lu\n", simulate_sent, simulate_answered,
+		       simulate_errors);
+		print_samples("event", &broadcasts, seconds);
+		printf("broadcast expected=%lu received=%lu lost=%lu\n", broadcasts_expected, broadcasts.count,
+		       broadcasts_expected > broadcasts.count ? broadcasts_expected - broadcasts.count : 0);
+	}
+	printf("connections opened=%lu dropped=%lu failed=%lu\n", opened, dropped, failed);
+	for (i = 0; i < count; i++) {
+		if (connections[i].fd != -1)
+			close(connections[i].fd);
+	}
+	return (EXIT_SUCCESS);
+}
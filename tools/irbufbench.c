@@ -0,0 +1,278 @@
+/*
+
+  irbufbench - measure the lirc_buffer paths of lirc_dev in user space
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+*/
+
+/*
+  drivers/lirc_dev/lirc_dev.h is built against the stand-ins for the
+  kernel headers in tools/kcompat. The buffer has the size lirc_serial
+  uses. Every round writes as many codes as one read() takes and reads
+  them back:
+
+  - write name=locked: lirc_buffer_full() and lirc_buffer_write(), as
+    lirc_serial's interrupt handler did before
+  - write name=nolock: lirc_buffer_write_nolock()
+  - read name=single: one lirc_buffer_read() and copy_to_user() per
+    code, as lirc_dev_fop_read() did before
+  - read name=bulk: lirc_buffer_read_bulk() and one copy_to_user()
+
+  Times are in nanoseconds per code, copy_to_user() is a memcpy()
+  here. Then a thread writes codes with lirc_buffer_write_nolock()
+  while the main thread reads them in bulk, and every code has to
+  arrive in order; irbufbench exits with an error otherwise.
+*/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "drivers/lirc_dev/lirc_dev.h"
+
+#define RBUF_LEN 256		/* as in lirc_serial */
+
+struct path {
+	const char *name;
+	double nsecs;
+};
+
+static char *progname;
+static struct lirc_buffer rbuf;
+static unsigned int codes = 64, threaded_codes = 1000000;
+
+static double elapsed(struct timespec *t0, struct timespec *t1)
+{
+	return (t1->tv_sec - t0->tv_sec) * 1e9 + (t1->tv_nsec - t0->tv_nsec);
+}
+
+static void write_locked(int code)
+{
+	if (lirc_buffer_full(&rbuf))
+		return;
+	lirc_buffer_write(&rbuf, (unsigned char *)&code);
+}
+
+static void write_nolock(int code)
+{
+	lirc_buffer_write_nolock(&rbuf, (unsigned char *)&code);
+}
+
+/* the loops of lirc_dev_fop_read() without the waiting */
+static unsigned int read_single(char *buffer, unsigned int length)
+{
+	unsigned char buf[sizeof(int)];
+	unsigned int written = 0;
+
+	while (written < length && !lirc_buffer_empty(&rbuf)) {
+		lirc_buffer_read(&rbuf, buf);
+		if (copy_to_user(buffer + written, buf, rbuf.chunk_size))
+			break;
+		written += rbuf.chunk_size;
+	}
+	return written;
+}
+
+static unsigned int read_bulk(char *buffer, unsigned int length)
+{
+	unsigned char buf[RBUF_LEN * sizeof(int)];
+	unsigned int count, got, written = 0;
+
+	count = length / rbuf.chunk_size;
+	if (count > rbuf.size)
+		count = rbuf.size;
+	while (written < length && !lirc_buffer_empty(&rbuf)) {
+		if (count > (length - written) / rbuf.chunk_size)
+			count = (length - written) / rbuf.chunk_size;
+		got = lirc_buffer_read_bulk(&rbuf, buf, count);
+		if (copy_to_user(buffer + written, buf, got))
+			break;
+		written += got;
+	}
+	return written;
+}
+
+static int check_codes(int *buffer, unsigned int length, int *next)
+{
+	unsigned int i;
+	int errors = 0;
+
+	for (i = 0; i < length / sizeof(int); i++)
+		if (buffer[i] != (*next)++)
+			errors++;
+	return errors;
+}
+
+/* every write path is followed by every read path */
+static int run_rounds(struct path *writes, struct path *reads, int iterations)
+{
+	struct timespec t0, t1;
+	int buffer[RBUF_LEN];
+	int i, w, r, next = 0, seq = 0, errors = 0;
+	unsigned int c, got;
+
+	for (i = 0; i < iterations; i++) {
+		for (w = 0; w < 2; w++) {
+			for (r = 0; r < 2; r++) {
+				clock_gettime(CLOCK_MONOTONIC, &t0);
+				for (c = 0; c < codes; c++)
+					w ? write_nolock(seq++) : write_locked(seq++);
+				clock_gettime(CLOCK_MONOTONIC, &t1);
+				writes[w].nsecs += elapsed(&t0, &t1);
+
+				clock_gettime(CLOCK_MONOTONIC, &t0);
+				got = r ? read_bulk((char *)buffer, codes * sizeof(int))
+					: read_single((char *)buffer, codes * sizeof(int));
+				clock_gettime(CLOCK_MONOTONIC, &t1);
+				reads[r].nsecs += elapsed(&t0, &t1);
+
+				if (got != codes * sizeof(int))
+					errors++;
+				errors += check_codes(buffer, got, &next);
+				next = seq;
+			}
+		}
+	}
+	return errors;
+}
+
+static void *producer(void *arg)
+{
+	unsigned int i;
+
+	for (i = 0; i < threaded_codes; i++) {
+		while (!lirc_buffer_write_nolock(&rbuf, (unsigned char *)&i))
+			sched_yield();
+	}
+	return NULL;
+}
+
+/* lirc_serial's interrupt handler against a reader */
+static int run_threaded(double *nsecs)
+{
+	struct timespec t0, t1;
+	pthread_t thread;
+	int buffer[RBUF_LEN];
+	unsigned int got, received = 0;
+	int next = 0, errors = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	if (pthread_create(&thread, NULL, producer, NULL) != 0) {
+		fprintf(stderr, "%s: can't start the writer thread\n", progname);
+		return 1;
+	}
+	while (received < threaded_codes) {
+		got = read_bulk((char *)buffer, codes * sizeof(int));
+		if (got == 0) {
+			sched_yield();
+			continue;
+		}
+		errors += check_codes(buffer, got, &next);
+		received += got / sizeof(int);
+	}
+	pthread_join(thread, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	*nsecs = elapsed(&t0, &t1);
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	struct path writes[2] = { {"locked", 0}, {"nolock", 0} };
+	struct path reads[2] = { {"single", 0}, {"bulk", 0} };
+	int iterations = 10000, errors, threaded_errors, i;
+	double per_path, nsecs;
+
+	progname = "irbufbench";
+	while (1) {
+		int c;
+		static struct option long_options[] = {
+			{"help", no_argument, NULL, 'h'},
+			{"version", no_argument, NULL, 'v'},
+			{"codes", required_argument, NULL, 'c'},
+			{"iterations", required_argument, NULL, 'i'},
+			{0, 0, 0, 0}
+		};
+		c = getopt_long(argc, argv, "hvc:i:", long_options, NULL);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 'h':
+			printf("Usage: %s [options]\n", progname);
+			printf("\t -h --help\t\t\tdisplay usage summary\n");
+			printf("\t -v --version\t\t\tdisplay version\n");
+			printf("\t -c --codes=n\t\t\tcodes per read() [64]\n");
+			printf("\t -i --iterations=n\t\tnumber of rounds [10000]\n");
+			return (EXIT_SUCCESS);
+		case 'v':
+			printf("%s %s\n", progname, VERSION);
+			return (EXIT_SUCCESS);
+		case 'c':
+			i = atoi(optarg);
+			if (i < 1 || i > RBUF_LEN) {
+				fprintf(stderr, "%s: codes must be 1 to %d: %s\n", progname, RBUF_LEN, optarg);
+				return (EXIT_FAILURE);
+			}
+			codes = i;
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			if (iterations < 1) {
+				fprintf(stderr, "%s: invalid number of iterations: %s\n", progname, optarg);
+				return (EXIT_FAILURE);
+			}
+			break;
+		default:
+			printf("Usage: %s [options]\n", progname);
+			return (EXIT_FAILURE);
+		}
+	}
+	if (optind < argc) {
+		fprintf(stderr, "%s: too many arguments\n", progname);
+		return (EXIT_FAILURE);
+	}
+
+	if (lirc_buffer_init(&rbuf, sizeof(int), RBUF_LEN) != 0) {
+		fprintf(stderr, "%s: out of memory\n", progname);
+		return (EXIT_FAILURE);
+	}
+	printf("buffer codes=%d code_size=%u read_codes=%u\n", RBUF_LEN, rbuf.chunk_size, codes);
+
+	errors = run_rounds(writes, reads, iterations);
+	/* each path ran in half of the rounds */
+	per_path = 2.0 * iterations * codes;
+	for (i = 0; i < 2; i++)
+		printf("write name=%s nsecs=%.1f\n", writes[i].name, writes[i].nsecs / per_path);
+	for (i = 0; i < 2; i++)
+		printf("read name=%s nsecs=%.1f\n", reads[i].name, reads[i].nsecs / per_path);
+
+	lirc_buffer_clear(&rbuf);
+	threaded_errors = run_threaded(&nsecs);
+	printf("threaded codes=%u nsecs=%.1f\n", threaded_codes, nsecs / threaded_codes);
+	printf("check rounds=%d threaded_codes=%u errors=%d\n", 4 * iterations, threaded_codes,
+	       errors + threaded_errors);
+
+	lirc_buffer_free(&rbuf);
+	return (errors + threaded_errors ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,472 @@
+/*
+
+  ircmdbench - measure how long received signals take from a CommandIR
+  to lircd and what polling the device costs
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+*/
+
+/*
+  daemons/hw_commandir.c is built against the libusb-0.1 stand-in in
+  tools/usbcompat, and usbreplay.c plays a CommandIR II that receives
+  a recording. The driver forks its child as in lircd and polls the
+  device every read_delay usecs. ircmdbench reads the samples like
+  mode2 does.
+
+  A recording has one packet per line, the usecs since the previous
+  packet followed by the bytes of the packet in hex. Lines starting
+  with # are comments. Without --file ircmdbench records NEC frames
+  itself, --write saves such a recording.
+
+  The results go to stdout, one line per measurement, as a keyword
+  followed by name=value pairs. The latency of a packet is the time
+  from when it is due until lircd has read its last sample. The CPU
+  time is the child's, the bulk reads return at once here, so it
+  doesn't include the time the USB stack would take. Every sample is
+  checked on arrival, ircmdbench exits with an error if one is lost
+  or wrong.
+*/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <syslog.h>
+#include <time.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+
+#include "drivers/lirc.h"
+#include "daemons/lircd.h"
+#include "daemons/hardware.h"
+#include "usbreplay.h"
+
+/* as in hw_commandir.h */
+#define CMDIR_RX_HEADER_DATA 0x01
+#define CMDIR_PULSE_MASK 0x8000
+#define CMDIR_OVERFLOW_MASK 0x4000
+#define CMDIR_MAX_COUNT 0x3fff
+#define CMDIR_MAX_VALUES ((REPLAY_MAX_PACKET - 2) / 2)
+
+#define NEC_GAP 100000
+
+int debug = 0;
+FILE *lf = NULL;
+char *hostname = "";
+int daemonized = 0;
+char *progname;
+
+struct hardware hw;
+extern struct hardware hw_commandir;
+extern int read_delay;
+
+
+struct packet {
+	long due;		/* usecs after the device answered */
+	int length;
+	unsigned char data[REPLAY_MAX_PACKET];
+	int samples;
+};
+
+static const char *benchname = "ircmdbench";
+static int log_driver = 0;
+static struct packet *packets = NULL;
+static int packet_count = 0;
+static lirc_t *expected = NULL;
+static int sample_count = 0;
+
+void logprintf(int prio, const char *format_str, ...)
+{
+	va_list ap;
+
+	if (!log_driver)
+		return;
+	fprintf(stderr, "%s: ", benchname);
+	va_start(ap, format_str);
+	if (prio == LOG_WARNING)
+		fprintf(stderr, "WARNING: ");
+	vfprintf(stderr, format_str, ap);
+	fputc('\n', stderr);
+	va_end(ap);
+}
+
+void logperror(int prio, const char *s)
+{
+	if (s != NULL)
+		logprintf(prio, "%s: %s", s, strerror(errno));
+	else
+		logprintf(prio, "%s", strerror(errno));
+}
+
+int waitfordata(long maxusec)
+{
+	fd_set fds;
+	struct timeval tv;
+	int ret;
+
+	do {
+		FD_ZERO(&fds);
+		FD_SET(hw.fd, &fds);
+		tv.tv_sec = maxusec / 1000000;
+		tv.tv_usec = maxusec % 1000000;
+		ret = select(hw.fd + 1, &fds, NULL, NULL, maxusec > 0 ? &tv : NULL);
+	}
+	while (ret == -1 && errno == EINTR);
+	return (ret > 0);
+}
+
+static void *grow(void *ptr, size_t size)
+{
+	ptr = realloc(ptr, size);
+	if (ptr == NULL) {
+		fprintf(stderr, "%s: out of memory\n", benchname);
+		exit(EXIT_FAILURE);
+	}
+	return (ptr);
+}
+
+/* the samples commandir2_convert_RX() makes of a packet */
+static int decode_packet(const unsigned char *data, int length, lirc_t * samples)
+{
+	unsigned short values[CMDIR_MAX_VALUES];
+	int count, i, n = 0;
+
+	if (length < 2 || data[0] != CMDIR_RX_HEADER_DATA)
+		return (0);
+	count = data[1];
+	if (count > (length - 2) / 2)
+		count = (length - 2) / 2;
+	memcpy(values, data + 2, count * sizeof(values[0]));
+	for (i = 0; i < count; i++, n++) {
+		samples[n] = (values[i] & CMDIR_MAX_COUNT) / 3;
+		if ((values[i] & CMDIR_OVERFLOW_MASK) && i + 1 < count)
+			samples[n] += values[i + 1] * 0xffff / 12;
+		if (values[i] & CMDIR_PULSE_MASK)
+			samples[n] |= PULSE_BIT;
+		if (values[i] & CMDIR_OVERFLOW_MASK)
+			i++;
+	}
+	return (n);
+}
+
+static int add_packet(long due, const unsigned char *data, int length)
+{
+	struct packet *p;
+	lirc_t samples[CMDIR_MAX_VALUES];
+
+	if (!usb_replay_add(due, data, length))
+		return (0);
+	packets = grow(packets, (packet_count + 1) * sizeof(*packets));
+	p = &packets[packet_count++];
+	p->due = due;
+	p->length = length;
+	memcpy(p->data, data, length);
+	p->samples = decode_packet(data, length, samples);
+	expected = grow(expected, (sample_count + p->samples + 1) * sizeof(*expected));
+	memcpy(expected + sample_count, samples, p->samples * sizeof(*expected));
+	sample_count += p->samples;
+	return (1);
+}
+
+static void add_values(long due, unsigned short *values, int n)
+{
+	unsigned char data[REPLAY_MAX_PACKET];
+
+	data[0] = CMDIR_RX_HEADER_DATA;
+	data[1] = n;
+	memcpy(data + 2, values, n * sizeof(values[0]));
+	add_packet(due, data, 2 + n * sizeof(values[0]));
+}
+
+/* one NEC frame after a gap, in packets of the CommandIR II */
+static void record_frame(int frame, long gap, long *now)
+{
+	unsigned short values[CMDIR_MAX_VALUES];
+	lirc_t samples[1 + 2 + 2 * 32 + 1];
+	__u32 code = 0x00ff0000 | ((frame & 0xff) << 8) | (~frame & 0xff);
+	int count = 0, n = 0, i;
+	lirc_t usecs;
+	unsigned short overflows;
+
+	samples[count++] = gap;
+	samples[count++] = 9000 | PULSE_BIT;
+	samples[count++] = 4500;
+	for (i = 31; i >= 0; i--) {
+		samples[count++] = 560 | PULSE_BIT;
+		samples[count++] = code & ((__u32) 1 << i) ? 1690 : 560;
+	}
+	samples[count++] = 560 | PULSE_BIT;
+
+	for (i = 0; i < count; i++) {
+		usecs = samples[i] & PULSE_MASK;
+		for (overflows = 0; usecs - overflows * 0xffff / 12 > CMDIR_MAX_COUNT / 3; overflows++) ;
+		/* a packet is sent when the next value doesn't fit */
+		if (n + (overflows ? 2 : 1) > CMDIR_MAX_VALUES) {
+			add_values(*now, values, n);
+			n = 0;
+		}
+		values[n] = (usecs - overflows * 0xffff / 12) * 3;
+		if (samples[i] & PULSE_BIT)
+			values[n] |= CMDIR_PULSE_MASK;
+		if (overflows) {
+			values[n++] |= CMDIR_OVERFLOW_MASK;
+			values[n] = overflows;
+		}
+		n++;
+		*now += usecs;
+	}
+	add_values(*now, values, n);
+}
+
+static int read_recording(const char *filename)
+{
+	unsigned char data[REPLAY_MAX_PACKET];
+	char line[1024], *s, *end;
+	FILE *f;
+	long due = 0, usecs;
+	int lineno = 0, length;
+
+	f = fopen(filename, "r");
+	if (f == NULL) {
+		fprintf(stderr, "%s: could not open %s: %s\n", benchname, filename, strerror(errno));
+		return (0);
+	}
+	while (fgets(line, sizeof(line), f) != NULL) {
+		lineno++;
+		s = line + strspn(line, " \t");
+		if (*s == '#' || *s == '\n' || *s == '\0')
+			continue;
+		usecs = strtol(s, &end, 10);
+		length = 0;
+		while (end != s && length < REPLAY_MAX_PACKET) {
+			s = end;
+			data[length] = strtoul(s, &end, 16);
+			if (end != s)
+				length++;
+		}
+		s = end + strspn(end, " \t\n");
+		if (usecs < 0 || length == 0 || *s != '\0' || !add_packet(due + usecs, data, length)) {
+			fprintf(stderr, "%s: %s:%d: bad packet\n", benchname, filename, lineno);
+			fclose(f);
+			return (0);
+		}
+		due += usecs;
+	}
+	fclose(f);
+	return (1);
+}
+
+static int write_recording(const char *filename)
+{
+	FILE *f;
+	long due = 0;
+	int i, j;
+
+	f = fopen(filename, "w");
+	if (f == NULL) {
+		fprintf(stderr, "%s: could not open %s: %s\n", benchname, filename, strerror(errno));
+		return (0);
+	}
+	fprintf(f, "# CommandIR II packets, usecs since the previous one and the bytes\n");
+	for (i = 0; i < packet_count; i++) {
+		fprintf(f, "%ld", packets[i].due - due);
+		for (j = 0; j < packets[i].length; j++)
+			fprintf(f, " %02x", packets[i].data[j]);
+		fputc('\n', f);
+		due = packets[i].due;
+	}
+	if (fclose(f) != 0) {
+		fprintf(stderr, "%s: could not write %s: %s\n", benchname, filename, strerror(errno));
+		return (0);
+	}
+	return (1);
+}
+
+static long since(struct timespec *t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return ((t1.tv_sec - t0->tv_sec) * 1000000 + (t1.tv_nsec - t0->tv_nsec) / 1000);
+}
+
+/* reads every sample the driver gets, returns the number of errors */
+static int run_replay(struct usb_replay_stats *stats, long timeout, double *latency, long *max_latency,
+		      long *elapsed)
+{
+	lirc_t data;
+	int errors = 0, received = 0, measured = 0, i, j;
+	long usecs;
+
+	*latency = 0;
+	*max_latency = 0;
+	*elapsed = 0;
+	for (i = 0; i < packet_count; i++) {
+		for (j = 0; j < packets[i].samples; j++) {
+			data = hw.readdata(timeout);
+			if (data == 0 || data == (lirc_t) - 1) {
+				fprintf(stderr, "%s: sample %d of packet %d is missing\n", benchname, j, i);
+				return (errors + 1);
+			}
+			if (data != expected[received++])
+				errors++;
+		}
+		if (packets[i].samples == 0 || !stats->started)
+			continue;
+		usecs = since(&stats->start) - packets[i].due;
+		*latency += usecs;
+		if (usecs > *max_latency)
+			*max_latency = usecs;
+		measured++;
+	}
+	if (measured > 0)
+		*latency /= measured;
+	if (stats->started)
+		*elapsed = since(&stats->start);
+	return (errors);
+}
+
+static int get_number(const char *arg, int min)
+{
+	int n = atoi(arg);
+
+	if (n < min) {
+		fprintf(stderr, "%s: invalid number: %s\n", benchname, arg);
+		exit(EXIT_FAILURE);
+	}
+	return (n);
+}
+
+int main(int argc, char **argv)
+{
+	struct usb_replay_stats *stats;
+	struct rusage usage;
+	char *filename = NULL, *write_filename = NULL;
+	int frames = 50, errors, i;
+	long gap = NEC_GAP, now = 0, max_latency, elapsed, cpu;
+	double latency;
+
+	/* no event signals in the samples, and deinit stops the child */
+	progname = "mode2";
+	while (1) {
+		int c;
+		static struct option long_options[] = {
+			{"help", no_argument, NULL, 'h'},
+			{"version", no_argument, NULL, 'v'},
+			{"file", required_argument, NULL, 'f'},
+			{"write", required_argument, NULL, 'w'},
+			{"frames", required_argument, NULL, 'n'},
+			{"gap", required_argument, NULL, 'g'},
+			{"delay", required_argument, NULL, 'd'},
+			{"log", no_argument, NULL, 'l'},
+			{0, 0, 0, 0}
+		};
+		c = getopt_long(argc, argv, "hvf:w:n:g:d:l", long_options, NULL);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 'h':
+			printf("Usage: %s [options]\n", benchname);
+			printf("\t -h --help\t\t\tdisplay usage summary\n");
+			printf("\t -v --version\t\t\tdisplay version\n");
+			printf("\t -f --file=recording\t\treplay these packets\n");
+			printf("\t -w --write=recording\t\tsave the NEC frames and exit\n");
+			printf("\t -n --frames=n\t\t\tnumber of NEC frames [50]\n");
+			printf("\t -g --gap=usecs\t\t\tspace before every frame [%d]\n", NEC_GAP);
+			printf("\t -d --delay=usecs\t\tpoll the device this often [%d]\n", read_delay);
+			printf("\t -l --log\t\t\tshow the driver's messages\n");
+			return (EXIT_SUCCESS);
+		case 'v':
+			printf("%s %s\n", benchname, VERSION);
+			return (EXIT_SUCCESS);
+		case 'f':
+			filename = optarg;
+			break;
+		case 'w':
+			write_filename = optarg;
+			break;
+		case 'n':
+			frames = get_number(optarg, 1);
+			break;
+		case 'g':
+			gap = get_number(optarg, 1);
+			break;
+		case 'd':
+			read_delay = get_number(optarg, 1);
+			break;
+		case 'l':
+			log_driver = 1;
+			break;
+		default:
+			printf("Usage: %s [options]\n", benchname);
+			return (EXIT_FAILURE);
+		}
+	}
+	if (optind < argc) {
+		fprintf(stderr, "%s: too many arguments\n", benchname);
+		return (EXIT_FAILURE);
+	}
+
+	stats = usb_replay_init();
+	if (stats == NULL) {
+		fprintf(stderr, "%s: could not map the counters: %s\n", benchname, strerror(errno));
+		return (EXIT_FAILURE);
+	}
+	if (filename != NULL) {
+		if (!read_recording(filename))
+			return (EXIT_FAILURE);
+	} else {
+		/* give the driver time to find the device */
+		now = 100000;
+		for (i = 0; i < frames; i++)
+			record_frame(i, gap, &now);
+	}
+	if (write_filename != NULL)
+		return (write_recording(write_filename) ? EXIT_SUCCESS : EXIT_FAILURE);
+	if (sample_count == 0) {
+		fprintf(stderr, "%s: no samples to replay\n", benchname);
+		return (EXIT_FAILURE);
+	}
+	printf("replay packets=%d samples=%d read_delay=%d\n", packet_count, sample_count, read_delay);
+
+	hw = hw_commandir;
+	if (!hw.init_func()) {
+		fprintf(stderr, "%s: could not start the driver\n", benchname);
+		return (EXIT_FAILURE);
+	}
+	errors = run_replay(stats, 1000000 + 2 * (gap > read_delay ? gap : read_delay), &latency, &max_latency,
+			    &elapsed);
+	hw.deinit_func();
+
+	getrusage(RUSAGE_CHILDREN, &usage);
+	cpu = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec +
+	    usage.ru_stime.tv_usec;
+	printf("latency avg_usecs=%.0f max_usecs=%ld\n", latency, max_latency);
+	printf("child secs=%.2f cpu_usecs=%ld cpu_percent=%.2f reads=%lu reads_per_sec=%.0f\n", elapsed / 1e6, cpu,
+	       elapsed > 0 ? 100.0 * cpu / elapsed : 0, stats->reads,
+	       elapsed > 0 ? stats->reads / (elapsed / 1e6) : 0);
+	printf("check samples=%d errors=%d\n", sample_count, errors);
+	return (errors ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,584 @@
+/*
+
+  irdecbench - measure how fast lircd's decoder finds the remote of a signal
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+*/
+
+/*
+  All config files given are read as one, like lircd reads a config
+  file that includes the others, e.g. irdecbench remotes/ * /lircd.conf*
+  Every code of every remote is turned into pulses and spaces as
+  lircd would send it and fed through a mode2 driver that reads from
+  memory into decode_all(), once with the lead table, once without it,
+  as if read_config() had not made one, and once more without it and
+  with every remote on the generic bit decoder.
+
+  The results go to stdout, one line per measurement, as a keyword
+  followed by name=value pairs. Times are in nanoseconds per decoded
+  signal.
+
+  --perturb adds variants of every signal with random timing errors.
+  They are within the remote's eps for every other variant and up to
+  15 percent more for the rest, to get near the edges of what a remote
+  accepts. --preload reads the whole signal into the
+  receive buffer before it is decoded, as if a remote had been tried
+  before. On Linux the instructions and cache misses per signal are
+  counted as well, if the kernel lets us.
+
+  --check compares the results of the passes: the message and where
+  the decode left the receive buffer. It also decodes every signal with
+  every remote that has a bit decoder of its own, once with that
+  decoder and once with the generic one, and compares everything
+  receive_decode() returns, the receive buffer and the best fit value.
+  irdecbench exits with an error if anything differs.
+*/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <syslog.h>
+#include <time.h>
+#include <sys/time.h>
+
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#define HAVE_PERF_COUNTERS
+#endif
+
+#include "drivers/lirc.h"
+#include "daemons/lircd.h"
+#include "daemons/ir_remote.h"
+#include "daemons/config_file.h"
+#include "daemons/receive.h"
+#include "daemons/transmit.h"
+
+#define SYNC_SPACE 200000	/* before and after every signal */
+#define PERTURB_EPS 15		/* more than eps, in percent */
+
+struct frame {
+	struct ir_remote *remote;
+	struct ir_ncode *ncode;
+	int variant;		/* 0: exact timing */
+	int start, length;	/* in samples */
+};
+
+struct result {
+	char message[PACKET_SIZE + 1];
+	int rptr, wptr;
+};
+
+/* of receive_decode() with a single remote */
+struct decoding {
+	int ok;
+	ir_code pre, code, post;
+	int repeat;
+	lirc_t min_gap, max_gap, sum;
+	int rptr, fit;
+};
+
+struct pass {
+	const char *name;
+	struct ir_remote *remotes;
+	struct result *results;
+	unsigned long decoded;
+	double nsecs;
+	unsigned long long instructions, cache_misses;
+	int counter[2];		/* instructions, cache misses */
+};
+
+extern struct ir_remote *last_remote;
+extern struct rbuf rec_buffer;
+extern lirc_t get_next_rec_buffer(lirc_t maxusec);
+
+int debug = 0;
+FILE *lf = NULL;
+char *hostname = "";
+int daemonized = 0;
+char *progname;
+
+static lirc_t *samples;
+static int sample_count, sample_size;
+static struct frame *frames;
+static int frame_count, frame_size;
+
+static lirc_t *stream;
+static int stream_length, stream_pos;
+static int quiet, unsendable;
+static int perturb, preload;
+static unsigned long seed = 1;
+
+static lirc_t bench_readdata(lirc_t timeout)
+{
+	return (stream_pos < stream_length ? stream[stream_pos++] : 0);
+}
+
+struct hardware hw = {
+	"",			/* default device */
+	-1,			/* fd */
+	LIRC_CAN_REC_MODE2,	/* features */
+	0,			/* send_mode */
+	LIRC_MODE_MODE2,	/* rec_mode */
+	0,			/* code_length */
+	NULL,			/* init_func */
+	NULL,			/* deinit_func */
+	NULL,			/* send_func */
+	NULL,			/* rec_func */
+	receive_decode,		/* decode_func */
+	NULL,			/* ioctl_func */
+	bench_readdata,		/* readdata */
+	"irdecbench"
+};
+
+void logprintf(int prio, const char *format_str, ...)
+{
+	va_list ap;
+
+	if (prio > LOG_WARNING || quiet)
+		return;
+	fprintf(stderr, "%s: ", progname);
+	va_start(ap, format_str);
+	if (prio == LOG_WARNING)
+		fprintf(stderr, "WARNING: ");
+	vfprintf(stderr, format_str, ap);
+	fputc('\n', stderr);
+	va_end(ap);
+}
+
+void logperror(int prio, const char *s)
+{
+	if (s != NULL)
+		logprintf(prio, "%s: %s", s, strerror(errno));
+	else
+		logprintf(prio, "%s", strerror(errno));
+}
+
+static void *grow(void *ptr, int *size, int need, size_t item)
+{
+	int new_size = *size;
+
+	if (need <= *size)
+		return (ptr);
+	while (new_size < need)
+		new_size = new_size ? 2 * new_size : 1024;
+	ptr = realloc(ptr, new_size * item);
+	if (ptr == NULL) {
+		fprintf(stderr, "%s: out of memory\n", progname);
+		exit(EXIT_FAILURE);
+	}
+	*size = new_size;
+	return (ptr);
+}
+
+static void add_sample(lirc_t data)
+{
+	samples = grow(samples, &sample_size, sample_count + 1, sizeof(*samples));
+	samples[sample_count++] = data;
+}
+
+/* the config files as one */
+static struct ir_remote *read_configs(int count, char **names)
+{
+	struct ir_remote *remotes;
+	FILE *all, *f;
+	char buffer[4096];
+	size_t n;
+	int i;
+
+	all = tmpfile();
+	if (all == NULL) {
+		perror(progname);
+		return (NULL);
+	}
+	for (i = 0; i < count; i++) {
+		f = fopen(names[i], "r");
+		if (f == NULL) {
+			fprintf(stderr, "%s: could not open %s\n", progname, names[i]);
+			fclose(all);
+			return (NULL);
+		}
+		while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+			fwrite(buffer, 1, n, all);
+		fclose(f);
+		fputc('\n', all);
+	}
+	rewind(all);
+	remotes = read_config(all, names[0]);
+	fclose(all);
+	if (remotes == (void *)-1)
+		remotes = NULL;
+	return (remotes);
+}
+
+/* the same numbers on every system */
+static int random_percent(int max)
+{
+	seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+	return ((seed >> 16) % (2 * max + 1) - max);
+}
+
+static void make_frames(struct ir_remote *remotes)
+{
+	struct ir_remote *remote;
+	struct ir_ncode *ncode;
+	struct frame *frame;
+	lirc_t data;
+	int i, variant;
+
+	/* not every config can be used to transmit, don't complain */
+	quiet = 1;
+	for (remote = remotes; remote != NULL; remote = remote->next) {
+		for (ncode = remote->codes; ncode != NULL && ncode->name != NULL; ncode++) {
+			if (ncode->next != NULL || !init_send(remote, ncode)) {
+				unsendable++;
+				continue;
+			}
+			for (variant = 0; variant <= perturb; variant++) {
+				frames = grow(frames, &frame_size, frame_count + 1, sizeof(*frames));
+				frame = &frames[frame_count++];
+				frame->remote = remote;
+				frame->ncode = ncode;
+				frame->variant = variant;
+				frame->start = sample_count;
+				add_sample(SYNC_SPACE);
+				for (i = 0; i < send_buffer.wptr; i++) {
+					data = send_buffer.data[i];
+					if (variant > 0)
+						data += data * random_percent(variant % 2 ? remote->eps :
+									      remote->eps + PERTURB_EPS) / 100;
+					if (data < 1)
+						data = 1;
+					add_sample(i & 1 ? data : data | PULSE_BIT);
+				}
+				if (send_buffer.wptr & 1)
+					add_sample(SYNC_SPACE);
+				frame->length = sample_count - frame->start;
+			}
+		}
+	}
+	quiet = 0;
+}
+
+static int start_frame(struct frame *frame)
+{
+	stream = samples + frame->start;
+	stream_length = frame->length;
+	stream_pos = 0;
+	init_rec_buffer();
+	last_remote = NULL;
+	if (!clear_rec_buffer())
+		return (0);
+	if (preload) {
+		while (get_next_rec_buffer(SYNC_SPACE) != 0)
+			;
+		rewind_rec_buffer();
+	}
+	return (1);
+}
+
+static char *decode_frame(struct ir_remote *remotes, struct frame *frame)
+{
+	if (!start_frame(frame))
+		return (NULL);
+	return (decode_all(remotes));
+}
+
+static void decode_remote(struct ir_remote *remote, struct frame *frame, struct decoding *d)
+{
+	memset(d, 0, sizeof(*d));
+	if (!start_frame(frame))
+		return;
+	decode_fit = -1;
+	d->ok = receive_decode(remote, &d->pre, &d->code, &d->post, &d->repeat, &d->min_gap, &d->max_gap);
+	if (!d->ok) {
+		/* the outputs are undefined then */
+		d->pre = d->code = d->post = 0;
+		d->repeat = d->min_gap = d->max_gap = 0;
+	}
+	d->sum = rec_buffer.sum;
+	d->rptr = rec_buffer.rptr;
+	d->fit = decode_fit;
+}
+
+#ifdef HAVE_PERF_COUNTERS
+static int open_counter(__u64 config)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return (syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+static unsigned long long read_counter(int fd)
+{
+	unsigned long long value;
+
+	if (fd == -1 || read(fd, &value, sizeof(value)) != sizeof(value))
+		return (0);
+	return (value);
+}
+#endif
+
+static void open_counters(struct pass *pass)
+{
+	pass->counter[0] = pass->counter[1] = -1;
+#ifdef HAVE_PERF_COUNTERS
+	pass->counter[0] = open_counter(PERF_COUNT_HW_INSTRUCTIONS);
+	pass->counter[1] = open_counter(PERF_COUNT_HW_CACHE_MISSES);
+	if (pass->counter[0] == -1 || pass->counter[1] == -1)
+		fprintf(stderr, "%s: can't count %s: %s\n", progname,
+			pass->counter[0] == -1 ? "instructions" : "cache misses", strerror(errno));
+#endif
+}
+
+static void enable_counters(struct pass *pass, int enable)
+{
+#ifdef HAVE_PERF_COUNTERS
+	int i;
+
+	for (i = 0; i < 2; i++)
+		if (pass->counter[i] != -1)
+			ioctl(pass->counter[i], enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+#endif
+}
+
+static void close_counters(struct pass *pass)
+{
+#ifdef HAVE_PERF_COUNTERS
+	pass->instructions = read_counter(pass->counter[0]);
+	pass->cache_misses = read_counter(pass->counter[1]);
+	if (pass->counter[0] != -1)
+		close(pass->counter[0]);
+	if (pass->counter[1] != -1)
+		close(pass->counter[1]);
+#endif
+}
+
+/* decodes every signal once, the results of the first run are kept */
+static void run_pass(struct pass *pass, int first)
+{
+	struct timespec t0, t1;
+	char *message;
+	int i;
+
+	enable_counters(pass, 1);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < frame_count; i++) {
+		message = decode_frame(pass->remotes, &frames[i]);
+		if (!first)
+			continue;
+		if (message != NULL) {
+			pass->decoded++;
+			strcpy(pass->results[i].message, message);
+		}
+		pass->results[i].rptr = rec_buffer.rptr;
+		pass->results[i].wptr = rec_buffer.wptr;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	enable_counters(pass, 0);
+	pass->nsecs += (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+}
+
+static void print_pass(struct pass *pass, int iterations)
+{
+	double signals = (double)frame_count * iterations;
+
+	printf("decode name=%s signals=%d decoded=%lu nsecs=%.0f", pass->name, frame_count, pass->decoded,
+	       pass->nsecs / signals);
+	if (pass->instructions)
+		printf(" instructions=%.0f", pass->instructions / signals);
+	if (pass->cache_misses)
+		printf(" cache_misses=%.2f", pass->cache_misses / signals);
+	printf("\n");
+}
+
+/* the bit decoders of the config against the generic one */
+static int check_decoders(struct ir_remote *remotes)
+{
+	struct ir_remote *remote;
+	struct decoding fast, generic;
+	unsigned long decodes = 0;
+	int differences = 0, bit_decoder, i;
+
+	decode_best_fit = 1;
+	for (i = 0; i < frame_count; i++) {
+		for (remote = remotes; remote != NULL; remote = remote->next) {
+			bit_decoder = remote->bit_decoder;
+			if (bit_decoder == BIT_DECODER_GENERIC)
+				continue;
+			decode_remote(remote, &frames[i], &fast);
+			remote->bit_decoder = BIT_DECODER_GENERIC;
+			decode_remote(remote, &frames[i], &generic);
+			remote->bit_decoder = bit_decoder;
+			decodes++;
+			if (memcmp(&fast, &generic, sizeof(fast)) == 0)
+				continue;
+			if (differences++ < 10)
+				printf("difference remote=%s button=%s variant=%d decoder=%s ok=%d/%d code=%llx/%llx rptr=%d/%d sum=%lu/%lu fit=%d/%d\n",
+				       frames[i].remote->name, frames[i].ncode->name, frames[i].variant, remote->name,
+				       fast.ok, generic.ok, (unsigned long long)fast.code, (unsigned long long)generic.code,
+				       fast.rptr, generic.rptr, (unsigned long)fast.sum, (unsigned long)generic.sum,
+				       fast.fit, generic.fit);
+		}
+	}
+	decode_best_fit = 0;
+	printf("check name=decoders decodes=%lu differences=%d\n", decodes, differences);
+	return (differences);
+}
+
+int main(int argc, char **argv)
+{
+	struct pass passes[3];
+	struct ir_remote *remote;
+	int check = 0, iterations = 10, differences = 0, count, i, j;
+
+	progname = "irdecbench";
+	while (1) {
+		int c;
+		static struct option long_options[] = {
+			{"help", no_argument, NULL, 'h'},
+			{"version", no_argument, NULL, 'v'},
+			{"check", no_argument, NULL, 'c'},
+			{"iterations", required_argument, NULL, 'i'},
+			{"perturb", required_argument, NULL, 'p'},
+			{"preload", no_argument, NULL, 'l'},
+			{0, 0, 0, 0}
+		};
+		c = getopt_long(argc, argv, "hvci:p:l", long_options, NULL);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 'h':
+			printf("Usage: %s [options] config...\n", progname);
+			printf("\t -h --help\t\t\tdisplay usage summary\n");
+			printf("\t -v --version\t\t\tdisplay version\n");
+			printf("\t -c --check\t\t\tcompare the results of the passes and\n");
+			printf("\t\t\t\t\tof the bit decoders\n");
+			printf("\t -i --iterations=n\t\tdecode every signal this often [10]\n");
+			printf("\t -p --perturb=n\t\tadd n variants of every signal with\n");
+			printf("\t\t\t\t\ttiming errors [0]\n");
+			printf("\t -l --preload\t\t\tread the whole signal before decoding\n");
+			return (EXIT_SUCCESS);
+		case 'v':
+			printf("%s %s\n", progname, VERSION);
+			return (EXIT_SUCCESS);
+		case 'c':
+			check = 1;
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			if (iterations < 1) {
+				fprintf(stderr, "%s: invalid number of iterations: %s\n", progname, optarg);
+				return (EXIT_FAILURE);
+			}
+			break;
+		case 'p':
+			perturb = atoi(optarg);
+			if (perturb < 0) {
+				fprintf(stderr, "%s: invalid number of variants: %s\n", progname, optarg);
+				return (EXIT_FAILURE);
+			}
+			break;
+		case 'l':
+			preload = 1;
+			break;
+		default:
+			printf("Usage: %s [options] config...\n", progname);
+			return (EXIT_FAILURE);
+		}
+	}
+	if (optind == argc) {
+		fprintf(stderr, "%s: no config file given\n", progname);
+		return (EXIT_FAILURE);
+	}
+
+	/* each pass gets a config of its own, decoding changes the
+	   state of the remotes */
+	memset(passes, 0, sizeof(passes));
+	passes[0].name = "lead";
+	passes[1].name = "scan";
+	passes[2].name = "generic";
+	for (i = 0; i < 3; i++) {
+		passes[i].remotes = read_configs(argc - optind, argv + optind);
+		if (passes[i].remotes == NULL) {
+			fprintf(stderr, "%s: no remotes read\n", progname);
+			return (EXIT_FAILURE);
+		}
+	}
+	passes[1].remotes->lead_table = NULL;
+	passes[2].remotes->lead_table = NULL;
+	for (remote = passes[2].remotes; remote != NULL; remote = remote->next)
+		remote->bit_decoder = BIT_DECODER_GENERIC;
+
+	init_send_buffer();
+	make_frames(passes[0].remotes);
+	for (i = 0; i < 3; i++) {
+		passes[i].results = calloc(frame_count > 0 ? frame_count : 1, sizeof(struct result));
+		if (passes[i].results == NULL) {
+			fprintf(stderr, "%s: out of memory\n", progname);
+			return (EXIT_FAILURE);
+		}
+	}
+	for (remote = passes[0].remotes, count = 0; remote != NULL; remote = remote->next)
+		count++;
+	printf("config remotes=%d signals=%d unsendable=%d samples=%d\n", count, frame_count, unsendable, sample_count);
+
+	/* in turns, so that a slow phase of the machine hits all passes */
+	for (i = 0; i < 3; i++)
+		open_counters(&passes[i]);
+	for (j = 0; j < iterations; j++)
+		for (i = 0; i < 3; i++)
+			run_pass(&passes[i], j == 0);
+	for (i = 0; i < 3; i++) {
+		close_counters(&passes[i]);
+		print_pass(&passes[i], iterations);
+	}
+
+	if (!check)
+		return (EXIT_SUCCESS);
+	for (i = 0; i < frame_count; i++) {
+		for (j = 1; j < 3; j++) {
+			struct result *a = &passes[0].results[i], *b = &passes[j].results[i];
+
+			if (strcmp(a->message, b->message) == 0 && a->rptr == b->rptr && a->wptr == b->wptr)
+				continue;
+			if (differences++ < 10)
+				printf("difference remote=%s button=%s variant=%d %s=\"%.*s\" %s=\"%.*s\"\n",
+				       frames[i].remote->name, frames[i].ncode->name, frames[i].variant, passes[0].name,
+				       (int)strcspn(a->message, "\n"), a->message, passes[j].name,
+				       (int)strcspn(b->message, "\n"), b->message);
+		}
+	}
+	printf("check name=passes signals=%d differences=%d\n", frame_count, differences);
+	differences += check_decoders(passes[0].remotes);
+	return (differences ? EXIT_FAILURE : EXIT_SUCCESS);
+}
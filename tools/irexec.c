@@ -89,6 +89,8 @@ int main(int argc, char *argv[])
 				exit(EXIT_FAILURE);
 			}
 		}
+		/* older lircds send everything */
+		(void)lirc_subscribe(config);
 		while (lirc_nextcode(&code) == 0) {
 			if (code == NULL)
 				continue;
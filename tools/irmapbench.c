@@ -0,0 +1,208 @@
+/*
+
+  irmapbench - measure how fast a button name is found in the uinput
+  namespace
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+*/
+
+/*
+  Looks up every name of input_map.inc as it is, in lower case and
+  with a suffix that makes it unknown, once with get_input_code() of
+  lircd and once with a linear scan of the table, the way lircd did
+  it before the table was sorted.
+
+  The results go to stdout, one line per measurement, as a keyword
+  followed by name=value pairs. Times are in nanoseconds per lookup.
+  irmapbench exits with an error if both lookups don't agree on every
+  name.
+*/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "daemons/input_map.h"
+
+#define UNKNOWN_SUFFIX "_NONE"
+
+static struct {
+	char *name;
+	linux_input_code code;
+} table[] = {
+#include "input_map.inc"
+	{
+	NULL, 0}
+};
+
+struct lookup {
+	const char *name;
+	int (*func) (const char *name, linux_input_code * code);
+	int found;
+	double nsecs;
+};
+
+static char *progname;
+static char **names;
+static int name_count;
+
+static int linear_input_code(const char *name, linux_input_code * code)
+{
+	int i;
+
+	for (i = 0; table[i].name != NULL; i++) {
+		if (strcasecmp(name, table[i].name) == 0) {
+			*code = table[i].code;
+			return i;
+		}
+	}
+	return -1;
+}
+
+static char *make_name(const char *name, int lower, const char *suffix)
+{
+	char *s;
+	int i;
+
+	s = malloc(strlen(name) + strlen(suffix) + 1);
+	if (s == NULL) {
+		fprintf(stderr, "%s: out of memory\n", progname);
+		exit(EXIT_FAILURE);
+	}
+	strcpy(s, name);
+	strcat(s, suffix);
+	for (i = 0; lower && s[i] != '\0'; i++)
+		s[i] = tolower(s[i]);
+	return (s);
+}
+
+static void make_names(void)
+{
+	int count, i;
+
+	for (count = 0; table[count].name != NULL; count++) ;
+	names = malloc(3 * (count > 0 ? count : 1) * sizeof(*names));
+	if (names == NULL) {
+		fprintf(stderr, "%s: out of memory\n", progname);
+		exit(EXIT_FAILURE);
+	}
+	for (i = 0; i < count; i++) {
+		names[name_count++] = make_name(table[i].name, 0, "");
+		names[name_count++] = make_name(table[i].name, 1, "");
+		names[name_count++] = make_name(table[i].name, 0, UNKNOWN_SUFFIX);
+	}
+}
+
+static void run_lookup(struct lookup *lookup, int iterations)
+{
+	struct timespec t0, t1;
+	linux_input_code code;
+	int i, j;
+
+	lookup->found = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (j = 0; j < iterations; j++) {
+		for (i = 0; i < name_count; i++) {
+			if (lookup->func(names[i], &code) != -1 && j == 0)
+				lookup->found++;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	lookup->nsecs = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+}
+
+int main(int argc, char **argv)
+{
+	struct lookup lookups[2] = {
+		{"binary", get_input_code, 0, 0},
+		{"linear", linear_input_code, 0, 0}
+	};
+	linux_input_code code[2];
+	int iterations = 1000, differences = 0, found[2], i, j;
+
+	progname = "irmapbench";
+	while (1) {
+		int c;
+		static struct option long_options[] = {
+			{"help", no_argument, NULL, 'h'},
+			{"version", no_argument, NULL, 'v'},
+			{"iterations", required_argument, NULL, 'i'},
+			{0, 0, 0, 0}
+		};
+		c = getopt_long(argc, argv, "hvi:", long_options, NULL);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 'h':
+			printf("Usage: %s [options]\n", progname);
+			printf("\t -h --help\t\t\tdisplay usage summary\n");
+			printf("\t -v --version\t\t\tdisplay version\n");
+			printf("\t -i --iterations=n\t\tlook up every name this often [1000]\n");
+			return (EXIT_SUCCESS);
+		case 'v':
+			printf("%s %s\n", progname, VERSION);
+			return (EXIT_SUCCESS);
+		case 'i':
+			iterations = atoi(optarg);
+			if (iterations < 1) {
+				fprintf(stderr, "%s: invalid number of iterations: %s\n", progname, optarg);
+				return (EXIT_FAILURE);
+			}
+			break;
+		default:
+			printf("Usage: %s [options]\n", progname);
+			return (EXIT_FAILURE);
+		}
+	}
+	if (optind < argc) {
+		fprintf(stderr, "%s: too many arguments\n", progname);
+		return (EXIT_FAILURE);
+	}
+
+	make_names();
+	if (name_count == 0) {
+		fprintf(stderr, "%s: input_map.inc is empty\n", progname);
+		return (EXIT_FAILURE);
+	}
+	printf("table names=%d lookups=%d\n", name_count / 3, name_count);
+
+	for (i = 0; i < 2; i++) {
+		run_lookup(&lookups[i], iterations);
+		printf("lookup name=%s found=%d nsecs=%.1f\n", lookups[i].name, lookups[i].found,
+		       lookups[i].nsecs / ((double)name_count * iterations));
+	}
+
+	for (i = 0; i < name_count; i++) {
+		for (j = 0; j < 2; j++) {
+			code[j] = 0;
+			found[j] = lookups[j].func(names[i], &code[j]) != -1;
+		}
+		if (found[0] == found[1] && code[0] == code[1])
+			continue;
+		if (differences++ < 10)
+			printf("difference name=%s %s=%d/%d %s=%d/%d\n", names[i], lookups[0].name, found[0],
+			       (int)code[0], lookups[1].name, found[1], (int)code[1]);
+	}
+	printf("check lookups=%d differences=%d\n", name_count, differences);
+	return (differences ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,308 @@
+/*
+
+  irpipebench - measure how fast samples get from a driver's child
+  process to lircd
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+*/
+
+/*
+  A forked child produces frames of pulses and spaces the way the USB
+  drivers do, a report of a few samples at a time, and lircd's side
+  reads them back. This is done once with a write() and a read() for
+  every sample, as the ftdi, commandir, iguanaIR and replay drivers did
+  before, and once through sample_pipe.c.
+
+  The results go to stdout, one line per measurement, as a keyword
+  followed by name=value pairs. A wakeup is a waitfordata() that found
+  data in the pipe. With --delay the child waits between frames like a
+  remote does; without it the numbers show the throughput. The samples
+  are checked on arrival, irpipebench exits with an error if one is
+  lost or out of order.
+*/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <signal.h>
+#include <syslog.h>
+#include <time.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "drivers/lirc.h"
+#include "daemons/lircd.h"
+#include "daemons/hardware.h"
+#include "daemons/sample_pipe.h"
+
+struct transport {
+	const char *name;
+	void (*produce) (int fd);
+	int (*consume) (lirc_t * data);
+	unsigned long samples, wakeups;
+	int errors;
+	double nsecs;
+};
+
+int debug = 0;
+FILE *lf = NULL;
+char *hostname = "";
+int daemonized = 0;
+char *progname;
+
+struct hardware hw;
+
+static int frames = 1000, frame_samples = 68, report_samples = 8;
+static long delay = 0;
+static unsigned long wakeups;
+
+void logprintf(int prio, const char *format_str, ...)
+{
+	va_list ap;
+
+	if (prio > LOG_WARNING)
+		return;
+	fprintf(stderr, "%s: ", progname);
+	va_start(ap, format_str);
+	if (prio == LOG_WARNING)
+		fprintf(stderr, "WARNING: ");
+	vfprintf(stderr, format_str, ap);
+	fputc('\n', stderr);
+	va_end(ap);
+}
+
+void logperror(int prio, const char *s)
+{
+	if (s != NULL)
+		logprintf(prio, "%s: %s", s, strerror(errno));
+	else
+		logprintf(prio, "%s", strerror(errno));
+}
+
+int waitfordata(long maxusec)
+{
+	fd_set fds;
+	struct timeval tv;
+	int ret;
+
+	do {
+		FD_ZERO(&fds);
+		FD_SET(hw.fd, &fds);
+		tv.tv_sec = maxusec / 1000000;
+		tv.tv_usec = maxusec % 1000000;
+		ret = select(hw.fd + 1, &fds, NULL, NULL, maxusec > 0 ? &tv : NULL);
+	}
+	while (ret == -1 && errno == EINTR);
+	if (ret <= 0)
+		return (0);
+	wakeups++;
+	return (1);
+}
+
+/* every sample tells where it belongs */
+static lirc_t make_sample(int frame, int i)
+{
+	lirc_t data = 100 + (frame * frame_samples + i) % 10000;
+
+	return (i % 2 ? data : data | PULSE_BIT);
+}
+
+static void produce_single(int fd)
+{
+	lirc_t data;
+	int frame, i;
+
+	for (frame = 0; frame < frames; frame++) {
+		for (i = 0; i < frame_samples; i++) {
+			data = make_sample(frame, i);
+			if (write(fd, &data, sizeof(data)) != sizeof(data))
+				return;
+		}
+		if (delay > 0)
+			usleep(delay);
+	}
+}
+
+static void produce_batch(int fd)
+{
+	struct sample_writer w;
+	int frame, i;
+
+	sample_writer_init(&w, fd);
+	for (frame = 0; frame < frames; frame++) {
+		for (i = 0; i < frame_samples; i++) {
+			sample_write(&w, make_sample(frame, i));
+			if ((i + 1) % report_samples == 0 && !sample_flush(&w))
+				return;
+		}
+		if (!sample_flush(&w))
+			return;
+		if (delay > 0)
+			usleep(delay);
+	}
+}
+
+/* the readdata() of the drivers before sample_pipe.c */
+static int consume_single(lirc_t * data)
+{
+	if (!waitfordata(1000000))
+		return (0);
+	return (read(hw.fd, data, sizeof(*data)) == sizeof(*data));
+}
+
+static int consume_batch(lirc_t * data)
+{
+	return (sample_read(data, 1000000) == 1);
+}
+
+static void run_transport(struct transport *t)
+{
+	struct timespec t0, t1;
+	lirc_t data;
+	pid_t child;
+	int fd[2], frame, i;
+
+	if (pipe(fd) == -1) {
+		perror(progname);
+		exit(EXIT_FAILURE);
+	}
+	hw.fd = fd[0];
+	sample_reader_init();
+	wakeups = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	child = fork();
+	if (child == -1) {
+		perror(progname);
+		exit(EXIT_FAILURE);
+	}
+	if (child == 0) {
+		close(fd[0]);
+		t->produce(fd[1]);
+		_exit(EXIT_SUCCESS);
+	}
+	close(fd[1]);
+	for (frame = 0; frame < frames; frame++) {
+		for (i = 0; i < frame_samples; i++) {
+			if (!t->consume(&data)) {
+				fprintf(stderr, "%s: %s: sample %d of frame %d is missing\n", progname, t->name, i,
+					frame);
+				t->errors++;
+				frame = frames;
+				break;
+			}
+			t->samples++;
+			if (data != make_sample(frame, i))
+				t->errors++;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	close(fd[0]);
+	kill(child, SIGTERM);
+	waitpid(child, NULL, 0);
+	t->wakeups = wakeups;
+	t->nsecs = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+}
+
+static int get_number(const char *arg, int min)
+{
+	int n = atoi(arg);
+
+	if (n < min) {
+		fprintf(stderr, "%s: invalid number: %s\n", progname, arg);
+		exit(EXIT_FAILURE);
+	}
+	return (n);
+}
+
+int main(int argc, char **argv)
+{
+	struct transport transports[2] = {
+		{"single", produce_single, consume_single, 0, 0, 0, 0},
+		{"batch", produce_batch, consume_batch, 0, 0, 0, 0}
+	};
+	int errors = 0, i;
+
+	progname = "irpipebench";
+	while (1) {
+		int c;
+		static struct option long_options[] = {
+			{"help", no_argument, NULL, 'h'},
+			{"version", no_argument, NULL, 'v'},
+			{"frames", required_argument, NULL, 'f'},
+			{"samples", required_argument, NULL, 's'},
+			{"report", required_argument, NULL, 'r'},
+			{"delay", required_argument, NULL, 'd'},
+			{0, 0, 0, 0}
+		};
+		c = getopt_long(argc, argv, "hvf:s:r:d:", long_options, NULL);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 'h':
+			printf("Usage: %s [options]\n", progname);
+			printf("\t -h --help\t\t\tdisplay usage summary\n");
+			printf("\t -v --version\t\t\tdisplay version\n");
+			printf("\t -f --frames=n\t\t\tnumber of frames [1000]\n");
+			printf("\t -s --samples=n\t\t\tsamples per frame [68]\n");
+			printf("\t -r --report=n\t\t\tsamples per USB report [8]\n");
+			printf("\t -d --delay=usecs\t\tpause between frames [0]\n");
+			return (EXIT_SUCCESS);
+		case 'v':
+			printf("%s %s\n", progname, VERSION);
+			return (EXIT_SUCCESS);
+		case 'f':
+			frames = get_number(optarg, 1);
+			break;
+		case 's':
+			frame_samples = get_number(optarg, 1);
+			break;
+		case 'r':
+			report_samples = get_number(optarg, 1);
+			break;
+		case 'd':
+			delay = get_number(optarg, 0);
+			break;
+		default:
+			printf("Usage: %s [options]\n", progname);
+			return (EXIT_FAILURE);
+		}
+	}
+	if (optind < argc) {
+		fprintf(stderr, "%s: too many arguments\n", progname);
+		return (EXIT_FAILURE);
+	}
+
+	for (i = 0; i < 2; i++) {
+		struct transport *t = &transports[i];
+
+		run_transport(t);
+		printf("transport name=%s frames=%d samples=%lu samples_per_sec=%.0f wakeups_per_frame=%.2f errors=%d\n",
+		       t->name, frames, t->samples, t->samples / (t->nsecs / 1e9), (double)t->wakeups / frames,
+		       t->errors);
+		errors += t->errors;
+	}
+	return (errors ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -297,7 +297,7 @@ int main(int argc, char **argv)
 			return (EXIT_FAILURE);
 		}
 	}
-	if (optind + 2 > argc) {
+	if (optind + 2 > argc && (optind == argc || strcasecmp(argv[optind], "decode_stats") != 0)) {
 		fprintf(stderr, "%s: not enough arguments\n", progname);
 		return (EXIT_FAILURE);
 	}
@@ -377,7 +377,16 @@ int main(int argc, char **argv)
 			exit(EXIT_FAILURE);
 		}
 	}
-	if (strcasecmp(directive, "simulate") == 0) {
+	if (strcasecmp(directive, "decode_stats") == 0) {
+		if (optind != argc) {
+			fprintf(stderr, "%s: invalid argument count\n", progname);
+			exit(EXIT_FAILURE);
+		}
+		sprintf(buffer, "%s\n", directive);
+		if (send_packet(fd, buffer) == -1) {
+			exit(EXIT_FAILURE);
+		}
+	} else if (strcasecmp(directive, "simulate") == 0) {
 		code = argv[optind++];
 		if (optind != argc) {
 			fprintf(stderr, "%s: invalid argument count\n", progname);
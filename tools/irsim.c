@@ -0,0 +1,589 @@
+/*
+
+  irsim - emulate a serial IR transceiver on a pseudo terminal
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+*/
+
+/*
+  irsim prints the name of the pseudo terminal it opened and then
+  answers the commands of the driver like the device would, while it
+  receives the same NEC signal at a fixed rate. The bytes of a signal
+  go out when the device would send them, so a command can come in
+  while a signal is on its way; the device then drops the rest of the
+  signal. When the time is up irsim prints what went over the line,
+  one line per kind as a keyword followed by name=value pairs.
+
+  Emulated devices:
+
+  uirt2   USB-UIRT/UIRT2 in raw mode, for the uirt2_raw driver. The
+          answers to transmissions come on the line that carries the
+          received signals, which makes it a test for lircd receiving
+          and transmitting at the same time:
+
+            irsim -r 5 -t 20          (prints: device /dev/pts/N)
+            lircd --threads -H uirt2_raw -d /dev/pts/N \
+                  remotes/leadtek/lircd.conf.RM-0010
+            irw > events &
+            irbench -r 3 -t 15 "SEND_ONCE RM-0010 KEY_POWER"
+
+          irbench must not count errors, and irw must show the signals
+          irsim sent minus the interrupted ones and those the driver
+          flushed away before a command. When the driver takes the
+          answer for received data or the other way round, irbench
+          counts errors and irsim counts answers that were taken
+          apart as errors too.
+
+  tira    Tira-2 in six bytes or timing mode, for the tira and tira_raw
+          drivers. It sends the answer to IP in two parts, as a test
+          for the driver waiting for replies:
+
+            irsim -T tira -r 2    (prints: device /dev/pts/N)
+            lircd -n -H tira -d /dev/pts/N lircd.conf
+            irw
+
+          In six bytes mode the code is reported as its low 48 bits.
+
+  The timings are in microseconds, the default code is KEY_POWER of
+  the Leadtek RM-0010.
+*/
+
+/* posix_openpt() and ptsname() */
+#define _GNU_SOURCE
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/time.h>
+
+#define BUFFER_SIZE 1024
+
+/* NEC, as the Leadtek RM-0010 sends it */
+#define NEC_HEADER_PULSE 9000
+#define NEC_HEADER_SPACE 4500
+#define NEC_BIT_PULSE 563
+#define NEC_ZERO_SPACE 562
+#define NEC_ONE_SPACE 1687
+#define NEC_BITS 32
+#define NEC_GAP 40000		/* at least this much before a signal */
+
+#define UIRT2_UNIT 50
+#define UIRT2_TIMEOUT 10000	/* silence that ends a signal */
+#define UIRT2_VERSION 0x0904	/* older than the DTR handling */
+#define UIRT2_SETMODEUIR 0x20
+#define UIRT2_SETMODERAW 0x21
+#define UIRT2_SETMODESTRUC 0x22
+#define UIRT2_GETVERSION 0x23
+#define UIRT2_DOTXRAW 0x36
+#define UIRT2_DOTXSTRUCT 0x37
+#define UIRT2_STRUCT1_SIZE 27	/* command byte, remstruct1_data_t */
+#define UIRT2_TRANSMITTING 0x20
+#define UIRT2_CMDOK 0x21
+#define UIRT2_CSERROR 0x80
+#define UIRT2_CMDERROR 0x82
+
+#define TIRA_UNIT 8
+#define TIRA_TIMEOUT 10000	/* silence that ends a signal */
+#define TIRA_BYTE_TIME 1000	/* between the six bytes of a code */
+#define TIRA_PAUSE 20000	/* within the answer to IP */
+
+char *progname;
+
+struct device {
+	const char *name;
+	/* returns the bytes of buf it used, 0 if it needs more */
+	int (*command) (const unsigned char *buf, int len);
+	/* writes a received signal to buf and when each byte is due in
+	   usecs after the signal began to at, returns the length, 0 if
+	   the device does not report signals now */
+	int (*signal) (unsigned char *buf, unsigned int *at, unsigned long long gap);
+};
+
+static int master = -1;
+static unsigned long long code = 0xc03f00ffULL;
+
+/* the signal on its way */
+static unsigned char line[BUFFER_SIZE];
+static unsigned long long line_at[BUFFER_SIZE];
+static int line_len = 0, line_pos = 0;
+static int line_trailer = 0;	/* bytes at its end that also end it
+				   when it is interrupted */
+
+static unsigned long signals = 0, interrupted = 0;
+static unsigned long commands = 0, transmissions = 0, errors = 0;
+
+static int uirt2_raw_mode = 0;
+static int tira_mode = 0;	/* 'R': six bytes, 'C': timing */
+
+static unsigned long long now_usec(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+	{
+		struct timeval tv;
+
+		gettimeofday(&tv, NULL);
+		return (unsigned long long)tv.tv_sec * 1000000 + tv.tv_usec;
+	}
+}
+
+static void reply(const unsigned char *buf, int len)
+{
+	while (len > 0) {
+		ssize_t n = write(master, buf, len);
+
+		if (n == -1) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			perror(progname);
+			exit(EXIT_FAILURE);
+		}
+		buf += n;
+		len -= n;
+	}
+}
+
+/* the pulses and spaces of the code, returns their number */
+static int nec_signal(unsigned int *duration)
+{
+	int i, n = 0;
+
+	duration[n++] = NEC_HEADER_PULSE;
+	duration[n++] = NEC_HEADER_SPACE;
+	for (i = NEC_BITS - 1; i >= 0; i--) {
+		duration[n++] = NEC_BIT_PULSE;
+		duration[n++] = (code >> i) & 1 ? NEC_ONE_SPACE : NEC_ZERO_SPACE;
+	}
+	duration[n++] = NEC_BIT_PULSE;
+	return (n);
+}
+
+static unsigned char checksum(const unsigned char *buf, int len)
+{
+	unsigned char sum = 0;
+
+	while (len-- > 0)
+		sum -= *buf++;
+	return (sum);
+}
+
+static int uirt2_command(const unsigned char *buf, int len)
+{
+	unsigned char answer[3];
+	int size;
+
+	switch (buf[0]) {
+	case UIRT2_SETMODEUIR:
+	case UIRT2_SETMODERAW:
+	case UIRT2_SETMODESTRUC:
+	case UIRT2_GETVERSION:
+		size = 2;
+		break;
+	case UIRT2_DOTXRAW:
+	case UIRT2_DOTXSTRUCT:
+		if (len < 2)
+			return (0);
+		size = buf[1] + 2;
+		break;
+	default:
+		/* frequency and repeat count of a struct1 transmission */
+		if ((buf[0] & 0x20) == 0 && (buf[0] & 0xc0) != 0x80) {
+			size = UIRT2_STRUCT1_SIZE;
+			break;
+		}
+		errors++;
+		return (1);
+	}
+	if (len < size)
+		return (0);
+
+	commands++;
+	if (checksum(buf, size) != 0) {
+		errors++;
+		answer[0] = UIRT2_CSERROR;
+		reply(answer, 1);
+		return (size);
+	}
+	switch (buf[0]) {
+	case UIRT2_GETVERSION:
+		answer[0] = UIRT2_VERSION >> 8;
+		answer[1] = UIRT2_VERSION & 0xff;
+		answer[2] = checksum(answer, 2);
+		reply(answer, 3);
+		break;
+	case UIRT2_SETMODERAW:
+	case UIRT2_SETMODEUIR:
+	case UIRT2_SETMODESTRUC:
+		uirt2_raw_mode = buf[0] == UIRT2_SETMODERAW;
+		answer[0] = UIRT2_CMDOK;
+		reply(answer, 1);
+		break;
+	default:
+		transmissions++;
+		answer[0] = UIRT2_TRANSMITTING;
+		reply(answer, 1);
+		break;
+	}
+	return (size);
+}
+
+/*
+  The gap before the signal when it begins, each pulse and space in
+  50 usec when it is over, 0xff when nothing more came in for a while.
+*/
+static int uirt2_signal(unsigned char *buf, unsigned int *at, unsigned long long gap)
+{
+	unsigned int duration[2 * NEC_BITS + 3], t = 0;
+	int i, n, len = 0;
+
+	if (!uirt2_raw_mode)
+		return (0);
+	gap /= UIRT2_UNIT;
+	if (gap > 0xffff)
+		gap = 0xffff;
+	at[len] = t;
+	buf[len++] = gap >> 8;
+	at[len] = t;
+	buf[len++] = gap & 0xff;
+	n = nec_signal(duration);
+	for (i = 0; i < n; i++) {
+		t += duration[i];
+		at[len] = t;
+		buf[len++] = (duration[i] + UIRT2_UNIT / 2) / UIRT2_UNIT;
+	}
+	at[len] = t + UIRT2_TIMEOUT;
+	buf[len++] = 0xff;
+	line_trailer = 1;
+	return (len);
+}
+
+static int tira_command(const unsigned char *buf, int len)
+{
+	static const char version[] = "Tira-2 firmware 1.2 (irsim)";
+	unsigned char answer[5];
+	int size, i;
+
+	if (buf[0] != 'I') {
+		errors++;
+		return (1);
+	}
+	if (len < 2)
+		return (0);
+	switch (buf[1]) {
+	case 'P':
+	case 'V':
+	case 'R':
+		size = 2;
+		break;
+	case 'C':
+		size = 4;
+		break;
+	case 'X':
+		/* clock word, reserved, 12 timings, then two timing
+		   indexes per byte up to the index 15 */
+		for (i = 28; i < len && (buf[i] & 0x0f) != 0x0f; i++) ;
+		if (i == len)
+			return (0);
+		size = i + 1;
+		break;
+	default:
+		errors++;
+		return (2);
+	}
+	if (len < size)
+		return (0);
+
+	commands++;
+	switch (buf[1]) {
+	case 'P':
+		/* the calibration value and the version word come a
+		   little later, Tira-2 that can transmit */
+		reply((const unsigned char *)"OIP", 3);
+		usleep(TIRA_PAUSE);
+		answer[0] = 0x05;
+		answer[1] = 0x11;
+		reply(answer, 2);
+		break;
+	case 'V':
+		reply((const unsigned char *)version, sizeof(version) - 1);
+		break;
+	case 'R':
+		tira_mode = 'R';
+		reply((const unsigned char *)"OK", 2);
+		break;
+	case 'C':
+		tira_mode = 'C';
+		reply((const unsigned char *)"OIC", 3);
+		break;
+	case 'X':
+		transmissions++;
+		reply((const unsigned char *)"OIX", 3);
+		break;
+	}
+	return (size);
+}
+
+/*
+  Six bytes mode: the low 48 bits of the code once the signal is over.
+  Timing mode: each pulse and space in 8 usec when it is over, big
+  endian, then 00 00 00 b2 when nothing more came in for a while.
+*/
+static int tira_signal(unsigned char *buf, unsigned int *at, unsigned long long gap)
+{
+	unsigned int duration[2 * NEC_BITS + 3], t = 0;
+	int i, n, len = 0;
+
+	n = nec_signal(duration);
+	switch (tira_mode) {
+	case 'R':
+		for (i = 0; i < n; i++)
+			t += duration[i];
+		for (i = 5; i >= 0; i--) {
+			at[len] = t + TIRA_BYTE_TIME * len;
+			buf[len++] = (code >> (8 * i)) & 0xff;
+		}
+		line_trailer = 0;
+		return (len);
+	case 'C':
+		for (i = 0; i < n; i++) {
+			t += duration[i];
+			at[len] = t;
+			buf[len++] = (duration[i] / TIRA_UNIT) >> 8;
+			at[len] = t;
+			buf[len++] = (duration[i] / TIRA_UNIT) & 0xff;
+		}
+		for (i = 0; i < 4; i++) {
+			at[len] = t + TIRA_TIMEOUT;
+			buf[len++] = i == 3 ? 0xb2 : 0;
+		}
+		line_trailer = 4;
+		return (len);
+	}
+	return (0);
+}
+
+static struct device devices[] = {
+	{"uirt2", uirt2_command, uirt2_signal},
+	{"tira", tira_command, tira_signal},
+	{NULL, NULL, NULL}
+};
+
+/* a command cuts the signal short */
+static void interrupt_signal(unsigned long long now)
+{
+	int i;
+
+	if (line_pos >= line_len - line_trailer)
+		return;
+	interrupted++;
+	for (i = 0; i < line_trailer; i++) {
+		line[line_pos + i] = line[line_len - line_trailer + i];
+		line_at[line_pos + i] = now;
+	}
+	line_len = line_pos + line_trailer;
+}
+
+static int parse_number(const char *s, double *value)
+{
+	char *end;
+
+	*value = strtod(s, &end);
+	return (*s && !*end && *value >= 0);
+}
+
+int main(int argc, char **argv)
+{
+	struct device *device = &devices[0];
+	double rate = 5, seconds = 10;
+	unsigned char in[BUFFER_SIZE];
+	unsigned int at[BUFFER_SIZE];
+	int slave, fill = 0, used, len, i;
+	unsigned long long start = 0, now, next = 0, end = 0, wake;
+	struct termios tio;
+	struct pollfd pfd;
+	char *name;
+
+	progname = "irsim";
+	while (1) {
+		int c;
+		static struct option long_options[] = {
+			{"help", no_argument, NULL, 'h'},
+			{"version", no_argument, NULL, 'v'},
+			{"type", required_argument, NULL, 'T'},
+			{"code", required_argument, NULL, 'c'},
+			{"rate", required_argument, NULL, 'r'},
+			{"time", required_argument, NULL, 't'},
+			{0, 0, 0, 0}
+		};
+		c = getopt_long(argc, argv, "hvT:c:r:t:", long_options, NULL);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 'h':
+			printf("Usage: %s [options]\n", progname);
+			printf("\t -h --help\t\tdisplay usage summary\n");
+			printf("\t -v --version\t\tdisplay version\n");
+			printf("\t -T --type=device\temulate this device [%s]\n", devices[0].name);
+			printf("\t -c --code=code\t\tsend this 32 bit NEC code [0x%llx]\n", code);
+			printf("\t -r --rate=n\t\tsignals per second, 0: none [5]\n");
+			printf("\t -t --time=seconds\trun this long after the first command [10]\n");
+			printf("Devices:");
+			for (device = devices; device->name != NULL; device++)
+				printf(" %s", device->name);
+			printf("\n");
+			return (EXIT_SUCCESS);
+		case 'v':
+			printf("%s %s\n", progname, VERSION);
+			return (EXIT_SUCCESS);
+		case 'T':
+			for (device = devices; device->name != NULL; device++) {
+				if (strcmp(device->name, optarg) == 0)
+					break;
+			}
+			if (device->name == NULL) {
+				fprintf(stderr, "%s: unknown device: %s\n", progname, optarg);
+				return (EXIT_FAILURE);
+			}
+			break;
+		case 'c':
+			{
+				char *end;
+
+				code = strtoull(optarg, &end, 0);
+				if (!*optarg || *end) {
+					fprintf(stderr, "%s: invalid code: %s\n", progname, optarg);
+					return (EXIT_FAILURE);
+				}
+				break;
+			}
+		case 'r':
+			if (!parse_number(optarg, &rate)) {
+				fprintf(stderr, "%s: invalid rate: %s\n", progname, optarg);
+				return (EXIT_FAILURE);
+			}
+			break;
+		case 't':
+			if (!parse_number(optarg, &seconds) || seconds == 0) {
+				fprintf(stderr, "%s: invalid time: %s\n", progname, optarg);
+				return (EXIT_FAILURE);
+			}
+			break;
+		default:
+			return (EXIT_FAILURE);
+		}
+	}
+	if (optind != argc) {
+		fprintf(stderr, "%s: too many arguments\n", progname);
+		return (EXIT_FAILURE);
+	}
+
+	master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master == -1 || grantpt(master) == -1 || unlockpt(master) == -1 || (name = ptsname(master)) == NULL) {
+		perror(progname);
+		return (EXIT_FAILURE);
+	}
+	/* kept open, so that the driver can close and reopen the device */
+	slave = open(name, O_RDWR | O_NOCTTY);
+	if (slave == -1 || tcgetattr(slave, &tio) == -1) {
+		perror(progname);
+		return (EXIT_FAILURE);
+	}
+	cfmakeraw(&tio);
+	tcsetattr(slave, TCSANOW, &tio);
+	printf("device %s\n", name);
+	fflush(stdout);
+
+	pfd.fd = master;
+	pfd.events = POLLIN;
+	while (1) {
+		long timeout = -1;
+
+		now = now_usec();
+		if (start != 0) {
+			if (now >= start + seconds * 1000000)
+				break;
+			timeout = (start + seconds * 1000000 - now) / 1000;
+			if (rate > 0 && line_pos == line_len && now >= next) {
+				line_len = device->signal(line, at, end ? now - end : NEC_GAP);
+				line_pos = 0;
+				for (i = 0; i < line_len; i++)
+					line_at[i] = now + at[i];
+				if (line_len > 0) {
+					signals++;
+					end = line_at[line_len - 1];
+				}
+				next = now + 1000000 / rate;
+				if (next < end + NEC_GAP)
+					next = end + NEC_GAP;
+			}
+			for (i = line_pos; i < line_len && line_at[i] <= now; i++) ;
+			if (i > line_pos) {
+				reply(line + line_pos, i - line_pos);
+				line_pos = i;
+			}
+			wake = line_pos < line_len ? line_at[line_pos] : next;
+			if ((line_pos < line_len || rate > 0) && wake < start + seconds * 1000000)
+				timeout = wake > now ? (wake - now + 999) / 1000 : 0;
+		}
+		if (poll(&pfd, 1, timeout) == -1) {
+			if (errno == EINTR)
+				continue;
+			perror(progname);
+			return (EXIT_FAILURE);
+		}
+		if (!(pfd.revents & POLLIN))
+			continue;
+		len = read(master, in + fill, sizeof(in) - fill);
+		if (len <= 0)
+			continue;
+		now = now_usec();
+		if (start == 0)
+			start = next = now;
+		if (fill == 0)
+			interrupt_signal(now);
+		fill += len;
+		while (fill > 0 && (used = device->command(in, fill)) > 0) {
+			memmove(in, in + used, fill - used);
+			fill -= used;
+		}
+		if (fill == sizeof(in)) {
+			/* garbage */
+			errors += fill;
+			fill = 0;
+		}
+	}
+	printf("signals sent=%lu interrupted=%lu\n", signals, interrupted);
+	printf("commands received=%lu transmissions=%lu errors=%lu\n", commands, transmissions, errors);
+	close(slave);
+	close(master);
+	return (EXIT_SUCCESS);
+}
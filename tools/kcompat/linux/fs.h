@@ -0,0 +1,25 @@
+/*
+ * fs.h - user space stand-in for building lirc_dev.h in tools/
+ */
+
+#ifndef _KCOMPAT_LINUX_FS_H
+#define _KCOMPAT_LINUX_FS_H
+
+#include <sys/types.h>
+
+#include <linux/slab.h>
+
+#define __user
+
+struct file;
+struct inode;
+struct device;
+struct module;
+struct file_operations;
+
+typedef long long kcompat_loff_t;
+#define loff_t kcompat_loff_t
+
+#define copy_to_user(to, from, n) (memcpy(to, from, n), 0)
+
+#endif
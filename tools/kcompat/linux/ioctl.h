@@ -0,0 +1,16 @@
+/*
+ * ioctl.h - user space stand-in for building lirc_dev.h in tools/
+ *
+ * drivers/lirc.h and the C library need the real one on Linux.
+ */
+
+#ifndef _KCOMPAT_LINUX_IOCTL_H
+#define _KCOMPAT_LINUX_IOCTL_H
+
+#if defined(__linux__)
+#include_next <linux/ioctl.h>
+#else
+#include <sys/ioctl.h>
+#endif
+
+#endif
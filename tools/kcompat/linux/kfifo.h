@@ -0,0 +1,119 @@
+/*
+ * kfifo.h - user space stand-in for building lirc_dev.h in tools/
+ *
+ * The parts of the kernel's byte fifo that lirc_dev.h uses, with the
+ * same semantics: the size is a power of two, in and out only grow,
+ * and one reader and one writer need no lock.
+ */
+
+#ifndef _KCOMPAT_LINUX_KFIFO_H
+#define _KCOMPAT_LINUX_KFIFO_H
+
+#include <linux/slab.h>
+
+struct kfifo {
+	unsigned char *buffer;
+	unsigned int size;
+	unsigned int in;
+	unsigned int out;
+};
+
+#define kfifo_min(a, b) ((a) < (b) ? (a) : (b))
+
+static inline int kfifo_alloc(struct kfifo *fifo, unsigned int size,
+			      int gfp_mask)
+{
+	unsigned int real_size = 2;
+
+	while (real_size < size)
+		real_size <<= 1;
+	fifo->buffer = kmalloc(real_size, gfp_mask);
+	if (!fifo->buffer)
+		return -ENOMEM;
+	fifo->size = real_size;
+	fifo->in = fifo->out = 0;
+	return 0;
+}
+
+static inline void kfifo_free(struct kfifo *fifo)
+{
+	kfree(fifo->buffer);
+	fifo->buffer = NULL;
+}
+
+static inline unsigned int kfifo_len(struct kfifo *fifo)
+{
+	return *(volatile unsigned int *)&fifo->in -
+		*(volatile unsigned int *)&fifo->out;
+}
+
+static inline unsigned int kfifo_avail(struct kfifo *fifo)
+{
+	return fifo->size - kfifo_len(fifo);
+}
+
+static inline void kfifo_reset_out(struct kfifo *fifo)
+{
+	smp_mb();
+	fifo->out = *(volatile unsigned int *)&fifo->in;
+}
+
+static inline unsigned int kfifo_in(struct kfifo *fifo, const void *from,
+				    unsigned int len)
+{
+	unsigned int off, l;
+
+	len = kfifo_min(len, kfifo_avail(fifo));
+	smp_mb();
+	off = fifo->in & (fifo->size - 1);
+	l = kfifo_min(len, fifo->size - off);
+	memcpy(fifo->buffer + off, from, l);
+	memcpy(fifo->buffer, (const unsigned char *)from + l, len - l);
+	smp_wmb();
+	fifo->in += len;
+	return len;
+}
+
+static inline unsigned int kfifo_out(struct kfifo *fifo, void *to,
+				     unsigned int len)
+{
+	unsigned int off, l;
+
+	len = kfifo_min(len, kfifo_len(fifo));
+	smp_rmb();
+	off = fifo->out & (fifo->size - 1);
+	l = kfifo_min(len, fifo->size - off);
+	memcpy(to, fifo->buffer + off, l);
+	memcpy((unsigned char *)to + l, fifo->buffer, len - l);
+	smp_mb();
+	fifo->out += len;
+	return len;
+}
+
+static inline unsigned int kfifo_in_locked(struct kfifo *fifo,
+					   const void *from, unsigned int len,
+					   spinlock_t *lock)
+{
+	unsigned long flags;
+	unsigned int ret;
+
+	spin_lock_irqsave(lock, flags);
+	ret = kfifo_in(fifo, from, len);
+	spin_unlock_irqrestore(lock, flags);
+	return ret;
+}
+
+static inline unsigned int kfifo_out_locked(struct kfifo *fifo, void *to,
+					    unsigned int len,
+					    spinlock_t *lock)
+{
+	unsigned long flags;
+	unsigned int ret;
+
+	spin_lock_irqsave(lock, flags);
+	ret = kfifo_out(fifo, to, len);
+	spin_unlock_irqrestore(lock, flags);
+	return ret;
+}
+
+#endif
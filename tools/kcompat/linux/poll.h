@@ -0,0 +1,16 @@
+/*
+ * poll.h - user space stand-in for building lirc_dev.h in tools/
+ *
+ * Nobody sleeps on a wait queue in user space.
+ */
+
+#ifndef _KCOMPAT_LINUX_POLL_H
+#define _KCOMPAT_LINUX_POLL_H
+
+typedef struct poll_table_struct poll_table;
+
+typedef int wait_queue_head_t;
+#define init_waitqueue_head(q) (*(q) = 0)
+#define wake_up_interruptible(q) do { } while (0)
+
+#endif
@@ -0,0 +1,51 @@
+/*
+ * slab.h - user space stand-in for building lirc_dev.h in tools/
+ *
+ * Memory, locks and the other basics the kernel headers would bring.
+ * A spinlock is a mutex here, there are no interrupts to disable.
+ */
+
+#ifndef _KCOMPAT_LINUX_SLAB_H
+#define _KCOMPAT_LINUX_SLAB_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <linux/version.h>
+
+#define GFP_KERNEL 0
+#define kmalloc(size, flags) malloc(size)
+#define kfree(ptr) free(ptr)
+
+typedef unsigned char u8;
+
+typedef pthread_mutex_t spinlock_t;
+#define spin_lock_init(lock) pthread_mutex_init(lock, NULL)
+#define spin_lock_irqsave(lock, flags) \
+	do { (flags) = 0; pthread_mutex_lock(lock); } while (0)
+#define spin_unlock_irqrestore(lock, flags) \
+	do { (void)(flags); pthread_mutex_unlock(lock); } while (0)
+
+#define smp_mb() __sync_synchronize()
+#define smp_rmb() __sync_synchronize()
+#define smp_wmb() __sync_synchronize()
+
+static inline int kcompat_warn(int condition, const char *format, ...)
+{
+	va_list ap;
+
+	if (condition) {
+		va_start(ap, format);
+		vfprintf(stderr, format, ap);
+		va_end(ap);
+	}
+	return condition;
+}
+
+#define WARN(condition, format...) kcompat_warn((condition) != 0, format)
+
+#endif
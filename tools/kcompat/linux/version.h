@@ -0,0 +1,13 @@
+/*
+ * version.h - user space stand-in for building lirc_dev.h in tools/
+ *
+ * Pretends a kernel with the kfifo API that lirc_dev.h uses by default.
+ */
+
+#ifndef _KCOMPAT_LINUX_VERSION_H
+#define _KCOMPAT_LINUX_VERSION_H
+
+#define KERNEL_VERSION(a, b, c) (((a) << 16) + ((b) << 8) + (c))
+#define LINUX_VERSION_CODE KERNEL_VERSION(2, 6, 36)
+
+#endif
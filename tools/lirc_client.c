@@ -28,6 +28,15 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
 
 #include "lirc_client.h"
 
@@ -46,6 +55,12 @@ struct filestack_t {
 	struct filestack_t *parent;
 };
 
+struct lirc_shm {
+	struct lirc_shm_ring *ring;
+	uint32_t next;
+	unsigned long lost;
+};
+
 enum packet_state {
 	P_BEGIN,
 	P_MESSAGE,
@@ -90,6 +105,8 @@ static int lirc_iscode(struct lirc_config_entry *scan, char *remote, char *butto
 static int lirc_code2char_internal(struct lirc_config *config, char *code, char **string, char **prog);
 static const char *lirc_read_string(int fd);
 static int lirc_identify(int sockfd);
+static size_t lirc_pattern(char *buf, const char *name);
+static int lirc_subscribe_send(char *command, size_t len);
 
 static int lirc_send_command(int sockfd, const char *command, char *buf, size_t * buf_len, int *ret_status);
 
@@ -1714,3 +1731,225 @@ int lirc_identify(int sockfd)
 	(void)lirc_send_command(sockfd, command, NULL, NULL, &success);
 	return success;
 }
+
+/* name with the wildcards of lircd's SUBSCRIBE escaped, buf may be NULL */
+static size_t lirc_pattern(char *buf, const char *name)
+{
+	size_t len = 0;
+
+	if (name == LIRC_ALL) {
+		if (buf != NULL)
+			strcpy(buf, "*");
+		return (1);
+	}
+	for (; *name != 0; name++) {
+		if (strchr("*?[\\", *name) != NULL) {
+			if (buf != NULL)
+				buf[len] = '\\';
+			len++;
+		}
+		if (buf != NULL)
+			buf[len] = *name;
+		len++;
+	}
+	if (buf != NULL)
+		buf[len] = 0;
+	return (len);
+}
+
+static int lirc_subscribe_send(char *command, size_t len)
+{
+	int success;
+
+	strcpy(command + len, "\n");
+	if (lirc_send_command(lirc_lircd, command, NULL, NULL, &success) == -1)
+		return (LIRC_RET_ERROR);
+	return (success);
+}
+
+/*
+  Tells lircd to send only the buttons the config has entries for,
+  in any mode. Call it before reading the first code, the answers of
+  lircd come through the same socket. Without a subscription, e.g.
+  if lircd is too old, all events keep coming.
+*/
+int lirc_subscribe(struct lirc_config *config)
+{
+	struct lirc_config_entry *scan;
+	struct lirc_code *code;
+	char command[LIRC_PACKET_SIZE];
+	size_t len, n;
+	int sent = 0;
+
+	for (scan = config->first; scan != NULL; scan = scan->next) {
+		/* an entry without a button wants everything */
+		if (scan->code == NULL)
+			return (LIRC_RET_SUCCESS);
+		for (code = scan->code; code != NULL; code = code->next) {
+			if (code->remote == LIRC_ALL && code->button == LIRC_ALL)
+				return (LIRC_RET_SUCCESS);
+			n = sizeof("SUBSCRIBE ") + lirc_pattern(NULL, code->remote) + 1 + lirc_pattern(NULL, code->button);
+			if (n + 1 > sizeof(command) || (code->remote != LIRC_ALL && strchr(code->remote, '/') != NULL)) {
+				/* lircd could not tell it apart */
+				return (LIRC_RET_SUCCESS);
+			}
+		}
+	}
+
+	len = 0;
+	for (scan = config->first; scan != NULL; scan = scan->next) {
+		for (code = scan->code; code != NULL; code = code->next) {
+			n = 1 + lirc_pattern(NULL, code->remote) + 1 + lirc_pattern(NULL, code->button);
+			if (len > 0 && len + n + 1 >= sizeof(command)) {
+				if (lirc_subscribe_send(command, len) != LIRC_RET_SUCCESS)
+					goto lirc_subscribe_error;
+				sent = 1;
+				len = 0;
+			}
+			if (len == 0)
+				len = sprintf(command, "SUBSCRIBE");
+			command[len++] = ' ';
+			len += lirc_pattern(command + len, code->remote);
+			command[len++] = '/';
+			len += lirc_pattern(command + len, code->button);
+		}
+	}
+	if (len > 0 && lirc_subscribe_send(command, len) != LIRC_RET_SUCCESS)
+		goto lirc_subscribe_error;
+	return (LIRC_RET_SUCCESS);
+
+lirc_subscribe_error:
+	/* half a subscription would lose events */
+	if (sent) {
+		strcpy(command, "UNSUBSCRIBE");
+		(void)lirc_subscribe_send(command, strlen(command));
+	}
+	return (LIRC_RET_ERROR);
+}
+
+struct lirc_shm *lirc_shm_attach(const char *name)
+{
+	struct lirc_shm *shm;
+	struct lirc_shm_ring *ring;
+	struct stat s;
+	int fd;
+
+	if (name == NULL)
+		name = LIRC_SHM_NAME;
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd == -1) {
+		lirc_printf("%s: could not open shared memory %s\n", lirc_prog, name);
+		lirc_perror(lirc_prog);
+		return NULL;
+	}
+	if (fstat(fd, &s) == -1 || s.st_size < sizeof(*ring)) {
+		lirc_printf("%s: %s is not an lircd event ring\n", lirc_prog, name);
+		close(fd);
+		return NULL;
+	}
+	ring = mmap(NULL, sizeof(*ring), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ring == MAP_FAILED) {
+		lirc_perror(lirc_prog);
+		return NULL;
+	}
+	if (ring->magic != LIRC_SHM_MAGIC || ring->version != LIRC_SHM_VERSION || ring->slots != LIRC_SHM_SLOTS
+	    || ring->event_size != sizeof(ring->event[0])) {
+		lirc_printf("%s: incompatible lircd event ring %s\n", lirc_prog, name);
+		munmap(ring, sizeof(*ring));
+		return NULL;
+	}
+	shm = malloc(sizeof(*shm));
+	if (shm == NULL) {
+		munmap(ring, sizeof(*ring));
+		return NULL;
+	}
+	shm->ring = ring;
+	shm->next = ring->head + 1;
+	shm->lost = 0;
+	return shm;
+}
+
+void lirc_shm_detach(struct lirc_shm *shm)
+{
+	munmap(shm->ring, sizeof(*shm->ring));
+	free(shm);
+}
+
+unsigned long lirc_shm_lost(struct lirc_shm *shm)
+{
+	return shm->lost;
+}
+
+static int lirc_shm_wait(struct lirc_shm *shm, uint32_t head, long usec)
+{
+#if defined(__linux__) && defined(SYS_futex)
+	struct timespec ts;
+
+	ts.tv_sec = usec / 1000000;
+	ts.tv_nsec = (usec % 1000000) * 1000;
+	if (syscall(SYS_futex, &shm->ring->head, FUTEX_WAIT, head, usec < 0 ? NULL : &ts, NULL, 0) == -1
+	    && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT)
+		return -1;
+#else
+	/* no portable way to sleep on shared memory, poll instead */
+	usleep(usec < 0 || usec > 10000 ? 10000 : usec);
+#endif
+	return 0;
+}
+
+/*
+  Copies the next event into *event.  Returns 1 if there was one, 0
+  if none arrived within timeout milliseconds (-1 waits forever) and
+  -1 if lircd has gone away, attach again in that case.
+*/
+int lirc_shm_next(struct lirc_shm *shm, struct lirc_shm_event *event, int timeout)
+{
+	struct lirc_shm_ring *ring = shm->ring;
+	struct lirc_shm_event *slot;
+	struct timeval start, now;
+	uint32_t head, seq;
+	int32_t ahead;
+	long left;
+
+	gettimeofday(&start, NULL);
+	while (1) {
+		head = ring->head;
+		__sync_synchronize();
+		if (ring->closed)
+			return -1;
+		ahead = (int32_t) (head - shm->next);
+		if (ahead >= 0) {
+			if (ahead >= LIRC_SHM_SLOTS) {
+				/* overwritten before we got to them */
+				shm->lost += ahead - LIRC_SHM_SLOTS + 1;
+				shm->next = head - LIRC_SHM_SLOTS + 1;
+			}
+			slot = &ring->event[(shm->next - 1) & (LIRC_SHM_SLOTS - 1)];
+			seq = slot->seq;
+			__sync_synchronize();
+			memcpy(event, (const void *)slot, sizeof(*event));
+			__sync_synchronize();
+			if (seq == shm->next && slot->seq == seq) {
+				event->seq = seq;
+				shm->next++;
+				return 1;
+			}
+			/* lircd was rewriting this slot, look again */
+			continue;
+		}
+		if (timeout == 0)
+			return 0;
+		left = -1;
+		if (timeout > 0) {
+			gettimeofday(&now, NULL);
+			left = timeout * 1000L - ((now.tv_sec - start.tv_sec) * 1000000L + now.tv_usec - start.tv_usec);
+			if (left <= 0)
+				return 0;
+		}
+		if (lirc_shm_wait(shm, head, left) == -1) {
+			lirc_perror(lirc_prog);
+			return -1;
+		}
+	}
+}
@@ -21,6 +21,8 @@
 typedef uint32_t __u32;
 #endif
 
+#include "lirc_shm.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -95,6 +97,17 @@ extern "C" {
 	const char *lirc_getmode(struct lirc_config *config);
 	const char *lirc_setmode(struct lirc_config *config, const char *mode);
 
+/* only get the events a config has entries for */
+	int lirc_subscribe(struct lirc_config *config);
+
+/* shared memory event ring of lircd --shm */
+	struct lirc_shm;
+
+	struct lirc_shm *lirc_shm_attach(const char *name);
+	void lirc_shm_detach(struct lirc_shm *shm);
+	int lirc_shm_next(struct lirc_shm *shm, struct lirc_shm_event *event, int timeout);
+	unsigned long lirc_shm_lost(struct lirc_shm *shm);
+
 #ifdef __cplusplus
 }
 #endif
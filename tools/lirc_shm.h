@@ -0,0 +1,62 @@
+/****************************************************************************
+ ** lirc_shm.h **************************************************************
+ ****************************************************************************
+ *
+ * lirc_shm.h - layout of the shared memory event ring published by lircd
+ *
+ * lircd is the only writer.  Every decoded event gets the next sequence
+ * number and is stored in slot (seq - 1) % LIRC_SHM_SLOTS.  The slot's
+ * seq field is cleared while the slot is being written and set to the
+ * event's sequence number afterwards, so a reader that sees the same
+ * seq before and after copying a slot got a consistent record.  Readers
+ * that fall more than LIRC_SHM_SLOTS events behind lose the oldest
+ * events and can tell from the gap in the sequence numbers.
+ *
+ * The ring is mapped read-only by readers, use lirc_shm_attach() and
+ * lirc_shm_next() from lirc_client.
+ *
+ */
+
+#ifndef LIRC_SHM_H
+#define LIRC_SHM_H
+
+#include <stdint.h>
+
+#define LIRC_SHM_NAME "/lircd"
+#define LIRC_SHM_MAGIC 0x4c495243	/* "LIRC" */
+#define LIRC_SHM_VERSION 1
+#define LIRC_SHM_SLOTS 256		/* must be a power of two */
+#define LIRC_SHM_NAME_LEN 48
+
+/* remote_id/button_id of names not found in lircd.conf */
+#define LIRC_SHM_NO_ID 0xffffffff
+
+/* event flags */
+#define LIRC_SHM_RELEASE 0x01
+
+struct lirc_shm_event {
+	volatile uint32_t seq;
+	uint32_t generation;		/* config generation of the ids */
+	uint32_t remote_id;		/* position in lircd.conf */
+	uint32_t button_id;		/* position in the remote's codes */
+	uint32_t reps;
+	uint32_t flags;
+	uint64_t code;
+	uint64_t timestamp;		/* usec since the epoch */
+	char remote[LIRC_SHM_NAME_LEN];
+	char button[LIRC_SHM_NAME_LEN];
+};
+
+struct lirc_shm_ring {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slots;
+	uint32_t event_size;
+	volatile uint32_t head;		/* seq of the newest event, readers
+					   sleep on it with futex(2) */
+	volatile uint32_t closed;	/* lircd has shut down */
+	uint32_t reserved[2];
+	struct lirc_shm_event event[LIRC_SHM_SLOTS];
+};
+
+#endif
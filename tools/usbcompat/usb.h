@@ -0,0 +1,71 @@
+/*
+ * usb.h - user space stand-in for libusb-0.1 in tools/
+ *
+ * The types and calls hw_commandir.c uses, with the names and the
+ * meaning libusb-0.1 gives them. usbreplay.c implements the calls
+ * with one CommandIR II that replays recorded packets.
+ */
+
+#ifndef _USBCOMPAT_USB_H
+#define _USBCOMPAT_USB_H
+
+#include <limits.h>
+
+struct usb_endpoint_descriptor {
+	unsigned char bEndpointAddress;
+	unsigned short wMaxPacketSize;
+};
+
+struct usb_interface_descriptor {
+	unsigned char bNumEndpoints;
+	struct usb_endpoint_descriptor *endpoint;
+};
+
+struct usb_interface {
+	struct usb_interface_descriptor *altsetting;
+	int num_altsetting;
+};
+
+struct usb_config_descriptor {
+	unsigned char bNumInterfaces;
+	struct usb_interface *interface;
+};
+
+struct usb_device_descriptor {
+	unsigned short idVendor;
+	unsigned short idProduct;
+	unsigned char iProduct;
+};
+
+struct usb_bus;
+
+struct usb_device {
+	struct usb_device *next, *prev;
+	char filename[PATH_MAX + 1];
+	struct usb_bus *bus;
+	struct usb_device_descriptor descriptor;
+	struct usb_config_descriptor *config;
+	unsigned char devnum;
+};
+
+struct usb_bus {
+	struct usb_bus *next, *prev;
+	char dirname[PATH_MAX + 1];
+	struct usb_device *devices;
+};
+
+typedef struct usb_dev_handle usb_dev_handle;
+
+extern struct usb_bus *usb_busses;
+
+void usb_init(void);
+int usb_find_busses(void);
+int usb_find_devices(void);
+usb_dev_handle *usb_open(struct usb_device *dev);
+int usb_close(usb_dev_handle * dev);
+int usb_claim_interface(usb_dev_handle * dev, int interface);
+int usb_release_interface(usb_dev_handle * dev, int interface);
+int usb_bulk_write(usb_dev_handle * dev, int ep, char *bytes, int size, int timeout);
+int usb_bulk_read(usb_dev_handle * dev, int ep, char *bytes, int size, int timeout);
+
+#endif
@@ -0,0 +1,209 @@
+/****************************************************************************
+ ** usbreplay.c *************************************************************
+ ****************************************************************************
+ *
+ * usbreplay.c - a CommandIR II behind the libusb-0.1 calls that replays
+ *               recorded packets
+ *
+ * There is one device on bus 001. It answers GET_VERSION, and from
+ * then on a bulk read returns the next recorded packet once the
+ * packet is due, and the TX status packet the hardware sends when
+ * nothing came in otherwise. A read never blocks, just as the
+ * CommandIRs answer every poll at once. The due times count from the
+ * GET_VERSION answer, and the counters live in shared memory so the
+ * process that forked the driver's child can read them.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "usb.h"
+#include "usbreplay.h"
+
+/* as in hw_commandir.h */
+#define REPLAY_GET_VERSION 20
+#define REPLAY_RX_HEADER_TXAVAIL 0x03
+#define REPLAY_TXAVAIL_LENGTH 10
+
+struct replay_packet {
+	long due;		/* usecs */
+	int length;
+	unsigned char data[REPLAY_MAX_PACKET];
+};
+
+struct usb_dev_handle {
+	int claimed;
+};
+
+struct usb_bus *usb_busses = NULL;
+
+static struct replay_packet *packets = NULL;
+static int packet_count = 0, packet_slots = 0, next_packet = 0;
+static struct usb_replay_stats *stats = NULL;
+static int version_pending = 0, scanned = 0;
+
+static struct usb_endpoint_descriptor endpoints[2];
+static struct usb_interface_descriptor altsetting;
+static struct usb_interface interface;
+static struct usb_config_descriptor config;
+static struct usb_device device;
+static struct usb_bus bus;
+static struct usb_dev_handle handle;
+
+struct usb_replay_stats *usb_replay_init(void)
+{
+	stats = mmap(NULL, sizeof(*stats), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (stats == MAP_FAILED) {
+		stats = NULL;
+		return NULL;
+	}
+	memset(stats, 0, sizeof(*stats));
+	return stats;
+}
+
+int usb_replay_add(long due, const unsigned char *data, int length)
+{
+	struct replay_packet *p;
+
+	if (length < 1 || length > REPLAY_MAX_PACKET) {
+		return 0;
+	}
+	if (packet_count == packet_slots) {
+		packet_slots = packet_slots ? 2 * packet_slots : 64;
+		p = realloc(packets, packet_slots * sizeof(*packets));
+		if (p == NULL) {
+			return 0;
+		}
+		packets = p;
+	}
+	p = &packets[packet_count++];
+	p->due = due;
+	p->length = length;
+	memcpy(p->data, data, length);
+	return 1;
+}
+
+static long since_start(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - stats->start.tv_sec) * 1000000 + (now.tv_nsec - stats->start.tv_nsec) / 1000;
+}
+
+void usb_init(void)
+{
+	endpoints[0].bEndpointAddress = 0x81;
+	endpoints[0].wMaxPacketSize = REPLAY_MAX_PACKET;
+	endpoints[1].bEndpointAddress = 0x02;
+	endpoints[1].wMaxPacketSize = REPLAY_MAX_PACKET;
+	altsetting.bNumEndpoints = 2;
+	altsetting.endpoint = endpoints;
+	interface.altsetting = &altsetting;
+	interface.num_altsetting = 1;
+	config.bNumInterfaces = 1;
+	config.interface = &interface;
+
+	memset(&device, 0, sizeof(device));
+	strcpy(device.filename, "002");
+	device.bus = &bus;
+	device.descriptor.idVendor = 0x10c4;
+	device.descriptor.idProduct = 3;
+	device.descriptor.iProduct = 2;	/* CommandIR II */
+	device.config = &config;
+	device.devnum = 2;
+
+	memset(&bus, 0, sizeof(bus));
+	strcpy(bus.dirname, "001");
+	bus.devices = &device;
+	usb_busses = &bus;
+}
+
+int usb_find_busses(void)
+{
+	return 0;
+}
+
+/* the number of changes since the last call */
+int usb_find_devices(void)
+{
+	if (scanned) {
+		return 0;
+	}
+	scanned = 1;
+	return 1;
+}
+
+usb_dev_handle *usb_open(struct usb_device *dev)
+{
+	return (dev == &device ? &handle : NULL);
+}
+
+int usb_close(usb_dev_handle * dev)
+{
+	return 0;
+}
+
+int usb_claim_interface(usb_dev_handle * dev, int interface)
+{
+	dev->claimed = 1;
+	return 0;
+}
+
+int usb_release_interface(usb_dev_handle * dev, int interface)
+{
+	dev->claimed = 0;
+	return 0;
+}
+
+int usb_bulk_write(usb_dev_handle * dev, int ep, char *bytes, int size, int timeout)
+{
+	if (!dev->claimed) {
+		return -1;
+	}
+	if (size == 2 && bytes[1] == REPLAY_GET_VERSION) {
+		version_pending = 1;
+	}
+	return size;
+}
+
+int usb_bulk_read(usb_dev_handle * dev, int ep, char *bytes, int size, int timeout)
+{
+	struct replay_packet *p;
+	int length;
+
+	if (!dev->claimed || stats == NULL) {
+		return -1;
+	}
+	if (version_pending) {
+		version_pending = 0;
+		bytes[0] = REPLAY_GET_VERSION;
+		bytes[1] = 2;
+		bytes[2] = 0;
+		clock_gettime(CLOCK_MONOTONIC, &stats->start);
+		stats->started = 1;
+		return 3;
+	}
+	if (!stats->started) {
+		return 0;
+	}
+	stats->reads++;
+	if (next_packet < packet_count && since_start() >= packets[next_packet].due) {
+		p = &packets[next_packet++];
+		length = p->length < size ? p->length : size;
+		memcpy(bytes, p->data, length);
+		stats->packets++;
+		return length;
+	}
+	length = REPLAY_TXAVAIL_LENGTH < size ? REPLAY_TXAVAIL_LENGTH : size;
+	memset(bytes, 0, length);
+	bytes[0] = REPLAY_RX_HEADER_TXAVAIL;
+	return length;
+}
@@ -0,0 +1,29 @@
+/****************************************************************************
+ ** usbreplay.h *************************************************************
+ ****************************************************************************
+ *
+ * usbreplay.h - a CommandIR II behind the libusb-0.1 calls that replays
+ *               recorded packets
+ *
+ */
+
+#ifndef _USBREPLAY_H
+#define _USBREPLAY_H
+
+#include <time.h>
+
+#define REPLAY_MAX_PACKET 64
+
+/* shared with the driver's child process */
+struct usb_replay_stats {
+	int started;
+	struct timespec start;	/* the device answered GET_VERSION */
+	unsigned long reads;	/* bulk reads after that */
+	unsigned long packets;	/* reads that returned a recorded packet */
+};
+
+/* before the driver forks */
+struct usb_replay_stats *usb_replay_init(void);
+int usb_replay_add(long due, const unsigned char *data, int length);
+
+#endif